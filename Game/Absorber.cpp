@@ -0,0 +1,20 @@
+#include "Absorber.h"
+
+/// <summary>
+/// Absorber Constructor given the corners of an axis-aligned region.
+/// </summary>
+/// <param name="min">The bottom left corner of the region.</param>
+/// <param name="max">The top right corner of the region.</param>
+Absorber::Absorber(Vector2 min, Vector2 max) {
+	this->min = min;
+	this->max = max;
+}
+
+/// <summary>
+/// Returns whether a point lies inside the absorber region.
+/// </summary>
+/// <param name="point">The point being tested.</param>
+/// <returns>True if the point is inside the region.</returns>
+bool Absorber::Contains(const Vector2& point) const {
+	return point.x >= min.x && point.x <= max.x && point.y >= min.y && point.y <= max.y;
+}
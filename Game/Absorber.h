@@ -0,0 +1,17 @@
+#pragma once
+
+#ifndef ABSORBER_H
+#define ABSORBER_H
+
+#include "Vector2.h"
+
+class Absorber
+{
+public:
+	Absorber(Vector2 min, Vector2 max);
+	bool Contains(const Vector2& point) const;
+	Vector2 min;
+	Vector2 max;
+};
+
+#endif
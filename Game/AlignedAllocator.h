@@ -0,0 +1,64 @@
+#pragma once
+
+#ifndef ALIGNEDALLOCATOR_H
+#define ALIGNEDALLOCATOR_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// Cache line alignment, which also satisfies every SIMD load width.
+const size_t SIMD_ALIGNMENT = 64;
+
+// A std::vector allocator that aligns its storage, so SIMD kernels can use aligned loads.
+template<typename T, size_t Alignment = SIMD_ALIGNMENT>
+class AlignedAllocator
+{
+public:
+	typedef T value_type;
+
+	template<typename U>
+	struct rebind {
+		typedef AlignedAllocator<U, Alignment> other;
+	};
+
+	AlignedAllocator() {}
+
+	template<typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+	T* allocate(size_t count) {
+		if (count == 0) return nullptr;
+#ifdef _WIN32
+		void* memory = _aligned_malloc(count * sizeof(T), Alignment);
+#else
+		void* memory = nullptr;
+		if (posix_memalign(&memory, Alignment, count * sizeof(T)) != 0) memory = nullptr;
+#endif
+		if (!memory) throw std::bad_alloc();
+		return (T*)memory;
+	}
+
+	void deallocate(T* memory, size_t) {
+#ifdef _WIN32
+		_aligned_free(memory);
+#else
+		free(memory);
+#endif
+	}
+};
+
+template<typename T, typename U, size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) {
+	return true;
+}
+
+template<typename T, typename U, size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) {
+	return false;
+}
+
+#endif
@@ -0,0 +1,85 @@
+#include "Bounds.h"
+#include <math.h>
+
+/// <summary>
+/// Empty Bounds Constructor.
+/// </summary>
+Bounds::Bounds() {
+
+}
+
+/// <summary>
+/// Bounds Constructor given two corners.
+/// </summary>
+/// <param name="min">The bottom left corner.</param>
+/// <param name="max">The top right corner.</param>
+Bounds::Bounds(Vector2 min, Vector2 max) {
+	this->min = min;
+	this->max = max;
+}
+
+/// <summary>
+/// Returns whether a point lies inside the bounds.
+/// </summary>
+/// <param name="point">The point being tested.</param>
+/// <returns>True if the point is inside.</returns>
+bool Bounds::Contains(const Vector2& point) const {
+	return point.x >= min.x && point.x <= max.x && point.y >= min.y && point.y <= max.y;
+}
+
+/// <summary>
+/// Returns whether a circle overlaps the bounds. Conservative at the corners.
+/// </summary>
+/// <param name="center">The center of the circle.</param>
+/// <param name="radius">The radius of the circle.</param>
+/// <returns>True if any part of the circle may be inside.</returns>
+bool Bounds::Overlaps(const Vector2& center, float radius) const {
+	return center.x + radius >= min.x && center.x - radius <= max.x && center.y + radius >= min.y && center.y - radius <= max.y;
+}
+
+/// <summary>
+/// Returns the width of the bounds.
+/// </summary>
+float Bounds::getWidth() const {
+	return max.x - min.x;
+}
+
+/// <summary>
+/// Returns the height of the bounds.
+/// </summary>
+float Bounds::getHeight() const {
+	return max.y - min.y;
+}
+
+/// <summary>
+/// Returns the center of the bounds.
+/// </summary>
+Vector2 Bounds::getCenter() const {
+	return Vector2((min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f);
+}
+
+/// <summary>
+/// Wraps a point back into the bounds, treating them as a torus.
+/// </summary>
+/// <param name="point">The point being wrapped.</param>
+/// <returns>The image of the point inside the bounds.</returns>
+Vector2 Bounds::Wrap(const Vector2& point) const {
+	float width = getWidth();
+	float height = getHeight();
+	float x = point.x - width * floorf((point.x - min.x) / width);
+	float y = point.y - height * floorf((point.y - min.y) / height);
+	return Vector2(x, y);
+}
+
+/// <summary>
+/// Returns the shortest image of a separation on the torus, so neighbours across an edge are as close as they look.
+/// </summary>
+/// <param name="difference">The separation between two points inside the bounds.</param>
+/// <returns>The separation to the nearest image.</returns>
+Vector2 Bounds::MinimumImage(const Vector2& difference) const {
+	float width = getWidth();
+	float height = getHeight();
+	float x = difference.x - width * roundf(difference.x / width);
+	float y = difference.y - height * roundf(difference.y / height);
+	return Vector2(x, y);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include "Vector2.h"
+
+// An axis-aligned rectangle, used for the world's walls and the camera's view.
+// In the periodic boundary mode it is also the unit cell the world repeats in.
+class Bounds
+{
+public:
+	Bounds();
+	Bounds(Vector2 min, Vector2 max);
+	bool Contains(const Vector2& point) const;
+	bool Overlaps(const Vector2& center, float radius) const;
+	float getWidth() const;
+	float getHeight() const;
+	Vector2 getCenter() const;
+	Vector2 Wrap(const Vector2& point) const;
+	Vector2 MinimumImage(const Vector2& difference) const;
+	Vector2 min;
+	Vector2 max;
+};
+
+#endif
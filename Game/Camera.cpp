@@ -0,0 +1,100 @@
+#include "Camera.h"
+
+// Zoom limits, in screen pixels per world unit.
+const float MIN_ZOOM = 0.0001f;
+const float MAX_ZOOM = 100.0f;
+
+/// <summary>
+/// Camera Constructor.
+/// </summary>
+/// <param name="center">The world position at the center of the screen.</param>
+/// <param name="zoom">Screen pixels per world unit.</param>
+/// <param name="viewportWidth">The width of the window in pixels.</param>
+/// <param name="viewportHeight">The height of the window in pixels.</param>
+Camera::Camera(Vector2 center, float zoom, unsigned int viewportWidth, unsigned int viewportHeight) {
+	this->center = center;
+	this->zoom = zoom;
+	this->viewportWidth = viewportWidth;
+	this->viewportHeight = viewportHeight;
+}
+
+/// <summary>
+/// Moves the camera by an offset in screen pixels.
+/// </summary>
+/// <param name="offset">The offset in screen pixels.</param>
+void Camera::Pan(Vector2 offset) {
+	center = center + offset / zoom;
+}
+
+/// <summary>
+/// Zooms by a factor, keeping the world position under the anchor fixed on screen.
+/// </summary>
+/// <param name="factor">The zoom multiplier.</param>
+/// <param name="anchor">The world position that stays still.</param>
+void Camera::Zoom(float factor, Vector2 anchor) {
+	float previous = zoom;
+	setZoom(zoom * factor);
+	float scale = previous / zoom;
+	center = anchor + (center - anchor) * scale;
+}
+
+/// <summary>
+/// Returns the world position at the center of the screen.
+/// </summary>
+Vector2 Camera::getCenter() {
+	return this->center;
+}
+
+/// <summary>
+/// Sets the world position at the center of the screen.
+/// </summary>
+void Camera::setCenter(Vector2 center) {
+	this->center = center;
+}
+
+/// <summary>
+/// Returns the number of screen pixels per world unit.
+/// </summary>
+float Camera::getZoom() {
+	return this->zoom;
+}
+
+/// <summary>
+/// Sets the number of screen pixels per world unit.
+/// </summary>
+void Camera::setZoom(float zoom) {
+	if (zoom < MIN_ZOOM) zoom = MIN_ZOOM;
+	if (zoom > MAX_ZOOM) zoom = MAX_ZOOM;
+	this->zoom = zoom;
+}
+
+/// <summary>
+/// Returns the region of the world currently on screen.
+/// </summary>
+/// <returns>The visible bounds.</returns>
+Bounds Camera::getView() const {
+	float halfWidth = viewportWidth * 0.5f / zoom;
+	float halfHeight = viewportHeight * 0.5f / zoom;
+	return Bounds(Vector2(center.x - halfWidth, center.y - halfHeight), Vector2(center.x + halfWidth, center.y + halfHeight));
+}
+
+/// <summary>
+/// Converts a cursor position, measured from the top left of the window, into world space.
+/// </summary>
+/// <param name="x">The cursor X position.</param>
+/// <param name="y">The cursor Y position.</param>
+/// <returns>The world position under the cursor.</returns>
+Vector2 Camera::ScreenToWorld(double x, double y) const {
+	Bounds view = getView();
+	return Vector2(view.min.x + (float)x / zoom, view.min.y + (float)(viewportHeight - y) / zoom);
+}
+
+/// <summary>
+/// Returns whether anything within a radius of a position may be on screen.
+/// </summary>
+/// <param name="position">The world position.</param>
+/// <param name="radius">The bounding radius.</param>
+/// <returns>True if it should be drawn.</returns>
+bool Camera::IsVisible(const Vector2& position, float radius) const {
+	return getView().Overlaps(position, radius);
+}
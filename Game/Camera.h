@@ -0,0 +1,30 @@
+#pragma once
+
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include "Bounds.h"
+
+// A 2D camera that pans and zooms over the world. The view is
+// independent of the world's bounds, which may be far larger than the window.
+class Camera
+{
+public:
+	Camera(Vector2 center, float zoom, unsigned int viewportWidth, unsigned int viewportHeight);
+	void Pan(Vector2 offset);
+	void Zoom(float factor, Vector2 anchor);
+	Vector2 getCenter();
+	void setCenter(Vector2 center);
+	float getZoom();
+	void setZoom(float zoom);
+	Bounds getView() const;
+	Vector2 ScreenToWorld(double x, double y) const;
+	bool IsVisible(const Vector2& position, float radius) const;
+private:
+	Vector2 center;
+	float zoom;
+	unsigned int viewportWidth;
+	unsigned int viewportHeight;
+};
+
+#endif
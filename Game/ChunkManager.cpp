@@ -0,0 +1,309 @@
+/*
+Sparse chunked storage for very large worlds. Particles are binned into
+fixed-size chunks, and chunks that have been asleep for a while and are far
+from any awake chunk or the camera are written to a memory-mapped page file
+and their particles returned to the pool. They are paged back in as soon as
+something moves into or next to them.
+*/
+
+#include "ChunkManager.h"
+#include <math.h>
+#include <stdio.h>
+#include <iostream>
+
+// The camera only keeps chunks resident when it covers fewer chunks than this,
+// so zooming out over a huge world doesn't page the whole world back in.
+const size_t MAX_VIEW_CHUNKS = 1024;
+
+// The page file starts at this many records and doubles as it fills.
+const size_t INITIAL_PAGE_RECORDS = 65536;
+
+/// <summary>
+/// Chunk Manager Constructor.
+/// </summary>
+/// <param name="chunkSize">The width of a chunk in world units.</param>
+/// <param name="pagePath">The path of the page file evicted chunks are written to.</param>
+ChunkManager::ChunkManager(float chunkSize, const std::string& pagePath) {
+    this->chunkSize = chunkSize;
+    if (!pageFile.Create(pagePath, INITIAL_PAGE_RECORDS * sizeof(ParticleRecord))) {
+        std::cout << "Could not create page file " << pagePath << ", chunks will stay resident." << std::endl;
+    }
+}
+
+/// <summary>
+/// Chunk Manager Deconstructor. Deletes the page file.
+/// </summary>
+ChunkManager::~ChunkManager() {
+    std::string path = pageFile.getPath();
+    bool open = pageFile.isOpen();
+    pageFile.Close();
+    if (open) remove(path.c_str());
+}
+
+/// <summary>
+/// Packs a chunk's coordinates into a key.
+/// </summary>
+uint64_t ChunkManager::getKey(int chunkX, int chunkY) {
+    return ((uint64_t)(uint32_t)chunkX << 32) | (uint64_t)(uint32_t)chunkY;
+}
+
+/// <summary>
+/// Returns the key of the chunk containing a position.
+/// </summary>
+uint64_t ChunkManager::getKey(const Vector2& position) {
+    return getKey((int)floorf(position.x / chunkSize), (int)floorf(position.y / chunkSize));
+}
+
+/// <summary>
+/// Returns the column of a chunk from its key.
+/// </summary>
+int ChunkManager::getChunkX(uint64_t key) {
+    return (int)(int32_t)(uint32_t)(key >> 32);
+}
+
+/// <summary>
+/// Returns the row of a chunk from its key.
+/// </summary>
+int ChunkManager::getChunkY(uint64_t key) {
+    return (int)(int32_t)(uint32_t)(key & 0xFFFFFFFF);
+}
+
+/// <summary>
+/// Returns whether an active chunk lies within a distance of a chunk.
+/// </summary>
+/// <param name="key">The chunk.</param>
+/// <param name="distance">The distance in chunks.</param>
+/// <returns>True if there is activity nearby.</returns>
+bool ChunkManager::NearActivity(uint64_t key, int distance) {
+    int chunkX = getChunkX(key);
+    int chunkY = getChunkY(key);
+    for (int y = chunkY - distance; y <= chunkY + distance; y++) {
+        for (int x = chunkX - distance; x <= chunkX + distance; x++) {
+            if (active.count(getKey(x, y))) return true;
+        }
+    }
+    return false;
+}
+
+/// <summary>
+/// Rebins the particles into chunks, pages in chunks next to activity and evicts chunks that have gone idle.
+/// Evicted particles are killed, so call this before the pool reaps.
+/// </summary>
+/// <param name="entities">The list of live entities.</param>
+/// <param name="pool">The pool particles are returned to and respawned from.</param>
+/// <param name="view">The region on screen, which is always kept resident.</param>
+void ChunkManager::Update(std::vector<Entity*>& entities, ParticlePool* pool, const Bounds& view) {
+    // Rebin every live entity.
+    for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+        it->second.entities.clear();
+        it->second.awake = false;
+        it->second.pinned = false;
+    }
+
+    std::unordered_set<uint64_t> entered;
+    for (size_t i = 0; i < entities.size(); i++) {
+        Entity* ent = entities[i];
+        if (!ent->isAlive()) continue;
+
+        uint64_t key = getKey(ent->position);
+        Chunk& chunk = chunks[key];
+        if (chunk.evicted) entered.insert(key);
+        chunk.entities.push_back(ent);
+
+        // Particles resting on something still jitter by about a tick of gravity, so they count as asleep.
+        if (ent->velocity.MagnitudeSqr() > CHUNK_WAKE_SPEED * CHUNK_WAKE_SPEED) chunk.awake = true;
+
+        // Only pooled, free moving circles that never expire can be paged out. Constraints aren't paged,
+        // so ropes and cloth stay resident rather than lose them.
+        if (ent->type != CIRCLE || ent->isKinematic() || ent->isConstrained() || !pool->Owns(ent) || ent->getLifetime() > 0.0f) chunk.pinned = true;
+    }
+
+    // Active chunks are awake, or on screen.
+    active.clear();
+    for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+        if (it->second.awake) active.insert(it->first);
+    }
+
+    int minX = (int)floorf(view.min.x / chunkSize), maxX = (int)floorf(view.max.x / chunkSize);
+    int minY = (int)floorf(view.min.y / chunkSize), maxY = (int)floorf(view.max.y / chunkSize);
+    if ((size_t)(maxX - minX + 1) * (size_t)(maxY - minY + 1) <= MAX_VIEW_CHUNKS) {
+        for (int y = minY; y <= maxY; y++) {
+            for (int x = minX; x <= maxX; x++) {
+                active.insert(getKey(x, y));
+            }
+        }
+    }
+
+    // Page in evicted chunks that something entered or that border activity.
+    for (auto it = active.begin(); it != active.end(); ++it) {
+        int chunkX = getChunkX(*it);
+        int chunkY = getChunkY(*it);
+        for (int y = chunkY - 1; y <= chunkY + 1; y++) {
+            for (int x = chunkX - 1; x <= chunkX + 1; x++) {
+                uint64_t key = getKey(x, y);
+                auto found = chunks.find(key);
+                if (found != chunks.end() && found->second.evicted) entered.insert(key);
+            }
+        }
+    }
+    for (auto it = entered.begin(); it != entered.end(); ++it) {
+        Chunk& chunk = chunks[*it];
+        PageIn(chunk, entities, pool);
+        chunk.sleepTicks = 0;
+    }
+
+    // Evict idle chunks far from activity, and forget empty ones.
+    for (auto it = chunks.begin(); it != chunks.end();) {
+        Chunk& chunk = it->second;
+        if (chunk.evicted) {
+            ++it;
+            continue;
+        }
+        if (chunk.entities.empty()) {
+            it = chunks.erase(it);
+            continue;
+        }
+
+        chunk.sleepTicks = chunk.awake ? 0 : chunk.sleepTicks + 1;
+        if (!chunk.pinned && chunk.sleepTicks >= CHUNK_SLEEP_UPDATES && !NearActivity(it->first, CHUNK_EVICT_DISTANCE)) {
+            Evict(chunk);
+        }
+        ++it;
+    }
+}
+
+/// <summary>
+/// Writes a chunk's particles to the page file and kills them so the pool recycles their slots.
+/// </summary>
+/// <param name="chunk">The chunk.</param>
+void ChunkManager::Evict(Chunk& chunk) {
+    if (!pageFile.isOpen()) return;
+
+    size_t count = chunk.entities.size();
+    size_t offset = Allocate(count);
+    if (offset == (size_t)-1) return;
+
+    ParticleRecord* records = (ParticleRecord*)pageFile.getData() + offset;
+    for (size_t i = 0; i < count; i++) {
+        EntityCircle* particle = (EntityCircle*)chunk.entities[i];
+        ParticleRecord& record = records[i];
+        record.positionX = particle->position.x;
+        record.positionY = particle->position.y;
+        record.velocityX = particle->velocity.x;
+        record.velocityY = particle->velocity.y;
+        record.radius = particle->getRadius();
+        record.lifetime = particle->getLifetime();
+        record.age = particle->getAge();
+        record.color[0] = particle->color[0];
+        record.color[1] = particle->color[1];
+        record.color[2] = particle->color[2];
+        particle->Kill();
+    }
+
+    chunk.entities.clear();
+    chunk.evicted = true;
+    chunk.recordOffset = offset;
+    chunk.recordCount = count;
+    evictedChunks++;
+    evictedParticles += count;
+}
+
+/// <summary>
+/// Respawns a chunk's particles from the page file. Waits for a later update if the pool is too full.
+/// </summary>
+/// <param name="chunk">The chunk.</param>
+/// <param name="entities">The list of live entities.</param>
+/// <param name="pool">The pool the particles are respawned from.</param>
+void ChunkManager::PageIn(Chunk& chunk, std::vector<Entity*>& entities, ParticlePool* pool) {
+    if (!chunk.evicted) return;
+    if (pool->getCapacity() - pool->getActiveCount() < chunk.recordCount) return;
+
+    const ParticleRecord* records = (const ParticleRecord*)pageFile.getData() + chunk.recordOffset;
+    for (size_t i = 0; i < chunk.recordCount; i++) {
+        const ParticleRecord& record = records[i];
+        EntityCircle* particle = pool->Spawn(Vector2(record.positionX, record.positionY), Vector2(record.velocityX, record.velocityY), record.lifetime);
+        particle->setRadius(record.radius);
+        particle->setAge(record.age);
+        particle->color[0] = record.color[0];
+        particle->color[1] = record.color[1];
+        particle->color[2] = record.color[2];
+        entities.push_back(particle);
+        chunk.entities.push_back(particle);
+    }
+
+    Free(chunk.recordOffset, chunk.recordCount);
+    evictedChunks--;
+    evictedParticles -= chunk.recordCount;
+    chunk.evicted = false;
+    chunk.recordOffset = 0;
+    chunk.recordCount = 0;
+}
+
+/// <summary>
+/// Finds room for a run of records in the page file, growing it if needed.
+/// </summary>
+/// <param name="count">The number of records.</param>
+/// <returns>The index of the first record, or -1 if the file couldn't grow.</returns>
+size_t ChunkManager::Allocate(size_t count) {
+    for (size_t i = 0; i < freeRanges.size(); i++) {
+        if (freeRanges[i].second < count) continue;
+        size_t offset = freeRanges[i].first;
+        freeRanges[i].first += count;
+        freeRanges[i].second -= count;
+        if (freeRanges[i].second == 0) freeRanges.erase(freeRanges.begin() + i);
+        return offset;
+    }
+
+    size_t needed = (pageEnd + count) * sizeof(ParticleRecord);
+    if (needed > pageFile.getSize()) {
+        size_t size = pageFile.getSize() * 2;
+        if (size < needed) size = needed;
+        if (!pageFile.Resize(size)) return (size_t)-1;
+    }
+
+    size_t offset = pageEnd;
+    pageEnd += count;
+    return offset;
+}
+
+/// <summary>
+/// Returns a run of records to the free list.
+/// </summary>
+/// <param name="offset">The index of the first record.</param>
+/// <param name="count">The number of records.</param>
+void ChunkManager::Free(size_t offset, size_t count) {
+    if (count == 0) return;
+    if (offset + count == pageEnd) {
+        pageEnd = offset;
+        return;
+    }
+    freeRanges.push_back(std::make_pair(offset, count));
+}
+
+/// <summary>
+/// Returns the number of chunks holding particles in memory.
+/// </summary>
+size_t ChunkManager::getResidentChunkCount() {
+    return chunks.size() - evictedChunks;
+}
+
+/// <summary>
+/// Returns the number of chunks paged out to disk.
+/// </summary>
+size_t ChunkManager::getEvictedChunkCount() {
+    return this->evictedChunks;
+}
+
+/// <summary>
+/// Returns the number of particles paged out to disk.
+/// </summary>
+size_t ChunkManager::getEvictedParticleCount() {
+    return this->evictedParticles;
+}
+
+/// <summary>
+/// Returns the width of a chunk in world units.
+/// </summary>
+float ChunkManager::getChunkSize() {
+    return this->chunkSize;
+}
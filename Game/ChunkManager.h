@@ -0,0 +1,71 @@
+#pragma once
+
+#ifndef CHUNKMANAGER_H
+#define CHUNKMANAGER_H
+
+#include "ParticlePool.h"
+#include "Bounds.h"
+#include "IO/MappedFile.h"
+#include <stdint.h>
+#include <unordered_map>
+#include <unordered_set>
+
+// The state of one particle while its chunk is paged out.
+struct ParticleRecord {
+	float positionX;
+	float positionY;
+	float velocityX;
+	float velocityY;
+	float radius;
+	float lifetime;
+	float age;
+	float color[3];
+};
+
+// A fixed-size square of the world. Resident chunks hold their particles in the pool,
+// evicted chunks hold them as records in the page file.
+struct Chunk {
+	std::vector<Entity*> entities;
+	unsigned int sleepTicks = 0;
+	bool awake = false;
+	bool pinned = false;
+	bool evicted = false;
+	size_t recordOffset = 0;
+	size_t recordCount = 0;
+};
+
+// Splits the world into chunks and pages fully asleep chunks far from any activity out
+// to a memory-mapped file, so resident memory scales with the active area of the world.
+class ChunkManager
+{
+public:
+	ChunkManager(float chunkSize, const std::string& pagePath);
+	~ChunkManager();
+	void Update(std::vector<Entity*>& entities, ParticlePool* pool, const Bounds& view);
+	size_t getResidentChunkCount();
+	size_t getEvictedChunkCount();
+	size_t getEvictedParticleCount();
+	float getChunkSize();
+private:
+	uint64_t getKey(int chunkX, int chunkY);
+	uint64_t getKey(const Vector2& position);
+	int getChunkX(uint64_t key);
+	int getChunkY(uint64_t key);
+	bool NearActivity(uint64_t key, int distance);
+	void Evict(Chunk& chunk);
+	void PageIn(Chunk& chunk, std::vector<Entity*>& entities, ParticlePool* pool);
+	size_t Allocate(size_t count);
+	void Free(size_t offset, size_t count);
+	float chunkSize;
+	std::unordered_map<uint64_t, Chunk> chunks;
+	std::unordered_set<uint64_t> active;
+	size_t evictedChunks = 0;
+	size_t evictedParticles = 0;
+
+	// Page file of particle records, with a first-fit free list of record ranges.
+	MappedFile pageFile;
+	size_t pageEnd = 0;
+	std::vector<std::pair<size_t, size_t>> freeRanges;
+};
+
+#endif
@@ -21,14 +21,122 @@ const unsigned int SCREEN_WIDTH = 800;
 const unsigned int SCREEN_HEIGHT = 600;
 const bool FULLSCREEN = true;
 
+// The default size of the world. It is independent of the window and can be set with --world.
+const float WORLD_WIDTH = 800.0f;
+const float WORLD_HEIGHT = 600.0f;
+
+// Camera Variables
+const float CAMERA_PAN_SPEED = 10.0f;
+const float CAMERA_ZOOM_STEP = 1.1f;
+
 const double PI = 3.14159265358979311599796346854;
 
+// Scalar of the bulk simulation core. Float for interactive throughput,
+// build with SIM_DOUBLE_PRECISION for long validation runs.
+#ifdef SIM_DOUBLE_PRECISION
+typedef double Real;
+#else
+typedef float Real;
+#endif
+
+// Maximum number of live particles. The pool grows a block of slots at a time up to it.
+const unsigned int PARTICLE_CAPACITY = 262144;
+const unsigned int PARTICLE_BLOCK_SIZE = 4096;
+
+// Chunk Variables
+// The world is split into chunks, and chunks that stay asleep far from any activity are paged out to disk.
+const float CHUNK_SIZE = 512.0f;
+const unsigned int CHUNK_UPDATE_INTERVAL = 30;
+const unsigned int CHUNK_SLEEP_UPDATES = 4;
+const int CHUNK_EVICT_DISTANCE = 2;
+const float CHUNK_WAKE_SPEED = 20.0f;
+const char* const CHUNK_PAGE_FILE = "chunks.page";
+
+// The scene snapshot F5 saves to and F9 loads from.
+const char* const SCENE_SNAPSHOT_FILE = "scene.snap";
+
+// Recording Variables
+// Recorded frames are quantised to these steps and delta encoded against the frame before, with a keyframe every interval.
+// The simulation drops a frame rather than wait when every buffer is still being written.
+const unsigned int RECORD_BUFFERS = 4;
+const unsigned int RECORD_KEYFRAME_INTERVAL = 60;
+const float RECORD_POSITION_QUANTUM = 1.0f / 64.0f;
+const float RECORD_VELOCITY_QUANTUM = 1.0f / 64.0f;
+const char* const RECORD_FILE = "recording.traj";
+
+// Checkpoint Variables
+// Headless runs with a checkpoint path save one every interval ticks, alternating between two slots.
+const unsigned int CHECKPOINT_INTERVAL = 3600;
+
+// Shared State Variables
+// Published frames go round a ring of slots, so a viewer has that many frames to read one before it is written over.
+const unsigned int SHARED_STATE_SLOTS = 4;
+const char* const SHARED_STATE_NAME = "particlesim";
+
+// Replay Variables
+// Playback speed is in recorded ticks per tick, and particles are shaded from blue to red up to the colour speed.
+const float REPLAY_MAX_SPEED = 64.0f;
+const float REPLAY_COLOR_SPEED = 400.0f;
+
+// Multi-Rate Variables
+// Calm regions away from the camera step every 2^level ticks, with neighbouring regions at most one level apart.
+const float RATE_REGION_SIZE = 128.0f;
+const unsigned int MAX_RATE_LEVEL = 3;
+const float RATE_CALM_SPEED = 20.0f;
+
+// Substep Variables
+// A tick is split into substeps so nothing moves further than a fraction of the smallest radius in one substep.
+const float SUBSTEP_CFL = 0.5f;
+const unsigned int MAX_SUBSTEPS = 16;
+
 // Model Variables
 const unsigned int TRIANGLE_RESOLUTION = 20;
 
 const float ANGLE_TO_RADIANS = PI / 180.0f;
 const float RADIANS_TO_ANGLES = 180.0f / PI;
 
+// How gravity is applied to the particles.
+enum GravityMode {
+    UNIFORM,
+    BARNES_HUT
+};
+
+// Barnes-Hut Variables
+const float BARNES_HUT_THETA = 0.5f;
+const float GRAVITATIONAL_CONSTANT = 1.0f;
+const float GRAVITY_SOFTENING = 10.0f;
+
+// How circles interact with each other.
+enum InteractionMode {
+    PAIRWISE,
+    NEIGHBOUR_LIST,
+    FLUID
+};
+
+// What happens at the edges of the world.
+enum BoundaryMode {
+    REFLECTING,
+    PERIODIC
+};
+
+// Neighbour List Variables
+const float NEIGHBOUR_SKIN = 8.0f;
+const float CONTACT_STIFFNESS = 2.0f;
+const float CONTACT_DAMPING = 0.1f;
+
+// Fluid Variables
+const float FLUID_PARTICLE_RADIUS = 3.0f;
+const float FLUID_KERNEL_RADIUS = 12.0f;
+const float FLUID_REST_DENSITY = 0.8f;
+const float FLUID_STIFFNESS = 20000.0f;
+const float FLUID_VISCOSITY = 1.0f;
+
+// Constraint Variables
+const unsigned int CONSTRAINT_ITERATIONS = 8;
+const float NODE_RADIUS = 4.0f;
+const float NODE_SPACING = 12.0f;
+const float SPRING_COMPLIANCE = 0.00001f;
+
 enum EntityType {
     CIRCLE,
     BOX,
@@ -0,0 +1,42 @@
+#include "Emitter.h"
+
+/// <summary>
+/// Emitter Constructor.
+/// </summary>
+/// <param name="position">The position particles are emitted from.</param>
+/// <param name="velocity">The initial velocity of emitted particles.</param>
+/// <param name="spread">The maximum angle in degrees the velocity is randomly rotated by.</param>
+/// <param name="rate">The number of particles emitted per second.</param>
+/// <param name="lifetime">The time-to-live of emitted particles in seconds.</param>
+Emitter::Emitter(Vector2 position, Vector2 velocity, float spread, float rate, float lifetime) {
+	this->position = position;
+	this->velocity = velocity;
+	this->spread = spread;
+	this->rate = rate;
+	this->lifetime = lifetime;
+}
+
+/// <summary>
+/// Emits the particles due this tick. Stops emitting once the pool is exhausted.
+/// </summary>
+/// <param name="pool">The pool the particles are taken from.</param>
+/// <param name="entities">The list of live entities the particles are added to.</param>
+void Emitter::Update(ParticlePool* pool, std::vector<Entity*>& entities) {
+	accumulator += rate * TIMESTEP;
+
+	while (accumulator >= 1.0f) {
+		accumulator -= 1.0f;
+
+		// Rotates the velocity by a random angle inside the spread.
+		Vector2 vel = velocity;
+		float angle = ((float)rand() / RAND_MAX * 2.0f - 1.0f) * spread * ANGLE_TO_RADIANS;
+		vel.Rotate(angle);
+
+		EntityCircle* particle = pool->Spawn(position, vel, lifetime);
+		if (!particle) {
+			accumulator = 0.0f;
+			return;
+		}
+		entities.push_back(particle);
+	}
+}
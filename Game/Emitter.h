@@ -0,0 +1,22 @@
+#pragma once
+
+#ifndef EMITTER_H
+#define EMITTER_H
+
+#include "ParticlePool.h"
+
+class Emitter
+{
+public:
+	Emitter(Vector2 position, Vector2 velocity, float spread, float rate, float lifetime);
+	void Update(ParticlePool* pool, std::vector<Entity*>& entities);
+	Vector2 position;
+	Vector2 velocity;
+	float spread;
+	float rate;
+	float lifetime;
+private:
+	float accumulator = 0.0f;
+};
+
+#endif
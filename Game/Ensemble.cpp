@@ -0,0 +1,283 @@
+/*
+Runs every variant of a parameter sweep as its own World, spread over the
+thread pool, and writes the mean and spread of each variant's outcome over
+its replicas. Worlds share nothing but the parsed scene, which they only read.
+*/
+
+#include "Ensemble.h"
+#include "World.h"
+#include "Parallel.h"
+#include "ParticleStorage.h"
+#include "IO/SceneLoader.h"
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// What one world ends up as after its run.
+struct EnsembleRun {
+    double energy = 0.0;
+    double height = 0.0;
+    double speed = 0.0;
+    double probeHeight = 0.0;
+    double seconds = 0.0;
+};
+
+/// <summary>
+/// Returns the number of combinations of the swept values.
+/// </summary>
+size_t SweepSpec::getVariantCount() const {
+    return bounciness.size() * friction.size() * density.size();
+}
+
+/// <summary>
+/// Reads the values of a swept parameter, either listed or as an evenly spaced range.
+/// </summary>
+/// <param name="words">The rest of the statement.</param>
+/// <param name="values">Receives the values.</param>
+/// <returns>Whether there was at least one value and every word was a number.</returns>
+static bool ParseValues(std::istringstream& words, std::vector<float>& values) {
+    std::vector<float> parsed;
+    std::string word;
+    if (!(words >> word)) return false;
+
+    if (word == "range") {
+        float first, last;
+        unsigned int count;
+        if (!(words >> first >> last >> count) || count == 0 || (words >> word)) return false;
+        for (unsigned int i = 0; i < count; i++) {
+            parsed.push_back(count == 1 ? first : first + (last - first) * i / (count - 1));
+        }
+    }
+    else {
+        do {
+            std::istringstream number(word);
+            float value;
+            if (!(number >> value) || !number.eof()) return false;
+            parsed.push_back(value);
+        } while (words >> word);
+    }
+
+    values = parsed;
+    return true;
+}
+
+/// <summary>
+/// Reads a sweep file.
+/// </summary>
+/// <param name="path">The path of the sweep file.</param>
+/// <param name="spec">Receives the sweep.</param>
+/// <param name="error">Receives the file, line and reason of the first problem.</param>
+/// <returns>Whether the whole file was valid.</returns>
+bool LoadSweepFile(const std::string& path, SweepSpec& spec, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "Could not open " + path;
+        return false;
+    }
+
+    spec = SweepSpec();
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+
+        std::istringstream words(line);
+        std::string keyword;
+        if (!(words >> keyword)) continue;
+
+        std::string problem;
+        std::string rest;
+        if (spec.version == 0 && keyword != "sweep") {
+            problem = "sweep files start with their version, as 'sweep 1'";
+        }
+        else if (keyword == "sweep") {
+            if (!(words >> spec.version) || spec.version == 0 || (words >> rest)) problem = "expected 'sweep <version>'";
+            else if (spec.version > SWEEP_VERSION) problem = "sweep version " + std::to_string(spec.version) + " is newer than this build reads";
+        }
+        else if (keyword == "scene") {
+            if (!(words >> spec.scenePath) || (words >> rest)) problem = "expected 'scene <path>'";
+        }
+        else if (keyword == "ticks") {
+            if (!(words >> spec.ticks) || (words >> rest)) problem = "expected 'ticks <count>'";
+        }
+        else if (keyword == "replicas") {
+            if (!(words >> spec.replicas) || spec.replicas == 0 || (words >> rest)) problem = "expected 'replicas <count>' of at least one";
+        }
+        else if (keyword == "bounciness" || keyword == "friction" || keyword == "density") {
+            std::vector<float>& values = keyword == "bounciness" ? spec.bounciness : keyword == "friction" ? spec.friction : spec.density;
+            if (!ParseValues(words, values)) problem = "expected '" + keyword + " <value> [<value> ...]' or '" + keyword + " range <first> <last> <count>'";
+            for (size_t i = 0; problem.empty() && i < values.size(); i++) {
+                if (keyword == "friction" && (values[i] < 0.0f || values[i] > 1.0f)) problem = "friction must be between 0 and 1";
+                else if (keyword == "bounciness" && values[i] < 0.0f) problem = "bounciness must not be negative";
+                else if (keyword == "density" && values[i] <= 0.0f) problem = "density must be positive";
+            }
+        }
+        else {
+            problem = "unknown statement '" + keyword + "'";
+        }
+
+        if (!problem.empty()) {
+            error = path + ":" + std::to_string(lineNumber) + ": " + problem;
+            return false;
+        }
+    }
+
+    if (spec.version == 0) {
+        error = path + ": empty sweep file";
+        return false;
+    }
+    if (spec.scenePath.empty()) {
+        error = path + ": no 'scene <path>' to sweep over";
+        return false;
+    }
+
+    // Scenes are found next to the sweep that names them.
+    bool absolute = spec.scenePath[0] == '/' || spec.scenePath[0] == '\\' || (spec.scenePath.size() > 1 && spec.scenePath[1] == ':');
+    size_t slash = path.find_last_of("/\\");
+    if (!absolute && slash != std::string::npos) spec.scenePath = path.substr(0, slash + 1) + spec.scenePath;
+    return true;
+}
+
+/// <summary>
+/// Builds one world of the ensemble from the scene, runs it and measures where it ended up.
+/// </summary>
+/// <param name="scene">The base scene.</param>
+/// <param name="parameters">The world's bounciness and friction.</param>
+/// <param name="density">The density of the region particles.</param>
+/// <param name="seed">The seed the regions are filled from.</param>
+/// <param name="ticks">How long the world runs.</param>
+/// <returns>The outcome of the run.</returns>
+static EnsembleRun RunWorld(const SceneDescription& scene, const WorldParameters& parameters, float density, uint64_t seed, unsigned int ticks) {
+    auto start = std::chrono::steady_clock::now();
+
+    SceneDescription seeded = scene;
+    seeded.seed = seed;
+    ParticleStorage<float> bulk;
+    BuildSceneParticles(seeded, bulk);
+
+    // Region particles come first in the storage, then the single particles.
+    size_t regionCount = (size_t)(scene.getParticleCount() - scene.particles.size());
+    World world(parameters, bulk.getCount());
+    for (size_t i = 0; i < bulk.getCount(); i++) {
+        world.Spawn(bulk.getPosition(i), bulk.getVelocity(i), bulk.radius[i], i < regionCount ? density : 1.0f);
+    }
+    world.Step(ticks);
+
+    // Circles the world killed for blowing up are left out of the measurements.
+    EnsembleRun run;
+    const std::vector<Entity*>& entities = world.getEntities();
+    size_t regionLive = 0, probeLive = 0;
+    for (size_t i = 0; i < entities.size(); i++) {
+        if (!entities[i]->isAlive()) continue;
+        double height = entities[i]->position.y - parameters.bounds.min.y;
+        run.speed += entities[i]->velocity.Magnitude();
+        if (i < regionCount) {
+            run.height += height;
+            regionLive++;
+        }
+        else {
+            run.probeHeight += height;
+            probeLive++;
+        }
+    }
+    run.energy = world.KineticEnergy();
+    if (regionLive + probeLive > 0) run.speed /= regionLive + probeLive;
+    if (regionLive > 0) run.height /= regionLive;
+    if (probeLive > 0) run.probeHeight /= probeLive;
+    run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return run;
+}
+
+/// <summary>
+/// Writes the mean and sample standard deviation of one measurement over a variant's replicas.
+/// </summary>
+static void WriteSpread(std::ofstream& out, const std::vector<EnsembleRun>& runs, size_t first, size_t count, double EnsembleRun::* measure) {
+    double mean = 0.0;
+    for (size_t i = 0; i < count; i++) mean += runs[first + i].*measure;
+    mean /= count;
+    double variance = 0.0;
+    for (size_t i = 0; i < count; i++) variance += (runs[first + i].*measure - mean) * (runs[first + i].*measure - mean);
+    if (count > 1) variance /= count - 1;
+    out << "," << mean << "," << std::sqrt(variance);
+}
+
+/// <summary>
+/// Runs every variant and replica of a sweep concurrently and writes one row per variant to a CSV file.
+/// </summary>
+/// <param name="sweepPath">The sweep file.</param>
+/// <param name="outputPath">The CSV file the results are written to.</param>
+/// <returns>The process exit code.</returns>
+int RunEnsemble(const std::string& sweepPath, const std::string& outputPath) {
+    SweepSpec spec;
+    SceneDescription scene;
+    std::string error;
+    if (!LoadSweepFile(sweepPath, spec, error) || !LoadSceneFile(spec.scenePath, scene, error)) {
+        std::cout << error << std::endl;
+        return 1;
+    }
+    if (!scene.boxes.empty() || !scene.emitters.empty() || !scene.absorbers.empty()) {
+        std::cout << "Ensemble runs skip the scene's boxes, emitters and absorbers" << std::endl;
+    }
+
+    std::ofstream out(outputPath);
+    if (!out) {
+        std::cout << "Could not write " << outputPath << std::endl;
+        return 1;
+    }
+
+    // Variants are numbered with density changing fastest, and each variant's replicas are next to each other.
+    size_t variants = spec.getVariantCount();
+    size_t count = variants * spec.replicas;
+    std::vector<EnsembleRun> runs(count);
+    auto variantOf = [&](size_t variant, WorldParameters& parameters, float& density) {
+        density = spec.density[variant % spec.density.size()];
+        parameters.friction = spec.friction[(variant / spec.density.size()) % spec.friction.size()];
+        parameters.bounciness = spec.bounciness[variant / (spec.density.size() * spec.friction.size())];
+        parameters.bounds = scene.world;
+        parameters.boundary = scene.boundary;
+    };
+
+    // Each world is stepped on one thread. Small worlds are handed out several to a chunk.
+    auto start = std::chrono::steady_clock::now();
+    ParallelFor(count, 1, [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; r++) {
+            WorldParameters parameters;
+            float density;
+            variantOf(r / spec.replicas, parameters, density);
+            parameters.seed = (uint32_t)(scene.seed + r % spec.replicas);
+            runs[r] = RunWorld(scene, parameters, density, scene.seed + r % spec.replicas, spec.ticks);
+        }
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    out << "bounciness,friction,density,replicas,energy_mean,energy_stddev,height_mean,height_stddev,"
+        << "speed_mean,speed_stddev,probe_height_mean,probe_height_stddev,seconds_mean,seconds_stddev\n";
+    for (size_t v = 0; v < variants; v++) {
+        WorldParameters parameters;
+        float density;
+        variantOf(v, parameters, density);
+        size_t first = v * spec.replicas;
+        out << parameters.bounciness << "," << parameters.friction << "," << density << "," << spec.replicas;
+        WriteSpread(out, runs, first, spec.replicas, &EnsembleRun::energy);
+        WriteSpread(out, runs, first, spec.replicas, &EnsembleRun::height);
+        WriteSpread(out, runs, first, spec.replicas, &EnsembleRun::speed);
+        WriteSpread(out, runs, first, spec.replicas, &EnsembleRun::probeHeight);
+        WriteSpread(out, runs, first, spec.replicas, &EnsembleRun::seconds);
+        out << "\n";
+    }
+    out.close();
+    if (!out) {
+        std::cout << "Could not write " << outputPath << std::endl;
+        return 1;
+    }
+
+    std::cout << "Ran " << count << " worlds (" << variants << " variants x " << spec.replicas << " replicas) of "
+        << scene.getParticleCount() << " circles for " << spec.ticks << " ticks in " << seconds << " s on "
+        << ThreadPool::Instance().getThreadCount() << " threads | " << count * (double)spec.ticks / seconds << " world ticks/s" << std::endl;
+    std::cout << "Wrote " << variants << " variants to " << outputPath << std::endl;
+    return 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include <string>
+#include <vector>
+
+/*
+A sweep file names a base scene and the values to try for each parameter, one statement per line
+with # starting a comment. Every combination of values is a variant, and every variant is run once
+per replica, each replica filling the scene's regions from the next seed:
+
+	sweep 1
+	scene <path>
+	ticks <count>
+	replicas <count>
+	bounciness <value> [<value> ...] | range <first> <last> <count>
+	friction <value> [<value> ...] | range <first> <last> <count>
+	density <value> [<value> ...] | range <first> <last> <count>
+
+A relative scene path is relative to the sweep file. Density is the mass per unit area of the region
+particles; the scene's single particles keep a density of one, so they can be made heavier or lighter
+than the bulk around them. A parameter that is not swept keeps an Entity's default.
+*/
+
+const unsigned int SWEEP_VERSION = 1;
+
+// The variants of an ensemble and how long each runs.
+struct SweepSpec {
+	unsigned int version = 0;
+	std::string scenePath;
+	unsigned int ticks = 600;
+	unsigned int replicas = 1;
+	std::vector<float> bounciness = { 0.85f };
+	std::vector<float> friction = { 0.05f };
+	std::vector<float> density = { 1.0f };
+
+	size_t getVariantCount() const;
+};
+
+bool LoadSweepFile(const std::string& path, SweepSpec& spec, std::string& error);
+int RunEnsemble(const std::string& sweepPath, const std::string& outputPath);
+
+#endif
@@ -41,6 +41,7 @@ Entity::Entity(Vector2 position, Mesh* mesh) {
 /// <param name="rotation">The rotation of the object.</param>
 Entity::Entity(Vector2 position, float rotation, Mesh* mesh) {
 	this->position = position;
+    this->mesh = mesh;
 	this->rotation = rotation;
     this->mass = 1;
     this->scale.Set(1.0f, 1.0f);
@@ -50,13 +51,26 @@ Entity::Entity(Vector2 position, float rotation, Mesh* mesh) {
 }
 
 /// <summary>
-/// Entity Deconstructor
+/// Entity Constructor given a position and colour. Draws nothing from the shared random generator.
+/// </summary>
+/// <param name="position">The position the Entity will spawn.</param>
+/// <param name="color">The red, green and blue of the Entity.</param>
+Entity::Entity(Vector2 position, const float color[3], Mesh* mesh) {
+	this->position = position;
+    this->mesh = mesh;
+	this->rotation = 0.0f;
+    this->mass = 1;
+    this->scale.Set(1.0f, 1.0f);
+    this->color[0] = color[0];
+    this->color[1] = color[1];
+    this->color[2] = color[2];
+}
+
+/// <summary>
+/// Entity Deconstructor. The mesh is shared between entities and is released by its owner.
 /// </summary>
 Entity::~Entity() {
-    VAO vao = this->mesh->getVAO();
-    glDeleteBuffers(1, &vao.verticesVBO);
-    glDeleteBuffers(1, &vao.indicesEBO);
-    glDeleteVertexArrays(1, &vao.index);
+
 }
 
 /// <summary>
@@ -67,6 +81,30 @@ float Entity::getBounciness() {
     return this->bounciness;
 }
 
+/// <summary>
+/// Sets the bounciness factor of the Entity.
+/// </summary>
+/// <param name="bounciness">The fraction of normal speed kept in a collision.</param>
+void Entity::setBounciness(float bounciness) {
+    this->bounciness = bounciness;
+}
+
+/// <summary>
+/// Returns the friction factor of the Entity.
+/// </summary>
+/// <returns>Friction Factor.</returns>
+float Entity::getFriction() {
+    return this->friction;
+}
+
+/// <summary>
+/// Sets the friction factor of the Entity.
+/// </summary>
+/// <param name="friction">The fraction of tangential speed lost in a collision.</param>
+void Entity::setFriction(float friction) {
+    this->friction = friction;
+}
+
 /// <summary>
 /// Returns whether an entity is Kinematic.
 /// </summary>
@@ -84,22 +122,144 @@ void Entity::setKinematic(bool state) {
 }
 
 /// <summary>
-/// Update function. Performs Generic Entity update functions.
+/// Returns whether the entity is held by a constraint, and so must be stepped with the rest of its rope or cloth.
 /// </summary>
-void Entity::Update() {
+/// <returns>True if a constraint is attached to the entity.</returns>
+bool Entity::isConstrained() {
+    return this->constrained;
+}
+
+/// <summary>
+/// Sets whether the entity is held by a constraint. Kept up to date by the ConstraintSolver.
+/// </summary>
+/// <param name="state">The state to set the boolean.</param>
+void Entity::setConstrained(bool state) {
+    this->constrained = state;
+}
+
+/// <summary>
+/// Returns whether the entity is still alive. Dead entities are reaped and their slot recycled.
+/// </summary>
+/// <returns>True if the entity is alive.</returns>
+bool Entity::isAlive() {
+    return this->alive;
+}
+
+/// <summary>
+/// Marks the entity as dead so it is removed at the end of the tick.
+/// </summary>
+void Entity::Kill() {
+    this->alive = false;
+}
+
+/// <summary>
+/// Returns the time-to-live of the entity in seconds. A lifetime of zero or less never expires.
+/// </summary>
+/// <returns>The lifetime of the Entity.</returns>
+float Entity::getLifetime() {
+    return this->lifetime;
+}
+
+/// <summary>
+/// Sets the time-to-live of the entity in seconds.
+/// </summary>
+/// <param name="lifetime">The lifetime to set. Zero or less never expires.</param>
+void Entity::setLifetime(float lifetime) {
+    this->lifetime = lifetime;
+}
+
+/// <summary>
+/// Returns how long the entity has been alive in seconds.
+/// </summary>
+/// <returns>The age of the Entity.</returns>
+float Entity::getAge() {
+    return this->age;
+}
+
+/// <summary>
+/// Sets how long the entity has been alive in seconds. Used when restoring saved entities.
+/// </summary>
+/// <param name="age">The age of the Entity.</param>
+void Entity::setAge(float age) {
+    this->age = age;
+}
+
+/// <summary>
+/// Returns the rate level of the entity. It is stepped every 2^level ticks.
+/// </summary>
+/// <returns>The rate level of the Entity.</returns>
+unsigned int Entity::getRateLevel() {
+    return this->rateLevel;
+}
+
+/// <summary>
+/// Sets the rate level of the entity. Only change it on a tick the new level is due.
+/// </summary>
+/// <param name="level">The rate level. Zero steps every tick.</param>
+void Entity::setRateLevel(unsigned int level) {
+    this->rateLevel = level;
+}
+
+/// <summary>
+/// Resets a recycled entity so it can be reused without reallocating it.
+/// </summary>
+/// <param name="position">The position the entity will spawn.</param>
+/// <param name="velocity">The initial velocity of the entity.</param>
+/// <param name="lifetime">The time-to-live in seconds. Zero or less never expires.</param>
+void Entity::Respawn(Vector2 position, Vector2 velocity, float lifetime) {
+    this->position = position;
+    this->velocity = velocity;
+    this->force.Set(0, GRAVITY * this->mass);
+    this->lifetime = lifetime;
+    this->age = 0.0f;
+    this->alive = true;
+    this->rateLevel = 0;
+    this->constrained = false;
+}
+
+/// <summary>
+/// Update function. Performs Generic Entity update functions over one substep of a tick.
+/// The force is a change in velocity per tick, so each substep applies its share of it.
+/// </summary>
+/// <param name="world">The walls of the world.</param>
+/// <param name="boundary">Whether the walls reflect, or wrap around to the opposite side.</param>
+/// <param name="timestep">The length of the substep in seconds. TIMESTEP for a whole tick.</param>
+void Entity::Update(const Bounds& world, BoundaryMode boundary, float timestep) {
+    Update(world, boundary, timestep, TIMESTEP);
+}
+
+/// <summary>
+/// Update function for a simulation with its own tick length.
+/// </summary>
+/// <param name="world">The walls of the world.</param>
+/// <param name="boundary">Whether the walls reflect, or wrap around to the opposite side.</param>
+/// <param name="timestep">The length of the substep in seconds.</param>
+/// <param name="tickLength">The length of a whole tick in seconds, which the force is spread over.</param>
+void Entity::Update(const Bounds& world, BoundaryMode boundary, float timestep, float tickLength) {
+    if (!alive) return;
+
+    // Lifetime
+    if (this->lifetime > 0.0f) {
+        this->age += timestep;
+        if (this->age >= this->lifetime) {
+            this->alive = false;
+            return;
+        }
+    }
+
     if (!kinematic) {
         // Pre-Update
         this->PreUpdate();
 
         // Entity Update
-        this->velocity = this->velocity + (this->force / this->mass);
-        this->position = this->position + (this->velocity * TIMESTEP);
+        this->velocity += (this->force / this->mass) * (timestep / tickLength);
+        this->position += this->velocity * timestep;
         
         // Post-Update
-        this->PostUpdate();
-
-        // Gravity
-        this->force.Set(0, GRAVITY * this->mass);
+        if (boundary == PERIODIC)
+            this->position = world.Wrap(this->position);
+        else
+            this->PostUpdate(world, timestep / tickLength);
 
         if (std::fabs(this->velocity.MagnitudeSqr()) < deactivation)
         {
@@ -108,28 +268,42 @@ void Entity::Update() {
     }
 }
 
-void Entity::Render(GLuint shader, double frameDelta) {
-    // Finish copying position into VAO data.
-    Vector2 pos = this->position + ((this->velocity * frameDelta) * TIMESTEP);
-    VAO vao = mesh->getVAO();
-    glBindVertexArray(vao.index);
+/// <summary>
+/// Resets the force to gravity once every substep of the tick has applied it.
+/// </summary>
+void Entity::ResetForce() {
+    ResetForce(Vector2(0.0f, GRAVITY));
+}
 
-    // Creates the model matrix and transforms it.
-    Matrix4 model = Matrix4();
-    model.RotateZ(this->rotation);
-    model.Scale(this->scale.x, this->scale.y, 1.0f);
-    model.Translate(pos.x, pos.y, 0.0f);
+/// <summary>
+/// Resets the force to a gravity of the simulation's own.
+/// </summary>
+/// <param name="gravity">The change in velocity gravity makes every tick.</param>
+void Entity::ResetForce(Vector2 gravity) {
+    if (!kinematic) this->force = gravity * this->mass;
+}
 
-    GLint offsetColor = glGetUniformLocation(shader, "color");
-    glUniform3f(offsetColor, this->color[0], this->color[1], this->color[2]);
+/// <summary>
+/// Adds the Entity to its mesh's instance batch, interpolated between ticks.
+/// </summary>
+/// <param name="batch">The instance batch of the Entity's mesh.</param>
+/// <param name="frameDelta">How far the frame is between the last tick and the next.</param>
+void Entity::Render(InstanceBatch* batch, double frameDelta) {
+    Vector2 pos = this->position + ((this->velocity * frameDelta) * TIMESTEP);
 
-    // Gets the memory location of the model matrix in shaders and writes to it.
-    GLint offsetModel = glGetUniformLocation(shader, "model");
-    glUniformMatrix4fv(offsetModel, 1, GL_FALSE, model.AsArray());
+    if (this->rotation != this->basisRotation) {
+        this->basisRotation = this->rotation;
+        this->rotationCos = cosf(this->rotation * ANGLE_TO_RADIANS);
+        this->rotationSin = sinf(this->rotation * ANGLE_TO_RADIANS);
+    }
 
-    // Draw the vertex array on screen.
-    glDrawElements(GL_TRIANGLES, this->mesh->getIndices().size(), GL_UNSIGNED_INT, 0);
+    batch->Add(pos, this->rotationCos, this->rotationSin, this->scale, this->color);
+}
 
-    // Unbinds the VAO
-    glBindVertexArray(0);
+/// <summary>
+/// Returns the mesh the Entity is drawn with.
+/// </summary>
+/// <returns>The mesh.</returns>
+Mesh* Entity::getMesh() {
+    return this->mesh;
 }
\ No newline at end of file
@@ -7,6 +7,8 @@
 #include <iostream>
 #include "../Common.h"
 #include "../Mesh.h"
+#include "../Bounds.h"
+#include "../InstanceBatch.h"
 
 
 class Entity
@@ -15,13 +17,32 @@ class Entity
 		Entity();
 		Entity(Vector2 position, Mesh* mesh);
 		Entity(Vector2 position, float rotation, Mesh* mesh);
-		~Entity();
-		void Update();
-		virtual void CheckCollisions(std::vector<Entity*> ents) = 0;
-		virtual void Render(GLuint shaderProgram, double frameDelta);
+		Entity(Vector2 position, const float color[3], Mesh* mesh);
+		virtual ~Entity();
+		void Update(const Bounds& world, BoundaryMode boundary, float timestep);
+		void Update(const Bounds& world, BoundaryMode boundary, float timestep, float tickLength);
+		void ResetForce();
+		void ResetForce(Vector2 gravity);
+		void Respawn(Vector2 position, Vector2 velocity, float lifetime);
+		virtual void CheckCollisions(const std::vector<Entity*>& ents, float timestep, float tickLength) = 0;
+		virtual void Render(InstanceBatch* batch, double frameDelta);
+		Mesh* getMesh();
 		float getBounciness();
+		void setBounciness(float bounciness);
+		float getFriction();
+		void setFriction(float friction);
 		bool isKinematic();
 		void setKinematic(bool state);
+		bool isConstrained();
+		void setConstrained(bool state);
+		bool isAlive();
+		void Kill();
+		float getLifetime();
+		void setLifetime(float lifetime);
+		float getAge();
+		void setAge(float age);
+		unsigned int getRateLevel();
+		void setRateLevel(unsigned int level);
 		Vector2 position;
 		Vector2 velocity;
 		Vector2 force;
@@ -31,13 +52,23 @@ class Entity
 		float color[3];
 		EntityType type;
 	protected:
-		Mesh* mesh;
+		Mesh* mesh = nullptr;
 		bool kinematic = false;
+		bool constrained = false;
 		float bounciness = 0.85f;
 		float friction = 0.05f;
 		float deactivation = 0.05f;
+		float lifetime = 0.0f;
+		float age = 0.0f;
+		bool alive = true;
+		unsigned int rateLevel = 0;
+
+		// The rotation's cosine and sine, only recomputed when the rotation changes.
+		float basisRotation = 0.0f;
+		float rotationCos = 1.0f;
+		float rotationSin = 0.0f;
 		virtual void PreUpdate() = 0;
-		virtual void PostUpdate() = 0;
+		virtual void PostUpdate(const Bounds& world, float share) = 0;
 };
 
 class EntityCircle : public Entity
@@ -46,11 +77,14 @@ public:
 	EntityCircle();
 	EntityCircle(Vector2 position, Mesh* mesh);
 	EntityCircle(Vector2 position, float rotation, Mesh* mesh);
+	EntityCircle(Vector2 position, float radius, const float color[3], Mesh* mesh);
 	~EntityCircle();
-	void CheckCollisions(std::vector<Entity*> ents) override;
+	void CheckCollisions(const std::vector<Entity*>& ents, float timestep, float tickLength) override;
+	float getRadius();
+	void setRadius(float radius);
 private:
 	void PreUpdate() override;
-	void PostUpdate() override;
+	void PostUpdate(const Bounds& world, float share) override;
 	int numTriangles = 20;
 	float radius;
 };
@@ -62,12 +96,13 @@ public:
 	EntityBox(Vector2 position, Mesh* mesh);
 	EntityBox(Vector2 position, float rotation, Mesh* mesh);
 	~EntityBox();
-	void CheckCollisions(std::vector<Entity*> ents) override;
+	void CheckCollisions(const std::vector<Entity*>& ents, float timestep, float tickLength) override;
 	float getWidth();
 	float getLength();
+	void setSize(float length, float width);
 private:
 	void PreUpdate() override;
-	void PostUpdate() override;
+	void PostUpdate(const Bounds& world, float share) override;
 	float width = 1.0f;
 	float length = 1.0f;
 };
@@ -23,38 +23,48 @@ EntityBox::EntityBox(Vector2 position, Mesh* mesh) : Entity(position, mesh) {
 EntityBox::EntityBox(Vector2 position, float rotation, Mesh* mesh) : Entity(position, rotation, mesh) {
     length = (rand() % 50) + 200;
     width = (rand() % 10) + 20;
-    rotation = (rand() % 360);
     scale.Set(length, width);
     this->mass = (length * width);
     this->type = BOX;
     this->kinematic = true;
 }
 
+/// <summary>
+/// Box Entity Deconstructor
+/// </summary>
+EntityBox::~EntityBox() {
+
+}
+
 void EntityBox::PreUpdate() {
 
 }
 
-void EntityBox::PostUpdate() {
-    if (this->position.y <= width / 2) {
+/// <summary>
+/// Bounces the box off the walls of the world.
+/// </summary>
+/// <param name="world">The walls of the world.</param>
+void EntityBox::PostUpdate(const Bounds& world, float) {
+    if (this->position.y <= world.min.y + width / 2) {
         this->velocity.y = -this->velocity.y * this->bounciness;
-        this->position.y = width / 2;
+        this->position.y = world.min.y + width / 2;
     }
-    else if (this->position.y > SCREEN_HEIGHT - width / 2) {
+    else if (this->position.y > world.max.y - width / 2) {
         this->velocity.y = -this->velocity.y * this->bounciness;
-        this->position.y = SCREEN_HEIGHT - width / 2;
+        this->position.y = world.max.y - width / 2;
     }
     
-    if (this->position.x < length / 2) {
-        this->position.x = length / 2;
+    if (this->position.x < world.min.x + length / 2) {
+        this->position.x = world.min.x + length / 2;
         this->velocity.x = -this->velocity.x * this->bounciness;
     }
-    else if (this->position.x > SCREEN_WIDTH - length / 2) {
-        this->position.x = SCREEN_WIDTH - length / 2;
+    else if (this->position.x > world.max.x - length / 2) {
+        this->position.x = world.max.x - length / 2;
         this->velocity.x = -this->velocity.x * this->bounciness;
     }
 }
 
-void EntityBox::CheckCollisions(std::vector<Entity*> ents) {
+void EntityBox::CheckCollisions(const std::vector<Entity*>& ents, float, float) {
 
 }
 
@@ -64,4 +74,16 @@ float EntityBox::getWidth() {
 
 float EntityBox::getLength() {
     return this->length;
+}
+
+/// <summary>
+/// Sets the size of the box, updating its scale and mass.
+/// </summary>
+/// <param name="length">The length along the box's x axis.</param>
+/// <param name="width">The width along the box's y axis.</param>
+void EntityBox::setSize(float length, float width) {
+    this->length = length;
+    this->width = width;
+    scale.Set(length, width);
+    this->mass = length * width;
 }
\ No newline at end of file
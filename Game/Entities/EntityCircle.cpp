@@ -33,36 +33,89 @@ EntityCircle::EntityCircle(Vector2 position, float rotation, Mesh* mesh) : Entit
     this->type = CIRCLE;
 }
 
+/// <summary>
+/// Circle Entity constructor given position, radius and colour. Draws nothing from the shared random generator.
+/// </summary>
+/// <param name="position">The position that the entity will spawn.</param>
+/// <param name="radius">The radius of the circle.</param>
+/// <param name="color">The red, green and blue of the circle.</param>
+EntityCircle::EntityCircle(Vector2 position, float radius, const float color[3], Mesh* mesh) : Entity(position, color, mesh) {
+    this->type = CIRCLE;
+    setRadius(radius);
+}
+
+/// <summary>
+/// Circle Entity Deconstructor
+/// </summary>
+EntityCircle::~EntityCircle() {
+
+}
+
+/// <summary>
+/// Returns the radius of the circle.
+/// </summary>
+/// <returns>The radius.</returns>
+float EntityCircle::getRadius() {
+    return this->radius;
+}
+
+/// <summary>
+/// Sets the radius of the circle, updating its scale and mass.
+/// </summary>
+/// <param name="radius">The radius.</param>
+void EntityCircle::setRadius(float radius) {
+    this->radius = radius;
+    scale.Set(radius, radius);
+    this->mass = PI * (radius * radius);
+}
 
 void EntityCircle::PreUpdate() {
 
 }
 
-void EntityCircle::PostUpdate() {
-    if (this->position.y <= radius) {
+/// <summary>
+/// Bounces the circle off the walls of the world.
+/// </summary>
+/// <param name="world">The walls of the world.</param>
+/// <param name="share">The share of a tick the substep covers.</param>
+void EntityCircle::PostUpdate(const Bounds& world, float share) {
+    // Friction takes its share of the speed along a wall the circle moves into, spread over the substeps of a
+    // tick so a circle resting on the floor slows the same however many substeps there are.
+    float keep = powf(1.0f - this->friction, share);
+    if (this->position.y <= world.min.y + radius) {
+        if (this->velocity.y < 0.0f) this->velocity.x *= keep;
         this->velocity.y = -this->velocity.y * this->bounciness;
-        this->position.y = radius;
+        this->position.y = world.min.y + radius;
     }
-    else if (this->position.y > SCREEN_HEIGHT - radius) {
+    else if (this->position.y > world.max.y - radius) {
+        if (this->velocity.y > 0.0f) this->velocity.x *= keep;
         this->velocity.y = -this->velocity.y * this->bounciness;
-        this->position.y = SCREEN_HEIGHT - radius;
+        this->position.y = world.max.y - radius;
     }
-    if (this->position.x < radius) {
-        this->position.x = radius;
+    if (this->position.x < world.min.x + radius) {
+        if (this->velocity.x < 0.0f) this->velocity.y *= keep;
+        this->position.x = world.min.x + radius;
         this->velocity.x = -this->velocity.x * this->bounciness;
     }
-    else if (this->position.x > SCREEN_WIDTH - radius) {
-        this->position.x = SCREEN_WIDTH - radius;
+    else if (this->position.x > world.max.x - radius) {
+        if (this->velocity.x > 0.0f) this->velocity.y *= keep;
+        this->position.x = world.max.x - radius;
         this->velocity.x = -this->velocity.x * this->bounciness;
     }
 }
 
-void EntityCircle::CheckCollisions(std::vector<Entity*> ents) {
-    if (this->kinematic) return;
+/// <summary>
+/// Resolves the circle's collisions with every other entity over one substep.
+/// </summary>
+/// <param name="ents">The entities to collide with.</param>
+/// <param name="timestep">The length of the substep in seconds.</param>
+/// <param name="tickLength">The length of a whole tick in seconds, which friction is spread over.</param>
+void EntityCircle::CheckCollisions(const std::vector<Entity*>& ents, float timestep, float tickLength) {
+    if (this->kinematic || !this->alive) return;
 
     for (int i = 0; i < ents.size(); i++) {
         Entity* ent = ents[i];
-        if (ent == this) continue;
+        if (ent == this || !ent->isAlive()) continue;
         
         if (ent->type == CIRCLE) {
             EntityCircle* col = (EntityCircle*)ent;
@@ -80,7 +133,11 @@ void EntityCircle::CheckCollisions(std::vector<Entity*> ents) {
             if (distance_sqr < sum_radius_sqr) {
                 Vector2 midpoint = Vector2((this->position.x + ent->position.x) * 0.5f, (this->position.y + ent->position.y) * 0.5f);
 
-                this->position.Set(midpoint.x + this->radius * (this->position.x - ent->position.x) / distance, midpoint.y + this->radius * (this->position.y - ent->position.y) / distance);
+                // Circles on exactly the same spot have no direction between them, so push this one out to the left.
+                if (distance > 0.0f)
+                    this->position.Set(midpoint.x + this->radius * (this->position.x - ent->position.x) / distance, midpoint.y + this->radius * (this->position.y - ent->position.y) / distance);
+                else
+                    this->position.Set(midpoint.x - this->radius, midpoint.y);
                 this->velocity.Set(0, 0);
                 //if(!ent->isKinematic())
                 //    ent->position.Set(midpoint.x + col->radius * (ent->position.x - this->position.x) / distance, midpoint.y + col->radius * (ent->position.y - this->position.y) / distance);
@@ -93,30 +150,32 @@ void EntityCircle::CheckCollisions(std::vector<Entity*> ents) {
             float distance_radius = distance - sum_radius;
 
             // Get the velocity relative to the timestep.
-            Vector2 timestepped_velocity = (this->velocity * TIMESTEP);
+            Vector2 timestepped_velocity = (this->velocity * timestep);
 
             // If the velocity is less than the distance between the radii of the two circles, a collision is not occuring.
+            // A circle that isn't moving has no direction to run into anything, and circles on the same spot no normal.
             if (timestepped_velocity.Magnitude() < distance_radius) continue;
+            if (timestepped_velocity.MagnitudeSqr() == 0.0f || distance == 0.0f) continue;
 
             // Calculate whether the velocity is facing the object. If not, return.
             Vector2 normalized = timestepped_velocity.Normalized();
-            double dot = normalized.DotProduct(difference);
-            if (dot <= 0) continue;
+            float dot = normalized.DotProduct(difference);
+            if (dot <= 0.0f) continue;
 
             // Get the magnitude of the difference between the entities position.
-            double d = distance_sqr - (dot * dot);
+            float d = distance_sqr - (dot * dot);
             if (d >= sum_radius_sqr) continue;
 
             // Get the 
-            double T = sum_radius_sqr - d;
-            if (T < 0) continue;
+            float T = sum_radius_sqr - d;
+            if (T < 0.0f) continue;
 
             // Therefore the distance the circle has to travel along
             // movevec is D - sqrt(T)
-            double velocity_length = dot - sqrt(T);
+            float velocity_length = dot - sqrtf(T);
 
             // Get the magnitude of the movement vector
-            double mag = timestepped_velocity.Magnitude();
+            float mag = timestepped_velocity.Magnitude();
 
             // Ensure that the distance required is not bigger than the magnitude of the velocity vector.
             if (mag < distance_radius) continue;
@@ -125,8 +184,10 @@ void EntityCircle::CheckCollisions(std::vector<Entity*> ents) {
             Vector2 normal = difference / distance;
             Vector2 tangent = Vector2(-normal.y, normal.x);
 
-            float dotTan1 = this->velocity.DotProduct(tangent);
-            float dotTan2 = ent->velocity.DotProduct(tangent);
+            // The circle is moving into the other entity, so friction applies, spread over the substeps of a tick.
+            float share = timestep / tickLength;
+            float dotTan1 = this->velocity.DotProduct(tangent) * powf(1.0f - this->friction, share);
+            float dotTan2 = ent->velocity.DotProduct(tangent) * powf(1.0f - ent->getFriction(), share);
 
             float dotNormal1 = this->velocity.DotProduct(normal);
             float dotNormal2 = 0;
@@ -153,12 +214,13 @@ void EntityCircle::CheckCollisions(std::vector<Entity*> ents) {
             float cos = std::cosf(angleRadians);
             float sin = std::sinf(angleRadians);
 
-            float unrotatedCircleX = cos * (this->position.x - ent->position.x) - sin * (this->position.y - ent->position.y) + ent->position.x;
-            float unrotatedCircleY = sin * (this->position.x - ent->position.x) + cos * (this->position.y - ent->position.y) + ent->position.y;
+            // Rotate the circle back by the box's rotation, into the frame where the box is axis aligned.
+            float unrotatedCircleX = cos * (this->position.x - ent->position.x) + sin * (this->position.y - ent->position.y) + ent->position.x;
+            float unrotatedCircleY = -sin * (this->position.x - ent->position.x) + cos * (this->position.y - ent->position.y) + ent->position.y;
 
             // temporary variables to set edges for testing
-            float testX = this->position.x;
-            float testY = this->position.y;
+            float testX = unrotatedCircleX;
+            float testY = unrotatedCircleY;
 
             // which edge is closest?
             if (unrotatedCircleX < ent->position.x - col->getLength() * 0.5f) testX = ent->position.x - col->getLength() * 0.5f;      // test left edge
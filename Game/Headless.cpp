@@ -0,0 +1,517 @@
+/*
+Runs the bulk simulation core without a window, on particle storage in the
+precision picked by Real, and reports its throughput. Also benchmarks the
+integrators by the energy they lose against the CPU time they take.
+*/
+
+#include "Headless.h"
+#include "ParticleStorage.h"
+#include "Physics/BatchIntegrator.h"
+#include "Physics/Integrators.h"
+#include "Physics/EventDrivenSolver.h"
+#include "Physics/FluidSolver.h"
+#include "IO/Snapshot.h"
+#include "IO/TrajectoryRecorder.h"
+#include "IO/Checkpointer.h"
+#include "IO/SceneLoader.h"
+#include "IO/SharedState.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <random>
+
+// Radius and mass of every particle in a headless run.
+const float HEADLESS_RADIUS = 2.0f;
+const float HEADLESS_MASS = 1.0f;
+
+// Fraction of speed kept on hitting a wall, the same as an Entity's default.
+const float HEADLESS_BOUNCINESS = 0.85f;
+
+// The share of the world's width and height the dam break's column starts in, as in the interactive dam break,
+// and the fraction of speed fluid keeps on hitting a wall.
+const double DAM_WIDTH = 0.4;
+const double DAM_HEIGHT = 0.8;
+const float DAM_BOUNCINESS = 0.1f;
+
+// The largest share of the world's area the event-driven gas covers. A denser gas is a liquid, where
+// particles collide far more often than they travel, so the world is grown to keep it below this.
+const double GAS_PACKING = 0.05;
+
+// The benchmark's central mass, its softening length, and how long each run simulates.
+const double BENCHMARK_GM = 1.0e6;
+const double BENCHMARK_SOFTENING = 10.0;
+const double BENCHMARK_DURATION = 10.0;
+
+// Uniform gravity as a force, for the integrator policies.
+template<typename T>
+struct UniformGravity {
+    T x;
+    T y;
+
+    void operator()(ParticleStorage<T>& particles) {
+        ParallelFor(particles.getCount(), KERNEL_GRAIN, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                T inverseMass = particles.inverseMass[i];
+                if (inverseMass == T(0)) continue;
+                particles.forceX[i] += x / inverseMass;
+                particles.forceY[i] += y / inverseMass;
+            }
+        });
+    }
+};
+
+// A softened point mass at a fixed centre. Conservative, so any change in energy is integration error.
+template<typename T>
+struct CentralGravity {
+    T centerX;
+    T centerY;
+    T gm;
+    T softening;
+    unsigned long long evaluations = 0;
+
+    void operator()(ParticleStorage<T>& particles) {
+        evaluations++;
+        ParallelFor(particles.getCount(), KERNEL_GRAIN, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                T inverseMass = particles.inverseMass[i];
+                if (inverseMass == T(0)) continue;
+                T dx = particles.positionX[i] - centerX;
+                T dy = particles.positionY[i] - centerY;
+                T distSqr = dx * dx + dy * dy + softening * softening;
+                T scale = -gm / (distSqr * std::sqrt(distSqr) * inverseMass);
+                particles.forceX[i] += dx * scale;
+                particles.forceY[i] += dy * scale;
+            }
+        });
+    }
+
+    double Energy(const ParticleStorage<T>& particles) {
+        double total = 0.0;
+        for (size_t i = 0; i < particles.getCount(); i++) {
+            double mass = 1.0 / particles.inverseMass[i];
+            double dx = particles.positionX[i] - centerX;
+            double dy = particles.positionY[i] - centerY;
+            double speedSqr = (double)particles.velocityX[i] * particles.velocityX[i] + (double)particles.velocityY[i] * particles.velocityY[i];
+            total += mass * (0.5 * speedSqr - gm / std::sqrt(dx * dx + dy * dy + softening * softening));
+        }
+        return total;
+    }
+};
+
+/// <summary>
+/// Reads an integrator's name.
+/// </summary>
+/// <param name="name">One of batch, euler, verlet, leapfrog or rk4.</param>
+/// <param name="integrator">Receives the integrator.</param>
+/// <returns>False if the name is unknown.</returns>
+bool ParseIntegrator(const std::string& name, IntegratorType& integrator) {
+    if (name == "batch") integrator = BATCH;
+    else if (name == "euler") integrator = SYMPLECTIC_EULER;
+    else if (name == "verlet") integrator = VELOCITY_VERLET;
+    else if (name == "leapfrog") integrator = LEAPFROG;
+    else if (name == "rk4") integrator = RUNGE_KUTTA_4;
+    else return false;
+    return true;
+}
+
+// Called after every tick of a run with the particles and the index of the tick in the run.
+typedef std::function<void(const ParticleView<Real>&, unsigned int)> TickCallback;
+
+/// <summary>
+/// The tick loop for an integrator policy, instantiated once per policy.
+/// </summary>
+template<template<typename> class Integrator>
+void RunTicks(ParticleStorage<Real>& particles, const HeadlessOptions& options, Vector2T<Real> gravity, const TickCallback& afterTick) {
+    Integrator<Real> integrator;
+    UniformGravity<Real> forces = { gravity.x, gravity.y };
+    integrator.Prepare(particles, forces);
+    for (unsigned int tick = 0; tick < options.ticks; tick++) {
+        integrator.Step(particles, forces, (Real)TIMESTEP);
+        Kernels<Real>::Confine(particles, options.world, options.boundary, HEADLESS_BOUNCINESS);
+        afterTick(particles.getView(), tick);
+    }
+}
+
+/// <summary>
+/// Returns the seconds since a point in time.
+/// </summary>
+static double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// <summary>
+/// Steps particles for a number of ticks and reports the rate. The particles are either scattered over
+/// the world at random speeds, or mapped from a snapshot or the latest checkpoint and stepped in place.
+/// Optionally records every tick, publishes ticks to shared memory, takes checkpoints along the way and saves the particles after.
+/// </summary>
+/// <param name="options">The size and length of the run.</param>
+/// <returns>The process exit code.</returns>
+int RunHeadless(const HeadlessOptions& options) {
+    HeadlessOptions run = options;
+    ParticleStorage<Real> storage;
+    ParticleView<Real> particles;
+    Snapshot snapshot;
+    uint64_t startTick = 0;
+    std::string loadPath = options.loadPath;
+
+    // Resuming starts from the latest whole checkpoint, and runs on to the same last tick as the run that took it.
+    bool resumed = false;
+    if (options.resume && options.checkpointPath.empty()) {
+        std::cout << "Resuming needs a checkpoint path" << std::endl;
+        return 1;
+    }
+    if (options.resume) {
+        uint64_t checkpointTick = 0;
+        resumed = Checkpointer::FindLatest(options.checkpointPath, loadPath, checkpointTick);
+        if (resumed) std::cout << "Resuming from " << loadPath << " at tick " << checkpointTick << std::endl;
+        else std::cout << "No checkpoint at " << options.checkpointPath << ", starting a new run" << std::endl;
+    }
+
+    if (!loadPath.empty()) {
+        // The columns are used straight from the mapping. Pages are only copied as the run first writes to them.
+        auto loadStart = std::chrono::steady_clock::now();
+        if (!snapshot.Open(loadPath, true)) {
+            std::cout << snapshot.getError() << std::endl;
+            return 1;
+        }
+        if (!snapshot.getView(particles)) {
+            std::cout << loadPath << " has no particle columns of " << sizeof(Real) * 8 << "-bit scalars" << std::endl;
+            return 1;
+        }
+        run.world = snapshot.getWorld();
+        run.boundary = (BoundaryMode)snapshot.getHeader()->boundary;
+        run.particles = (unsigned int)particles.getCount();
+        startTick = snapshot.getHeader()->tick;
+        if (resumed) run.ticks = startTick < options.ticks ? options.ticks - (unsigned int)startTick : 0;
+        std::cout << "Mapped " << particles.getCount() << " particles from " << loadPath << " in " << SecondsSince(loadStart) << " s" << std::endl;
+
+        // The integrator policies work on particle storage, so they need their own copy. So does a run that takes
+        // checkpoints: the slot it loaded from can't be replaced while it is mapped on Windows, so the mapping is closed.
+        if (options.integrator != BATCH || !options.checkpointPath.empty()) {
+            storage.Assign(particles);
+            particles = storage.getView();
+        }
+        if (!options.checkpointPath.empty()) snapshot.Close();
+    }
+    else if (!options.scenePath.empty()) {
+        // Only the particles of a scene are stepped here. Obstacles, emitters and absorbers need the window.
+        auto loadStart = std::chrono::steady_clock::now();
+        SceneDescription scene;
+        std::string error;
+        if (!LoadSceneFile(options.scenePath, scene, error)) {
+            std::cout << error << std::endl;
+            return 1;
+        }
+        BuildSceneParticles(scene, storage);
+        particles = storage.getView();
+        run.world = scene.world;
+        run.boundary = scene.boundary;
+        run.particles = (unsigned int)particles.getCount();
+        std::cout << "Built " << particles.getCount() << " particles from " << options.scenePath << " in " << SecondsSince(loadStart) << " s" << std::endl;
+        if (!scene.boxes.empty() || !scene.emitters.empty() || !scene.absorbers.empty()) {
+            std::cout << "Headless runs skip the scene's boxes, emitters and absorbers" << std::endl;
+        }
+    }
+    else {
+        storage.Reserve(options.particles);
+        std::mt19937 random(1);
+        std::uniform_real_distribution<Real> spreadX(options.world.min.x + HEADLESS_RADIUS, options.world.max.x - HEADLESS_RADIUS);
+        std::uniform_real_distribution<Real> spreadY(options.world.min.y + HEADLESS_RADIUS, options.world.max.y - HEADLESS_RADIUS);
+        std::uniform_real_distribution<Real> speed(-100, 100);
+        for (unsigned int i = 0; i < options.particles; i++) {
+            storage.Add(Vector2T<Real>(spreadX(random), spreadY(random)), Vector2T<Real>(speed(random), speed(random)), HEADLESS_RADIUS, HEADLESS_MASS);
+        }
+        particles = storage.getView();
+    }
+
+    // The interactive mode adds GRAVITY to the velocity every tick, so as an acceleration it is GRAVITY per timestep.
+    Vector2T<Real> gravity(0, GRAVITY / TIMESTEP);
+
+    // Every tick is handed to the recorder's writer thread, so recording only costs the copy. There is no frame
+    // rate to keep up here, so the run waits for a free buffer rather than drop a frame.
+    TrajectoryRecorder recorder;
+    recorder.setBlocking(true);
+    if (!options.recordPath.empty()) {
+        if (!recorder.Open(options.recordPath, run.world, RECORD_BUFFERS, RECORD_KEYFRAME_INTERVAL, RECORD_POSITION_QUANTUM, RECORD_VELOCITY_QUANTUM)) {
+            std::cout << "Could not record to " << options.recordPath << std::endl;
+            return 1;
+        }
+    }
+
+    // Checkpoints are likewise written in the background, on ticks that are a multiple of the interval.
+    std::unique_ptr<Checkpointer> checkpointer;
+    if (!options.checkpointPath.empty() && options.checkpointInterval > 0) {
+        checkpointer.reset(new Checkpointer(options.checkpointPath));
+    }
+
+    // Published frames go straight into shared memory and never wait on a viewer, so publishing only costs the copy.
+    SharedStatePublisher publisher;
+    if (!options.publishName.empty()) {
+        if (!publisher.Create(options.publishName, particles.getCount(), SHARED_STATE_SLOTS, run.world, run.boundary)) {
+            std::cout << "Could not publish to shared memory as " << options.publishName << std::endl;
+            return 1;
+        }
+        std::cout << "Publishing every " << std::max(options.publishInterval, 1u) << " ticks as " << options.publishName << std::endl;
+    }
+
+    TickCallback afterTick = [&](const ParticleView<Real>& view, unsigned int tick) {
+        uint64_t now = startTick + tick + 1;
+        if (recorder.isOpen()) recorder.Record(view, now);
+        if (checkpointer && now % options.checkpointInterval == 0) checkpointer->Take(view, run.world, run.boundary, now);
+        if (publisher.isOpen() && now % std::max(options.publishInterval, 1u) == 0) publisher.Publish(view, now);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    switch (run.integrator) {
+    case BATCH: {
+        BatchIntegrator<Real> integrator(gravity, HEADLESS_BOUNCINESS);
+        for (unsigned int tick = 0; tick < run.ticks; tick++) {
+            integrator.Step(particles, run.world, run.boundary, TIMESTEP);
+            afterTick(particles, tick);
+        }
+        break;
+    }
+    case SYMPLECTIC_EULER: RunTicks<SymplecticEuler>(storage, run, gravity, afterTick); break;
+    case VELOCITY_VERLET: RunTicks<VelocityVerlet>(storage, run, gravity, afterTick); break;
+    case LEAPFROG: RunTicks<Leapfrog>(storage, run, gravity, afterTick); break;
+    case RUNGE_KUTTA_4: RunTicks<RungeKutta4>(storage, run, gravity, afterTick); break;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // The batch pass reads eight fields of every particle and writes six.
+    double steps = (double)run.particles * run.ticks;
+    double bytes = steps * 14.0 * sizeof(Real);
+    std::cout << run.particles << " particles, " << run.ticks << " ticks in " << seconds << " s | "
+        << steps / seconds / 1e6 << " M particle steps/s";
+    if (run.integrator == BATCH) std::cout << " | " << bytes / seconds / 1e9 << " GB/s";
+    std::cout << std::endl;
+
+    if (checkpointer) {
+        checkpointer->Finish();
+        std::cout << "Wrote " << checkpointer->getWrittenCount() << " checkpoints (" << checkpointer->getSkippedCount() << " skipped)";
+        if (checkpointer->getWrittenCount() > 0) std::cout << ", the last at tick " << checkpointer->getLastTick();
+        std::cout << std::endl;
+    }
+
+    if (publisher.isOpen()) {
+        std::cout << "Published " << publisher.getPublishedCount() << " frames as " << options.publishName << std::endl;
+        publisher.Close();
+    }
+
+    if (recorder.isOpen()) {
+        auto closeStart = std::chrono::steady_clock::now();
+        recorder.Close();
+        std::cout << "Recorded " << recorder.getRecordedFrames() << " frames (" << recorder.getDroppedFrames() << " dropped) to "
+            << options.recordPath << " | " << recorder.getBytesWritten() / 1e6 << " MB, "
+            << (double)recorder.getBytesWritten() / std::max<uint64_t>(recorder.getRecordedFrames() * run.particles, 1) << " bytes/particle"
+            << " | drained in " << SecondsSince(closeStart) << " s" << std::endl;
+    }
+
+    if (!options.savePath.empty()) {
+        auto saveStart = std::chrono::steady_clock::now();
+        if (!SaveParticles(options.savePath, particles, run.world, run.boundary, startTick + run.ticks)) {
+            std::cout << "Could not save " << options.savePath << std::endl;
+            return 1;
+        }
+        std::cout << "Saved " << particles.getCount() << " particles to " << options.savePath << " in " << SecondsSince(saveStart) << " s" << std::endl;
+    }
+    return 0;
+}
+
+/// <summary>
+/// Breaks a dam of SPH fluid without a window and reports the rate. The column fills the lower left of
+/// the world as in the interactive dam break, and the world is scaled up, keeping its shape, until the
+/// column holds the requested number of particles.
+/// </summary>
+/// <param name="options">The number of particles, the ticks to run and the world.</param>
+/// <returns>The process exit code.</returns>
+int RunDamBreak(const HeadlessOptions& options) {
+    Real spacing = FLUID_PARTICLE_RADIUS * 2.0f;
+    double spanX = (double)options.world.max.x - options.world.min.x;
+    double spanY = (double)options.world.max.y - options.world.min.y;
+    double scale = std::fmax(std::sqrt((double)options.particles * spacing * spacing / (DAM_WIDTH * DAM_HEIGHT * spanX * spanY)), 1.0);
+    Bounds tank(options.world.min, options.world.min + Vector2((float)(spanX * scale), (float)(spanY * scale)));
+
+    unsigned int columns = (unsigned int)std::fmax(std::floor(spanX * scale * DAM_WIDTH / spacing), 1.0);
+    ParticleStorage<Real> storage;
+    storage.Reserve(options.particles);
+    for (unsigned int i = 0; i < options.particles; i++) {
+        Vector2T<Real> position(tank.min.x + (i % columns + 0.5) * spacing, tank.min.y + (i / columns + 0.5) * spacing);
+        storage.Add(position, Vector2T<Real>(0, 0), FLUID_PARTICLE_RADIUS, (Real)(PI * FLUID_PARTICLE_RADIUS * FLUID_PARTICLE_RADIUS));
+    }
+    ParticleView<Real> particles = storage.getView();
+    std::cout << "Dam of " << columns << " x " << (options.particles + columns - 1) / columns << " particles in a "
+        << tank.max.x - tank.min.x << " x " << tank.max.y - tank.min.y << " tank" << std::endl;
+
+    SharedStatePublisher publisher;
+    if (!options.publishName.empty()) {
+        if (!publisher.Create(options.publishName, particles.getCount(), SHARED_STATE_SLOTS, tank, REFLECTING)) {
+            std::cout << "Could not publish to shared memory as " << options.publishName << std::endl;
+            return 1;
+        }
+    }
+
+    FluidSolver fluid(FLUID_KERNEL_RADIUS, FLUID_REST_DENSITY, FLUID_STIFFNESS, FLUID_VISCOSITY);
+    BatchIntegrator<Real> integrator(Vector2T<Real>(0, GRAVITY / TIMESTEP), DAM_BOUNCINESS);
+    double fluidSeconds = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int tick = 0; tick < options.ticks; tick++) {
+        auto fluidStart = std::chrono::steady_clock::now();
+        fluid.ApplyForces(particles);
+        fluidSeconds += SecondsSince(fluidStart);
+        integrator.Step(particles, tank, REFLECTING, TIMESTEP);
+        fluid.Separate(particles, (Real)TIMESTEP);
+        Kernels<Real>::Confine(storage, tank, REFLECTING, DAM_BOUNCINESS);
+        if (publisher.isOpen() && (tick + 1) % std::max(options.publishInterval, 1u) == 0) publisher.Publish(particles, tick + 1);
+    }
+    double seconds = SecondsSince(start);
+
+    // How far the front has run along the floor shows the dam actually broke.
+    Real front = tank.min.x;
+    for (size_t i = 0; i < particles.getCount(); i++) {
+        front = std::max(front, particles.positionX[i]);
+    }
+
+    double steps = (double)options.particles * options.ticks;
+    std::cout << options.particles << " particles, " << options.ticks << " ticks in " << seconds << " s | "
+        << seconds * 1000.0 / std::max(options.ticks, 1u) << " ms/tick (" << fluidSeconds / std::fmax(seconds, 1e-9) * 100.0 << "% SPH forces) | "
+        << steps / seconds / 1e6 << " M particle steps/s | " << ThreadPool::Instance().getThreadCount() << " threads" << std::endl;
+    std::cout << "front at " << (front - tank.min.x) / (tank.max.x - tank.min.x) * 100.0 << "% of the tank | average density "
+        << fluid.getAverageDensity() << " (rest " << FLUID_REST_DENSITY << ")" << std::endl;
+    return 0;
+}
+
+/// <summary>
+/// Runs one integrator over the benchmark orbits at one timestep and prints its energy drift and CPU time.
+/// </summary>
+template<template<typename> class Integrator>
+void BenchmarkIntegrator(const ParticleStorage<Real>& initial, CentralGravity<Real> gravity, double timestep) {
+    ParticleStorage<Real> particles = initial;
+    Integrator<Real> integrator;
+    double startEnergy = gravity.Energy(particles);
+    unsigned int steps = (unsigned int)(BENCHMARK_DURATION / timestep + 0.5);
+
+    auto start = std::chrono::steady_clock::now();
+    integrator.Prepare(particles, gravity);
+    for (unsigned int step = 0; step < steps; step++) {
+        integrator.Step(particles, gravity, (Real)timestep);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double drift = std::fabs(gravity.Energy(particles) - startEnergy) / std::fabs(startEnergy);
+
+    std::cout << std::left << std::setw(18) << Integrator<Real>::getName()
+        << std::setw(12) << timestep
+        << std::setw(10) << steps
+        << std::setw(14) << gravity.evaluations
+        << std::setw(14) << seconds
+        << std::setw(14) << drift
+        << drift * seconds << std::endl;
+}
+
+/// <summary>
+/// Puts particles on orbits of varying eccentricity around a central mass and compares how much
+/// energy each integrator loses over the same simulated time, against the CPU time it takes.
+/// </summary>
+/// <param name="particles">The number of orbiting particles.</param>
+/// <returns>The process exit code.</returns>
+int RunIntegratorBenchmark(unsigned int particles) {
+    CentralGravity<Real> gravity;
+    gravity.centerX = 0;
+    gravity.centerY = 0;
+    gravity.gm = (Real)BENCHMARK_GM;
+    gravity.softening = (Real)BENCHMARK_SOFTENING;
+
+    ParticleStorage<Real> initial(particles);
+    std::mt19937 random(1);
+    std::uniform_real_distribution<double> orbitRadius(50.0, 250.0);
+    std::uniform_real_distribution<double> angle(0.0, 2.0 * PI);
+    std::uniform_real_distribution<double> eccentricity(0.7, 1.1);
+    for (unsigned int i = 0; i < particles; i++) {
+        double r = orbitRadius(random);
+        double theta = angle(random);
+        double softened = r * r + BENCHMARK_SOFTENING * BENCHMARK_SOFTENING;
+        double circular = std::sqrt(BENCHMARK_GM * r * r / (softened * std::sqrt(softened)));
+        double speed = circular * eccentricity(random);
+        initial.Add(Vector2T<Real>((Real)(r * std::cos(theta)), (Real)(r * std::sin(theta))),
+            Vector2T<Real>((Real)(-speed * std::sin(theta)), (Real)(speed * std::cos(theta))), HEADLESS_RADIUS, HEADLESS_MASS);
+    }
+
+    std::cout << particles << " orbits over " << BENCHMARK_DURATION << " s, " << sizeof(Real) * 8 << "-bit" << std::endl;
+    std::cout << std::left << std::setw(18) << "integrator" << std::setw(12) << "timestep" << std::setw(10) << "steps"
+        << std::setw(14) << "evaluations" << std::setw(14) << "cpu seconds" << std::setw(14) << "energy drift" << "drift x cpu" << std::endl;
+
+    const double timesteps[] = { 1.0 / 15.0, 1.0 / 30.0, 1.0 / 60.0, 1.0 / 120.0, 1.0 / 240.0 };
+    for (double timestep : timesteps) {
+        BenchmarkIntegrator<SymplecticEuler>(initial, gravity, timestep);
+        BenchmarkIntegrator<VelocityVerlet>(initial, gravity, timestep);
+        BenchmarkIntegrator<Leapfrog>(initial, gravity, timestep);
+        BenchmarkIntegrator<RungeKutta4>(initial, gravity, timestep);
+    }
+    return 0;
+}
+
+/// <summary>
+/// Fills the world with a dilute hard-sphere gas, growing the world if the particles would crowd it, runs it
+/// event by event and reports the work done against what the pairwise loop would have done over the same time.
+/// </summary>
+/// <param name="options">The number of particles and the world they fill.</param>
+/// <param name="duration">The simulated time in seconds.</param>
+/// <returns>The process exit code.</returns>
+int RunEventDriven(const HeadlessOptions& options, double duration) {
+    double spanX = (double)options.world.max.x - options.world.min.x;
+    double spanY = (double)options.world.max.y - options.world.min.y;
+    double packing = options.particles * PI * HEADLESS_RADIUS * HEADLESS_RADIUS / (spanX * spanY);
+    double scale = std::fmax(std::sqrt(packing / GAS_PACKING), 1.0);
+    spanX *= scale;
+    spanY *= scale;
+    Bounds world(options.world.min, options.world.min + Vector2((float)spanX, (float)spanY));
+
+    // Start the particles on a jittered lattice so none overlap. The lattice has at least a cell per
+    // particle, and its spacing is small enough for every row and column to fit in the world.
+    unsigned int columns = (unsigned int)std::ceil(std::sqrt(options.particles * spanX / spanY));
+    unsigned int rows = (options.particles + columns - 1) / columns;
+    double spacing = std::fmin(spanX / columns, spanY / rows);
+    if (spacing <= 2.0 * HEADLESS_RADIUS) {
+        std::cout << "The world is too small to hold " << options.particles << " particles without overlap." << std::endl;
+        return 1;
+    }
+    std::cout << "Gas of " << options.particles << " particles covering " << packing / (scale * scale) * 100.0 << "% of a "
+        << spanX << " x " << spanY << " world" << std::endl;
+
+    // Cells about the mean spacing wide hold around one particle each, balancing pair tests against cell crossings.
+    EventDrivenSolver solver(world, spacing);
+    std::mt19937 random(1);
+    std::uniform_real_distribution<double> jitter(-0.5, 0.5);
+    std::uniform_real_distribution<double> speed(-100.0, 100.0);
+    double slack = (spacing - 2.0 * HEADLESS_RADIUS) * 0.5;
+    for (unsigned int i = 0; i < options.particles; i++) {
+        double x = world.min.x + (i % columns + 0.5) * spacing + jitter(random) * slack;
+        double y = world.min.y + (i / columns + 0.5) * spacing + jitter(random) * slack;
+        solver.Add(Vector2d(x, y), Vector2d(speed(random), speed(random)), HEADLESS_RADIUS, HEADLESS_MASS);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    solver.Initialise();
+    double startEnergy = solver.KineticEnergy();
+    solver.AdvanceTo(duration);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint32_t maxEvents = 0;
+    for (size_t i = 0; i < solver.getCount(); i++) {
+        maxEvents = std::max(maxEvents, solver.getEventCount(i));
+    }
+    unsigned long long events = solver.getCollisionCount() + solver.getWallCount();
+    double pairwiseTests = (double)options.particles * (options.particles - 1) * std::ceil(duration / TIMESTEP);
+
+    std::cout << options.particles << " particles over " << duration << " s in " << seconds << " s" << std::endl;
+    std::cout << "collisions: " << solver.getCollisionCount() << " | wall bounces: " << solver.getWallCount()
+        << " | cell crossings: " << solver.getCellCrossingCount() << " | stale: " << solver.getStaleCount() << std::endl;
+    std::cout << "events per particle: " << (double)events * 2.0 / options.particles << " mean, " << maxEvents << " max" << std::endl;
+    std::cout << "pair tests: " << solver.getPairTestCount() << " against " << pairwiseTests << " for the pairwise loop at "
+        << 1.0 / TIMESTEP << " ticks/s (" << pairwiseTests / std::fmax((double)solver.getPairTestCount(), 1.0) << "x fewer)" << std::endl;
+    std::cout << "energy drift: " << std::fabs(solver.KineticEnergy() - startEnergy) / startEnergy << std::endl;
+    return 0;
+}
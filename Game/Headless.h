@@ -0,0 +1,53 @@
+#pragma once
+
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include "Bounds.h"
+#include "Common.h"
+#include <string>
+
+// The time integrator of a headless run. BATCH is the fused AVX2 Euler pass with the walls built in.
+enum IntegratorType {
+	BATCH,
+	SYMPLECTIC_EULER,
+	VELOCITY_VERLET,
+	LEAPFROG,
+	RUNGE_KUTTA_4
+};
+
+// Options for a run without a window.
+struct HeadlessOptions {
+	unsigned int particles = 1000000;
+	unsigned int ticks = 600;
+	Bounds world;
+	BoundaryMode boundary = REFLECTING;
+	IntegratorType integrator = BATCH;
+
+	// Snapshots to start from and to save at the end. Empty for none.
+	std::string loadPath;
+	std::string savePath;
+
+	// A scene file to fill the particles from instead of scattering them. Empty for none.
+	std::string scenePath;
+
+	// Trajectory recording of every tick. Empty for none.
+	std::string recordPath;
+
+	// Checkpoints every interval ticks, and whether to resume from the latest one. Empty for none.
+	std::string checkpointPath;
+	unsigned int checkpointInterval = CHECKPOINT_INTERVAL;
+	bool resume = false;
+
+	// Shared memory to publish the particles to every interval ticks, for viewers in other processes. Empty for none.
+	std::string publishName;
+	unsigned int publishInterval = 1;
+};
+
+bool ParseIntegrator(const std::string& name, IntegratorType& integrator);
+int RunHeadless(const HeadlessOptions& options);
+int RunIntegratorBenchmark(unsigned int particles);
+int RunEventDriven(const HeadlessOptions& options, double duration);
+int RunDamBreak(const HeadlessOptions& options);
+
+#endif
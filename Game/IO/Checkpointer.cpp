@@ -0,0 +1,172 @@
+/*
+Asynchronous checkpoints. The only work on the simulation thread is a parallel
+copy of the particle columns into the back buffer. If the previous checkpoint
+is still being written when the next one is due, that checkpoint is skipped
+rather than waited for.
+*/
+
+#include "Checkpointer.h"
+#include <stdio.h>
+
+/// <summary>
+/// Checkpointer Constructor. Starts the writer, which overwrites the older of the two slots first.
+/// </summary>
+/// <param name="path">The path the slots are named after.</param>
+Checkpointer::Checkpointer(const std::string& path) {
+	this->path = path;
+	for (int i = 0; i < 2; i++) {
+		Snapshot snapshot;
+		if (snapshot.Open(getSlotPath(path, i), false)) slotTicks[i] = snapshot.getHeader()->tick;
+	}
+	this->slot = slotTicks[0] <= slotTicks[1] ? 0 : 1;
+	writer = std::thread(&Checkpointer::WriterLoop, this);
+}
+
+/// <summary>
+/// Checkpointer Deconstructor. Finishes the checkpoint being written.
+/// </summary>
+Checkpointer::~Checkpointer() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	writer.join();
+}
+
+/// <summary>
+/// Copies the particles into the back buffer for the writer. Never waits on the writer.
+/// </summary>
+/// <param name="particles">The particles.</param>
+/// <param name="world">The world the particles are in.</param>
+/// <param name="boundary">The boundary mode of the world.</param>
+/// <param name="tick">The tick the particles are at.</param>
+/// <returns>False if the checkpoint was skipped because the last one is still being written.</returns>
+bool Checkpointer::Take(const ParticleView<Real>& particles, const Bounds& world, BoundaryMode boundary, uint64_t tick) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (pending) {
+			skippedCount++;
+			return false;
+		}
+	}
+
+	// The writer is idle, so the buffer is free to fill without the lock.
+	buffer.Resize(particles.getCount());
+	ParticleView<Real> copy = buffer.getView();
+	const Real* sources[] = { particles.positionX, particles.positionY, particles.velocityX, particles.velocityY,
+		particles.forceX, particles.forceY, particles.inverseMass, particles.radius };
+	Real* destinations[] = { copy.positionX, copy.positionY, copy.velocityX, copy.velocityY,
+		copy.forceX, copy.forceY, copy.inverseMass, copy.radius };
+	for (int column = 0; column < 8; column++) {
+		const Real* source = sources[column];
+		Real* destination = destinations[column];
+		ParallelFor(particles.getCount(), 1 << 18, [&](size_t begin, size_t end) {
+			memcpy(destination + begin, source + begin, (end - begin) * sizeof(Real));
+		});
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->world = world;
+		this->boundary = boundary;
+		this->tick = tick;
+		pending = true;
+	}
+	wake.notify_one();
+	return true;
+}
+
+/// <summary>
+/// Waits for the checkpoint being written.
+/// </summary>
+void Checkpointer::Finish() {
+	std::unique_lock<std::mutex> lock(mutex);
+	idle.wait(lock, [this] { return !pending; });
+}
+
+/// <summary>
+/// Writes checkpoints as they are taken until the checkpointer is destroyed.
+/// </summary>
+void Checkpointer::WriterLoop() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		wake.wait(lock, [this] { return stopping || pending; });
+		if (!pending) return;
+		lock.unlock();
+
+		// Write beside the slot, then swap it in, so the slot only ever holds a whole checkpoint.
+		std::string slotPath = getSlotPath(path, slot);
+		std::string temporaryPath = slotPath + ".tmp";
+		bool written = SaveParticles(temporaryPath, buffer.getView(), world, boundary, tick);
+		if (written) {
+			remove(slotPath.c_str());
+			written = rename(temporaryPath.c_str(), slotPath.c_str()) == 0;
+		}
+
+		lock.lock();
+		if (written) {
+			slotTicks[slot] = tick;
+			slot = 1 - slot;
+			writtenCount++;
+			lastTick = tick;
+		}
+		else {
+			skippedCount++;
+		}
+		pending = false;
+		idle.notify_all();
+	}
+}
+
+/// <summary>
+/// Returns the number of checkpoints written.
+/// </summary>
+uint64_t Checkpointer::getWrittenCount() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return writtenCount;
+}
+
+/// <summary>
+/// Returns the number of checkpoints skipped, or that failed to write.
+/// </summary>
+uint64_t Checkpointer::getSkippedCount() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return skippedCount;
+}
+
+/// <summary>
+/// Returns the tick of the last checkpoint written.
+/// </summary>
+uint64_t Checkpointer::getLastTick() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return lastTick;
+}
+
+/// <summary>
+/// Finds the latest checkpoint that opens as a whole snapshot.
+/// </summary>
+/// <param name="path">The path the slots are named after.</param>
+/// <param name="latest">Receives the path of the checkpoint.</param>
+/// <param name="tick">Receives the tick of the checkpoint.</param>
+/// <returns>Whether any checkpoint was found.</returns>
+bool Checkpointer::FindLatest(const std::string& path, std::string& latest, uint64_t& tick) {
+	bool found = false;
+	for (int i = 0; i < 2; i++) {
+		Snapshot snapshot;
+		if (!snapshot.Open(getSlotPath(path, i), false)) continue;
+		if (!found || snapshot.getHeader()->tick > tick) {
+			latest = getSlotPath(path, i);
+			tick = snapshot.getHeader()->tick;
+			found = true;
+		}
+	}
+	return found;
+}
+
+/// <summary>
+/// Returns the path of a checkpoint slot.
+/// </summary>
+std::string Checkpointer::getSlotPath(const std::string& path, int slot) {
+	return path + "." + std::to_string(slot);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#ifndef CHECKPOINTER_H
+#define CHECKPOINTER_H
+
+#include "Snapshot.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Takes periodic checkpoints of a run without pausing it. The simulation thread copies the
+// particles into a back buffer and carries on, while a writer thread saves the buffer as a
+// snapshot. Checkpoints alternate between two slots, each written to a temporary file and
+// renamed into place, so a crash part way through a write always leaves the other slot whole.
+class Checkpointer
+{
+public:
+	Checkpointer(const std::string& path);
+	~Checkpointer();
+	bool Take(const ParticleView<Real>& particles, const Bounds& world, BoundaryMode boundary, uint64_t tick);
+	void Finish();
+	uint64_t getWrittenCount();
+	uint64_t getSkippedCount();
+	uint64_t getLastTick();
+	static bool FindLatest(const std::string& path, std::string& latest, uint64_t& tick);
+private:
+	static std::string getSlotPath(const std::string& path, int slot);
+	void WriterLoop();
+	std::string path;
+
+	// The copy being written, and where it goes.
+	ParticleStorage<Real> buffer;
+	Bounds world;
+	BoundaryMode boundary = REFLECTING;
+	uint64_t tick = 0;
+	int slot = 0;
+	uint64_t slotTicks[2] = {};
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable idle;
+	std::thread writer;
+	bool pending = false;
+	bool stopping = false;
+
+	// Metrics
+	uint64_t writtenCount = 0;
+	uint64_t skippedCount = 0;
+	uint64_t lastTick = 0;
+};
+
+#endif
@@ -0,0 +1,322 @@
+#include "MappedFile.h"
+#include <stdint.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/// <summary>
+/// Mapped File Constructor. The file is opened with Create or Open.
+/// </summary>
+MappedFile::MappedFile() {
+
+}
+
+/// <summary>
+/// Mapped File Deconstructor. Unmaps and closes the file.
+/// </summary>
+MappedFile::~MappedFile() {
+	Close();
+}
+
+/// <summary>
+/// Creates or truncates a file of the given size and maps it for reading and writing.
+/// </summary>
+/// <param name="path">The path of the file.</param>
+/// <param name="size">The size of the file in bytes.</param>
+/// <returns>Whether the file was mapped.</returns>
+bool MappedFile::Create(const std::string& path, size_t size) {
+	Close();
+	this->path = path;
+	this->writable = true;
+	this->copyOnWrite = false;
+
+#ifdef _WIN32
+	file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+#else
+	file = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (file < 0) return false;
+#endif
+
+	if (!Resize(size)) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+/// <summary>
+/// Maps an existing file.
+/// </summary>
+/// <param name="path">The path of the file.</param>
+/// <param name="writable">Whether the mapping can be written to.</param>
+/// <returns>Whether the file was mapped.</returns>
+bool MappedFile::Open(const std::string& path, bool writable) {
+	Close();
+	this->path = path;
+	this->writable = writable;
+	this->copyOnWrite = false;
+
+#ifdef _WIN32
+	DWORD access = writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ;
+	file = CreateFileA(path.c_str(), access, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(file, &fileSize);
+	size = (size_t)fileSize.QuadPart;
+#else
+	file = open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+	if (file < 0) return false;
+	struct stat info;
+	fstat(file, &info);
+	size = (size_t)info.st_size;
+#endif
+
+	if (!Map()) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+/// <summary>
+/// Maps an existing file copy-on-write. The mapping can be written to, but the writes stay
+/// in private pages and never reach the file, so a file can be loaded and run in place.
+/// </summary>
+/// <param name="path">The path of the file.</param>
+/// <returns>Whether the file was mapped.</returns>
+bool MappedFile::OpenPrivate(const std::string& path) {
+	if (!Open(path, false)) return false;
+	Unmap();
+	copyOnWrite = true;
+	if (!Map()) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+/// <summary>
+/// Returns the system name of a block of shared memory.
+/// </summary>
+static std::string SharedName(const std::string& name) {
+#ifdef _WIN32
+	return "Local\\" + name;
+#else
+	return "/" + name;
+#endif
+}
+
+/// <summary>
+/// Creates a named block of shared memory and maps it for reading and writing. Any earlier block of the
+/// same name is removed first, so processes still mapping it keep the old block rather than see it change size.
+/// The block is removed again when this mapping is closed.
+/// </summary>
+/// <param name="name">The name other processes open the block by.</param>
+/// <param name="size">The size of the block in bytes.</param>
+/// <returns>Whether the block was created and mapped.</returns>
+bool MappedFile::CreateShared(const std::string& name, size_t size) {
+	Close();
+	this->path = name;
+	this->writable = true;
+	this->copyOnWrite = false;
+	this->size = size;
+
+#ifdef _WIN32
+	// The block is backed by the page file and lasts as long as a handle to it is open.
+	mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, SharedName(name).c_str());
+	if (!mapping || GetLastError() == ERROR_ALREADY_EXISTS) {
+		Close();
+		return false;
+	}
+	data = (char*)MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+	if (!data) {
+		Close();
+		return false;
+	}
+#else
+	shm_unlink(SharedName(name).c_str());
+	file = shm_open(SharedName(name).c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (file < 0) return false;
+	sharedOwner = true;
+	if (ftruncate(file, (off_t)size) != 0 || !Map()) {
+		Close();
+		return false;
+	}
+#endif
+	return true;
+}
+
+/// <summary>
+/// Maps a named block of shared memory another process created, for reading only.
+/// </summary>
+/// <param name="name">The name of the block.</param>
+/// <returns>Whether the block exists and was mapped.</returns>
+bool MappedFile::OpenShared(const std::string& name) {
+	Close();
+	this->path = name;
+	this->writable = false;
+	this->copyOnWrite = false;
+
+#ifdef _WIN32
+	mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, SharedName(name).c_str());
+	if (!mapping) return false;
+	data = (char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data) {
+		Close();
+		return false;
+	}
+	MEMORY_BASIC_INFORMATION region;
+	VirtualQuery(data, &region, sizeof(region));
+	size = (size_t)region.RegionSize;
+#else
+	file = shm_open(SharedName(name).c_str(), O_RDONLY, 0);
+	if (file < 0) return false;
+	struct stat info;
+	fstat(file, &info);
+	size = (size_t)info.st_size;
+	if (!Map()) {
+		Close();
+		return false;
+	}
+#endif
+	return true;
+}
+
+/// <summary>
+/// Grows or shrinks the file and remaps it. Pointers into the old mapping are invalidated.
+/// </summary>
+/// <param name="size">The new size in bytes.</param>
+/// <returns>Whether the file was resized and remapped.</returns>
+bool MappedFile::Resize(size_t size) {
+	if (!writable) return false;
+	Unmap();
+
+#ifdef _WIN32
+	LARGE_INTEGER fileSize;
+	fileSize.QuadPart = (LONGLONG)size;
+	if (!SetFilePointerEx(file, fileSize, NULL, FILE_BEGIN) || !SetEndOfFile(file)) return false;
+#else
+	if (ftruncate(file, (off_t)size) != 0) return false;
+#endif
+
+	this->size = size;
+	return Map();
+}
+
+/// <summary>
+/// Maps the whole file.
+/// </summary>
+/// <returns>Whether the mapping succeeded.</returns>
+bool MappedFile::Map() {
+	if (size == 0) return true;
+
+#ifdef _WIN32
+	DWORD protection = writable ? PAGE_READWRITE : (copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY);
+	DWORD access = writable ? FILE_MAP_WRITE : (copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ);
+	mapping = CreateFileMappingA(file, NULL, protection, 0, 0, NULL);
+	if (!mapping) return false;
+	data = (char*)MapViewOfFile(mapping, access, 0, 0, size);
+	if (!data) {
+		CloseHandle(mapping);
+		mapping = nullptr;
+		return false;
+	}
+#else
+	int protection = writable || copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ;
+	void* address = mmap(nullptr, size, protection, copyOnWrite ? MAP_PRIVATE : MAP_SHARED, file, 0);
+	if (address == MAP_FAILED) return false;
+	data = (char*)address;
+#endif
+	return true;
+}
+
+/// <summary>
+/// Releases the mapping, leaving the file open.
+/// </summary>
+void MappedFile::Unmap() {
+	if (!data) return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle(mapping);
+	mapping = nullptr;
+#else
+	munmap(data, size);
+#endif
+	data = nullptr;
+}
+
+/// <summary>
+/// Writes dirty pages back to disk.
+/// </summary>
+void MappedFile::Flush() {
+	if (!data) return;
+
+#ifdef _WIN32
+	FlushViewOfFile(data, size);
+#else
+	msync(data, size, MS_SYNC);
+#endif
+}
+
+/// <summary>
+/// Unmaps and closes the file, and removes shared memory this mapping created.
+/// </summary>
+void MappedFile::Close() {
+	Unmap();
+
+#ifdef _WIN32
+	// Shared memory has a mapping handle but no file.
+	if (mapping) CloseHandle(mapping);
+	mapping = nullptr;
+	if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+	file = INVALID_HANDLE_VALUE;
+#else
+	if (file >= 0) close(file);
+	file = -1;
+	if (sharedOwner) shm_unlink(SharedName(path).c_str());
+#endif
+	sharedOwner = false;
+	size = 0;
+}
+
+/// <summary>
+/// Returns whether a file is open.
+/// </summary>
+bool MappedFile::isOpen() {
+#ifdef _WIN32
+	return file != INVALID_HANDLE_VALUE || mapping != nullptr;
+#else
+	return file >= 0;
+#endif
+}
+
+/// <summary>
+/// Returns the start of the mapping.
+/// </summary>
+char* MappedFile::getData() {
+	return this->data;
+}
+
+/// <summary>
+/// Returns the size of the file in bytes.
+/// </summary>
+size_t MappedFile::getSize() {
+	return this->size;
+}
+
+/// <summary>
+/// Returns the path of the file.
+/// </summary>
+const std::string& MappedFile::getPath() {
+	return this->path;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+
+// A file mapped into memory. Reads and writes go straight to the page cache with no copies.
+// Shared memory is mapped the same way, by name rather than path, and lives only in memory.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+	bool Create(const std::string& path, size_t size);
+	bool Open(const std::string& path, bool writable);
+	bool OpenPrivate(const std::string& path);
+	bool CreateShared(const std::string& name, size_t size);
+	bool OpenShared(const std::string& name);
+	bool Resize(size_t size);
+	void Flush();
+	void Close();
+	bool isOpen();
+	char* getData();
+	size_t getSize();
+	const std::string& getPath();
+private:
+	bool Map();
+	void Unmap();
+	std::string path;
+	char* data = nullptr;
+	size_t size = 0;
+	bool writable = false;
+	bool copyOnWrite = false;
+
+	// Shared memory this mapping created, and removes again on Close.
+	bool sharedOwner = false;
+#ifdef _WIN32
+	// Windows handles, kept opaque so windows.h stays out of the header.
+	void* file = (void*)-1;
+	void* mapping = nullptr;
+#else
+	int file = -1;
+#endif
+};
+
+#endif
@@ -0,0 +1,370 @@
+/*
+Parallel scene file parsing. The file is mapped and split into chunks at line
+breaks, each chunk is parsed into a partial scene on its own thread, and the
+partial scenes are merged in file order, so later settings still win and
+errors are reported against the first bad line of the file.
+*/
+
+#include "SceneLoader.h"
+#include "MappedFile.h"
+#include <cmath>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The most tokens a statement can have.
+const size_t SCENE_MAX_TOKENS = 16;
+
+// The longest number a token can hold, with room for the terminator.
+const size_t SCENE_NUMBER_LENGTH = 64;
+
+// A word of a statement, pointing into the mapped file.
+struct SceneToken {
+	const char* begin;
+	const char* end;
+};
+
+// The part of a scene declared by one chunk of the file.
+struct SceneChunk {
+	SceneDescription scene;
+	bool hasWorld = false;
+	bool hasBoundary = false;
+	bool hasGravity = false;
+	bool hasInteraction = false;
+	bool hasSeed = false;
+
+	// Lines are counted from the start of the chunk.
+	size_t lines = 0;
+	size_t firstStatement = (size_t)-1;
+	bool firstIsVersion = false;
+	size_t errorLine = (size_t)-1;
+	std::string error;
+};
+
+/// <summary>
+/// Returns whether a token is a given word.
+/// </summary>
+static bool Equals(const SceneToken& token, const char* word) {
+	size_t length = strlen(word);
+	return (size_t)(token.end - token.begin) == length && memcmp(token.begin, word, length) == 0;
+}
+
+/// <summary>
+/// Copies a token into a terminated buffer for the C parsing functions.
+/// </summary>
+/// <returns>False if the token is empty or too long to be a number.</returns>
+static bool CopyToken(const SceneToken& token, char (&buffer)[SCENE_NUMBER_LENGTH]) {
+	size_t length = (size_t)(token.end - token.begin);
+	if (length == 0 || length >= SCENE_NUMBER_LENGTH) return false;
+	memcpy(buffer, token.begin, length);
+	buffer[length] = '\0';
+	return true;
+}
+
+/// <summary>
+/// Reads a token as a float. Infinities and NaNs are rejected, since every range check passes a NaN.
+/// </summary>
+static bool ParseFloat(const SceneToken& token, float& value) {
+	char buffer[SCENE_NUMBER_LENGTH];
+	if (!CopyToken(token, buffer)) return false;
+	char* end;
+	errno = 0;
+	value = strtof(buffer, &end);
+	return errno == 0 && *end == '\0' && std::isfinite(value);
+}
+
+/// <summary>
+/// Reads a token as an unsigned integer.
+/// </summary>
+static bool ParseInteger(const SceneToken& token, uint64_t& value) {
+	char buffer[SCENE_NUMBER_LENGTH];
+	if (!CopyToken(token, buffer)) return false;
+
+	// strtoull takes a sign and wraps negative numbers round, so only digits are allowed.
+	if (buffer[0] < '0' || buffer[0] > '9') return false;
+	char* end;
+	errno = 0;
+	value = strtoull(buffer, &end, 10);
+	return errno == 0 && *end == '\0';
+}
+
+/// <summary>
+/// Reads tokens from a first index on as floats.
+/// </summary>
+static bool ParseFloats(const SceneToken* tokens, size_t first, size_t count, float* values) {
+	for (size_t i = 0; i < count; i++) {
+		if (!ParseFloat(tokens[first + i], values[i])) return false;
+	}
+	return true;
+}
+
+/// <summary>
+/// Applies one statement to a chunk's partial scene.
+/// </summary>
+/// <param name="tokens">The words of the statement.</param>
+/// <param name="count">The number of words.</param>
+/// <param name="chunk">The chunk the statement is in.</param>
+/// <param name="error">Receives what is wrong with the statement.</param>
+/// <returns>Whether the statement was valid.</returns>
+static bool ParseStatement(const SceneToken* tokens, size_t count, SceneChunk& chunk, std::string& error) {
+	SceneDescription& scene = chunk.scene;
+	const SceneToken& keyword = tokens[0];
+	float v[SCENE_MAX_TOKENS];
+
+	if (Equals(keyword, "scene")) {
+		uint64_t version;
+		if (count != 2 || !ParseInteger(tokens[1], version)) {
+			error = "expected 'scene <version>'";
+			return false;
+		}
+		if (version == 0 || version > SCENE_VERSION) {
+			error = "scene version " + std::to_string(version) + " is newer than this build reads";
+			return false;
+		}
+		scene.version = (uint32_t)version;
+	}
+	else if (Equals(keyword, "world")) {
+		if (count != 3 || !ParseFloats(tokens, 1, 2, v) || v[0] <= 0.0f || v[1] <= 0.0f) {
+			error = "expected 'world <width> <height>' with a positive size";
+			return false;
+		}
+		scene.world = Bounds(Vector2(0.0f, 0.0f), Vector2(v[0], v[1]));
+		chunk.hasWorld = true;
+	}
+	else if (Equals(keyword, "boundary")) {
+		if (count == 2 && Equals(tokens[1], "reflecting")) scene.boundary = REFLECTING;
+		else if (count == 2 && Equals(tokens[1], "periodic")) scene.boundary = PERIODIC;
+		else {
+			error = "expected 'boundary reflecting|periodic'";
+			return false;
+		}
+		chunk.hasBoundary = true;
+	}
+	else if (Equals(keyword, "gravity")) {
+		if (count == 2 && Equals(tokens[1], "uniform")) scene.gravity = UNIFORM;
+		else if (count == 2 && Equals(tokens[1], "barnes-hut")) scene.gravity = BARNES_HUT;
+		else {
+			error = "expected 'gravity uniform|barnes-hut'";
+			return false;
+		}
+		chunk.hasGravity = true;
+	}
+	else if (Equals(keyword, "interaction")) {
+		if (count == 2 && Equals(tokens[1], "pairwise")) scene.interaction = PAIRWISE;
+		else if (count == 2 && Equals(tokens[1], "neighbour-list")) scene.interaction = NEIGHBOUR_LIST;
+		else if (count == 2 && Equals(tokens[1], "fluid")) scene.interaction = FLUID;
+		else {
+			error = "expected 'interaction pairwise|neighbour-list|fluid'";
+			return false;
+		}
+		chunk.hasInteraction = true;
+	}
+	else if (Equals(keyword, "seed")) {
+		if (count != 2 || !ParseInteger(tokens[1], scene.seed)) {
+			error = "expected 'seed <integer>'";
+			return false;
+		}
+		chunk.hasSeed = true;
+	}
+	else if (Equals(keyword, "region")) {
+		SceneRegion region = {};
+		bool valid = count >= 7 && count <= 10 && count != 8 && ParseFloats(tokens, 1, 4, v)
+			&& ParseInteger(tokens[5], region.count) && ParseFloat(tokens[6], region.radius)
+			&& ParseFloats(tokens, 7, count - 7, v + 4);
+		if (!valid || v[0] >= v[2] || v[1] >= v[3] || region.radius <= 0.0f) {
+			error = "expected 'region <minX> <minY> <maxX> <maxY> <count> <radius> [<velocityX> <velocityY> [<jitter>]]' with a non-empty area and a positive radius";
+			return false;
+		}
+		region.area = Bounds(Vector2(v[0], v[1]), Vector2(v[2], v[3]));
+		if (count >= 9) region.velocity.Set(v[4], v[5]);
+		if (count == 10) region.jitter = v[6];
+		scene.regions.push_back(region);
+	}
+	else if (Equals(keyword, "particle")) {
+		if ((count != 4 && count != 6) || !ParseFloats(tokens, 1, count - 1, v) || v[2] <= 0.0f) {
+			error = "expected 'particle <x> <y> <radius> [<velocityX> <velocityY>]' with a positive radius";
+			return false;
+		}
+		SceneParticle particle = { Vector2(v[0], v[1]), Vector2(0.0f, 0.0f), v[2] };
+		if (count == 6) particle.velocity.Set(v[3], v[4]);
+		scene.particles.push_back(particle);
+	}
+	else if (Equals(keyword, "box")) {
+		if ((count != 5 && count != 6) || !ParseFloats(tokens, 1, count - 1, v) || v[2] <= 0.0f || v[3] <= 0.0f) {
+			error = "expected 'box <x> <y> <length> <width> [<rotation>]' with a positive size";
+			return false;
+		}
+		scene.boxes.push_back({ Vector2(v[0], v[1]), v[2], v[3], count == 6 ? v[4] : 0.0f });
+	}
+	else if (Equals(keyword, "emitter")) {
+		if (count != 8 || !ParseFloats(tokens, 1, 7, v) || v[5] < 0.0f || v[6] <= 0.0f) {
+			error = "expected 'emitter <x> <y> <velocityX> <velocityY> <spread> <rate> <lifetime>' with a positive lifetime";
+			return false;
+		}
+		scene.emitters.push_back({ Vector2(v[0], v[1]), Vector2(v[2], v[3]), v[4], v[5], v[6] });
+	}
+	else if (Equals(keyword, "absorber")) {
+		if (count != 5 || !ParseFloats(tokens, 1, 4, v) || v[0] >= v[2] || v[1] >= v[3]) {
+			error = "expected 'absorber <minX> <minY> <maxX> <maxY>' with a non-empty area";
+			return false;
+		}
+		scene.absorbers.push_back(Bounds(Vector2(v[0], v[1]), Vector2(v[2], v[3])));
+	}
+	else {
+		error = "unknown statement '" + std::string(keyword.begin, keyword.end) + "'";
+		return false;
+	}
+	return true;
+}
+
+/// <summary>
+/// Parses the lines of one chunk, stopping at the first bad one.
+/// </summary>
+static void ParseChunk(const char* begin, const char* end, SceneChunk& chunk) {
+	SceneToken tokens[SCENE_MAX_TOKENS];
+	const char* line = begin;
+	while (line < end) {
+		const char* lineEnd = (const char*)memchr(line, '\n', end - line);
+		if (!lineEnd) lineEnd = end;
+		size_t lineIndex = chunk.lines++;
+
+		// Split the line into words, up to any comment.
+		size_t count = 0;
+		bool overflow = false;
+		const char* c = line;
+		while (c < lineEnd && *c != '#') {
+			if (*c == ' ' || *c == '\t' || *c == '\r') {
+				c++;
+				continue;
+			}
+			const char* word = c;
+			while (c < lineEnd && *c != ' ' && *c != '\t' && *c != '\r' && *c != '#') c++;
+			if (count == SCENE_MAX_TOKENS) overflow = true;
+			else tokens[count++] = { word, c };
+		}
+		line = lineEnd + 1;
+		if (count == 0) continue;
+
+		bool isVersion = Equals(tokens[0], "scene");
+		if (chunk.firstStatement == (size_t)-1) {
+			chunk.firstStatement = lineIndex;
+			chunk.firstIsVersion = isVersion;
+		}
+		else if (isVersion) {
+			chunk.error = "the scene version can only be stated once, at the top";
+		}
+		if (overflow) chunk.error = "too many words";
+		if (chunk.error.empty()) ParseStatement(tokens, count, chunk, chunk.error);
+		if (!chunk.error.empty()) {
+			chunk.errorLine = lineIndex;
+			return;
+		}
+	}
+}
+
+/// <summary>
+/// Reads a scene file, parsing chunks of it in parallel.
+/// </summary>
+/// <param name="path">The path of the scene file.</param>
+/// <param name="scene">Receives the scene.</param>
+/// <param name="error">Receives why the scene could not be read, with the line at fault.</param>
+/// <returns>Whether the scene was read.</returns>
+bool LoadSceneFile(const std::string& path, SceneDescription& scene, std::string& error) {
+	MappedFile file;
+	if (!file.Open(path, false)) {
+		error = "Could not open " + path;
+		return false;
+	}
+	const char* data = file.getData();
+	size_t size = file.getSize();
+
+	// Split at the first line break after each even share of the file.
+	size_t chunkCount = size / 65536 + 1;
+	size_t maxChunks = (size_t)ThreadPool::Instance().getThreadCount() * 4;
+	if (chunkCount > maxChunks) chunkCount = maxChunks;
+	std::vector<size_t> starts(chunkCount + 1, size);
+	starts[0] = 0;
+	for (size_t i = 1; i < chunkCount; i++) {
+		size_t start = size * i / chunkCount;
+		if (start < starts[i - 1]) start = starts[i - 1];
+		const char* lineBreak = start < size ? (const char*)memchr(data + start, '\n', size - start) : nullptr;
+		starts[i] = lineBreak ? (size_t)(lineBreak - data) + 1 : size;
+	}
+
+	std::vector<SceneChunk> chunks(chunkCount);
+	ParallelFor(chunkCount, 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			ParseChunk(data + starts[i], data + starts[i + 1], chunks[i]);
+		}
+	});
+
+	// Report the first error in the file, and check it starts with its version.
+	size_t line = 1;
+	bool started = false;
+	for (size_t i = 0; i < chunkCount; i++) {
+		const SceneChunk& chunk = chunks[i];
+		if (!started && chunk.firstStatement != (size_t)-1) {
+			started = true;
+			if (!chunk.firstIsVersion) {
+				error = path + ":" + std::to_string(line + chunk.firstStatement) + ": scene files start with their version, as 'scene " + std::to_string(SCENE_VERSION) + "'";
+				return false;
+			}
+		}
+		else if (chunk.firstIsVersion) {
+			error = path + ":" + std::to_string(line + chunk.firstStatement) + ": the scene version can only be stated once, at the top";
+			return false;
+		}
+		if (chunk.errorLine != (size_t)-1) {
+			error = path + ":" + std::to_string(line + chunk.errorLine) + ": " + chunk.error;
+			return false;
+		}
+		line += chunk.lines;
+	}
+	if (!started) {
+		error = path + " is empty";
+		return false;
+	}
+
+	// Merge the chunks in order, so settings stated later win.
+	scene = SceneDescription();
+	size_t regions = 0, particles = 0, boxes = 0, emitters = 0, absorbers = 0;
+	for (size_t i = 0; i < chunkCount; i++) {
+		regions += chunks[i].scene.regions.size();
+		particles += chunks[i].scene.particles.size();
+		boxes += chunks[i].scene.boxes.size();
+		emitters += chunks[i].scene.emitters.size();
+		absorbers += chunks[i].scene.absorbers.size();
+	}
+	scene.regions.reserve(regions);
+	scene.particles.reserve(particles);
+	scene.boxes.reserve(boxes);
+	scene.emitters.reserve(emitters);
+	scene.absorbers.reserve(absorbers);
+
+	for (size_t i = 0; i < chunkCount; i++) {
+		const SceneChunk& chunk = chunks[i];
+		if (chunk.firstIsVersion && scene.version == 0) scene.version = chunk.scene.version;
+		if (chunk.hasWorld) scene.world = chunk.scene.world;
+		if (chunk.hasBoundary) scene.boundary = chunk.scene.boundary;
+		if (chunk.hasGravity) scene.gravity = chunk.scene.gravity;
+		if (chunk.hasInteraction) scene.interaction = chunk.scene.interaction;
+		if (chunk.hasSeed) scene.seed = chunk.scene.seed;
+		scene.regions.insert(scene.regions.end(), chunk.scene.regions.begin(), chunk.scene.regions.end());
+		scene.particles.insert(scene.particles.end(), chunk.scene.particles.begin(), chunk.scene.particles.end());
+		scene.boxes.insert(scene.boxes.end(), chunk.scene.boxes.begin(), chunk.scene.boxes.end());
+		scene.emitters.insert(scene.emitters.end(), chunk.scene.emitters.begin(), chunk.scene.emitters.end());
+		scene.absorbers.insert(scene.absorbers.end(), chunk.scene.absorbers.begin(), chunk.scene.absorbers.end());
+	}
+	return true;
+}
+
+/// <summary>
+/// Returns the number of particles the scene's regions and single particles add up to.
+/// </summary>
+uint64_t SceneDescription::getParticleCount() const {
+	uint64_t count = particles.size();
+	for (size_t i = 0; i < regions.size(); i++) {
+		count += regions[i].count;
+	}
+	return count;
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#ifndef SCENELOADER_H
+#define SCENELOADER_H
+
+#include "../Bounds.h"
+#include "../Common.h"
+#include "../ParticleStorage.h"
+#include "../Parallel.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/*
+A scene file is plain text, one statement per line, with # starting a comment. The first
+statement is the format version, and every other statement can come in any order:
+
+	scene 1
+	world <width> <height>
+	boundary reflecting|periodic
+	gravity uniform|barnes-hut
+	interaction pairwise|neighbour-list|fluid
+	seed <integer>
+	region <minX> <minY> <maxX> <maxY> <count> <radius> [<velocityX> <velocityY> [<jitter>]]
+	particle <x> <y> <radius> [<velocityX> <velocityY>]
+	box <x> <y> <length> <width> [<rotation>]
+	emitter <x> <y> <velocityX> <velocityY> <spread> <rate> <lifetime>
+	absorber <minX> <minY> <maxX> <maxY>
+
+Settings stated more than once take their last value. A region scatters its particles over its
+area with velocities jittered up to the given amount, from a generator keyed on the seed and the
+particle's index, so a scene fills the same however many threads fill it.
+*/
+
+const uint32_t SCENE_VERSION = 1;
+
+// A block of particles scattered over an area.
+struct SceneRegion {
+	Bounds area;
+	uint64_t count;
+	float radius;
+	Vector2 velocity;
+	float jitter;
+};
+
+// A single particle.
+struct SceneParticle {
+	Vector2 position;
+	Vector2 velocity;
+	float radius;
+};
+
+// A box obstacle. Rotation is in degrees.
+struct SceneBox {
+	Vector2 position;
+	float length;
+	float width;
+	float rotation;
+};
+
+// A particle emitter.
+struct SceneEmitter {
+	Vector2 position;
+	Vector2 velocity;
+	float spread;
+	float rate;
+	float lifetime;
+};
+
+// Everything a scene file declares.
+struct SceneDescription {
+	uint32_t version = 0;
+	Bounds world = Bounds(Vector2(0.0f, 0.0f), Vector2(WORLD_WIDTH, WORLD_HEIGHT));
+	BoundaryMode boundary = REFLECTING;
+	GravityMode gravity = UNIFORM;
+	InteractionMode interaction = PAIRWISE;
+	uint64_t seed = 1;
+	std::vector<SceneRegion> regions;
+	std::vector<SceneParticle> particles;
+	std::vector<SceneBox> boxes;
+	std::vector<SceneEmitter> emitters;
+	std::vector<Bounds> absorbers;
+
+	uint64_t getParticleCount() const;
+};
+
+bool LoadSceneFile(const std::string& path, SceneDescription& scene, std::string& error);
+
+/// <summary>
+/// Returns a number in [0, 1) that depends only on a seed, an index and a stream.
+/// </summary>
+/// <param name="seed">The seed of the scene.</param>
+/// <param name="index">The index of the particle.</param>
+/// <param name="stream">Which of a particle's numbers this is.</param>
+inline float SceneRandom(uint64_t seed, uint64_t index, uint32_t stream) {
+	// SplitMix64 finaliser over the combined key.
+	uint64_t x = seed * 0x9E3779B97F4A7C15ull + index * 0xD1B54A32D192ED03ull + ((uint64_t)stream << 32 | stream) * 0xBF58476D1CE4E5B9ull;
+	x ^= x >> 30;
+	x *= 0xBF58476D1CE4E5B9ull;
+	x ^= x >> 27;
+	x *= 0x94D049BB133111EBull;
+	x ^= x >> 31;
+	return (float)(x >> 40) * (1.0f / 16777216.0f);
+}
+
+/// <summary>
+/// Fills particle storage with every particle of a scene, regions first then single particles.
+/// Each region is filled in parallel. Particles weigh as much as a circle of their radius.
+/// </summary>
+/// <param name="scene">The scene.</param>
+/// <param name="storage">The storage, which is resized to hold exactly the scene's particles.</param>
+template<typename T>
+void BuildSceneParticles(const SceneDescription& scene, ParticleStorage<T>& storage) {
+	storage.Resize((size_t)scene.getParticleCount());
+	ParticleView<T> view = storage.getView();
+
+	size_t first = 0;
+	for (size_t r = 0; r < scene.regions.size(); r++) {
+		const SceneRegion& region = scene.regions[r];
+
+		// Particles are kept a radius inside the area, unless it is too small for that.
+		Vector2 low = region.area.min + region.radius;
+		Vector2 high = region.area.max - region.radius;
+		if (high.x < low.x) low.x = high.x = region.area.getCenter().x;
+		if (high.y < low.y) low.y = high.y = region.area.getCenter().y;
+
+		// Each region draws four streams of its own, for the two position and two velocity components.
+		uint32_t stream = (uint32_t)r * 4;
+		T inverseMass = T(1) / (T)(PI * region.radius * region.radius);
+		ParallelFor((size_t)region.count, 1 << 14, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				size_t p = first + i;
+				view.positionX[p] = (T)(low.x + (high.x - low.x) * SceneRandom(scene.seed, i, stream + 0));
+				view.positionY[p] = (T)(low.y + (high.y - low.y) * SceneRandom(scene.seed, i, stream + 1));
+				view.velocityX[p] = (T)(region.velocity.x + region.jitter * (2.0f * SceneRandom(scene.seed, i, stream + 2) - 1.0f));
+				view.velocityY[p] = (T)(region.velocity.y + region.jitter * (2.0f * SceneRandom(scene.seed, i, stream + 3) - 1.0f));
+				view.forceX[p] = T(0);
+				view.forceY[p] = T(0);
+				view.inverseMass[p] = inverseMass;
+				view.radius[p] = (T)region.radius;
+			}
+		});
+		first += (size_t)region.count;
+	}
+
+	for (size_t i = 0; i < scene.particles.size(); i++) {
+		const SceneParticle& particle = scene.particles[i];
+		size_t p = first + i;
+		view.positionX[p] = (T)particle.position.x;
+		view.positionY[p] = (T)particle.position.y;
+		view.velocityX[p] = (T)particle.velocity.x;
+		view.velocityY[p] = (T)particle.velocity.y;
+		view.forceX[p] = T(0);
+		view.forceY[p] = T(0);
+		view.inverseMass[p] = T(1) / (T)(PI * particle.radius * particle.radius);
+		view.radius[p] = (T)particle.radius;
+	}
+}
+
+#endif
@@ -0,0 +1,275 @@
+/*
+The shared memory ring behind live state publishing. Slots are guarded by a
+sequence lock: the writer makes the count odd, writes, then makes it even
+again, and a reader trusts what it read only if the count was even and has
+not moved since.
+*/
+
+#include "SharedState.h"
+#include <new>
+#include <thread>
+#include <string.h>
+
+/// <summary>
+/// Rounds a size up to a multiple of an alignment.
+/// </summary>
+static uint64_t AlignUp(uint64_t size, uint64_t alignment) {
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+/// <summary>
+/// Shared State Publisher Constructor. The block is made with Create.
+/// </summary>
+SharedStatePublisher::SharedStatePublisher() {
+
+}
+
+/// <summary>
+/// Shared State Publisher Deconstructor. Marks the block closed and removes it.
+/// </summary>
+SharedStatePublisher::~SharedStatePublisher() {
+	Close();
+}
+
+/// <summary>
+/// Creates the shared memory block, replacing any earlier block of the same name.
+/// </summary>
+/// <param name="name">The name readers attach by.</param>
+/// <param name="capacity">The most particles a frame can hold.</param>
+/// <param name="slots">The number of slots in the ring. Readers have until the ring comes round to read a frame.</param>
+/// <param name="world">The bounds of the world.</param>
+/// <param name="boundary">What happens at the edges of the world.</param>
+/// <returns>Whether the block was created.</returns>
+bool SharedStatePublisher::Create(const std::string& name, size_t capacity, uint32_t slots, const Bounds& world, BoundaryMode boundary) {
+	Close();
+	if (slots < 2) slots = 2;
+
+	// Columns are cache line aligned and slots page aligned, so no two slots share a page.
+	uint64_t columnBytes = AlignUp((uint64_t)capacity * sizeof(float), 64);
+	uint64_t slotBytes = AlignUp(64 + columnBytes * SHARED_COLUMNS, SHARED_STATE_ALIGNMENT);
+	if (!block.CreateShared(name, (size_t)(SHARED_STATE_ALIGNMENT + slotBytes * slots))) return false;
+
+	// Fresh shared memory is zeroed, so every slot starts with an even count and nothing published.
+	header = new (block.getData()) SharedStateHeader();
+	memcpy(header->magic, SHARED_STATE_MAGIC, sizeof(header->magic));
+	header->version = SHARED_STATE_VERSION;
+	header->slotCount = slots;
+	header->capacity = capacity;
+	header->slotBytes = slotBytes;
+	header->columnBytes = columnBytes;
+	header->worldMinX = world.min.x;
+	header->worldMinY = world.min.y;
+	header->worldMaxX = world.max.x;
+	header->worldMaxY = world.max.y;
+	header->boundary = boundary;
+	header->closed.store(0, std::memory_order_relaxed);
+	header->published.store(0, std::memory_order_release);
+	return true;
+}
+
+/// <summary>
+/// Tells readers no more frames are coming and removes the block. Readers still attached keep their mapping.
+/// </summary>
+void SharedStatePublisher::Close() {
+	if (header) header->closed.store(1, std::memory_order_release);
+	header = nullptr;
+	block.Close();
+}
+
+/// <summary>
+/// Returns whether the block is open.
+/// </summary>
+bool SharedStatePublisher::isOpen() {
+	return header != nullptr;
+}
+
+/// <summary>
+/// Takes the slot after the latest frame and marks it as being written.
+/// </summary>
+/// <param name="count">The number of particles in the frame.</param>
+/// <param name="tick">The tick of the frame.</param>
+/// <returns>The slot.</returns>
+SharedStateSlot* SharedStatePublisher::Begin(size_t count, uint64_t tick) {
+	uint64_t frame = header->published.load(std::memory_order_relaxed);
+	SharedStateSlot* slot = (SharedStateSlot*)(block.getData() + SHARED_STATE_ALIGNMENT + (frame % header->slotCount) * header->slotBytes);
+
+	// The odd count must be visible before any of the writes that follow.
+	uint64_t sequence = slot->sequence.load(std::memory_order_relaxed);
+	slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slot->frame = frame;
+	slot->tick = tick;
+	slot->count = count;
+	return slot;
+}
+
+/// <summary>
+/// Marks a slot as written and makes it the latest frame.
+/// </summary>
+/// <param name="slot">The slot from Begin.</param>
+void SharedStatePublisher::End(SharedStateSlot* slot) {
+	slot->sequence.store(slot->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	header->published.store(slot->frame + 1, std::memory_order_release);
+}
+
+/// <summary>
+/// Returns the start of one column of a slot.
+/// </summary>
+float* SharedStatePublisher::getColumn(SharedStateSlot* slot, int column) {
+	return (float*)((char*)slot + 64 + header->columnBytes * column);
+}
+
+/// <summary>
+/// Returns the number of frames published.
+/// </summary>
+uint64_t SharedStatePublisher::getPublishedCount() {
+	return header ? header->published.load(std::memory_order_relaxed) : 0;
+}
+
+/// <summary>
+/// Returns the name of the block.
+/// </summary>
+const std::string& SharedStatePublisher::getName() {
+	return block.getPath();
+}
+
+/// <summary>
+/// Attaches to a published block.
+/// </summary>
+/// <param name="name">The name the block was created with.</param>
+/// <returns>Whether the block exists and is one this build can read.</returns>
+bool SharedStateReader::Open(const std::string& name) {
+	Close();
+	if (!block.OpenShared(name)) {
+		error = "Nothing is publishing as " + name;
+		return false;
+	}
+
+	const SharedStateHeader* candidate = (const SharedStateHeader*)block.getData();
+	if (block.getSize() < SHARED_STATE_ALIGNMENT || memcmp(candidate->magic, SHARED_STATE_MAGIC, sizeof(candidate->magic)) != 0) {
+		error = name + " is not a particle state block";
+		Close();
+		return false;
+	}
+	if (candidate->version > SHARED_STATE_VERSION) {
+		error = name + " is version " + std::to_string(candidate->version) + ", newer than this build reads";
+		Close();
+		return false;
+	}
+	if (block.getSize() < SHARED_STATE_ALIGNMENT + candidate->slotBytes * candidate->slotCount) {
+		error = name + " is smaller than its slots";
+		Close();
+		return false;
+	}
+
+	header = candidate;
+	error.clear();
+	return true;
+}
+
+/// <summary>
+/// Detaches from the block.
+/// </summary>
+void SharedStateReader::Close() {
+	header = nullptr;
+	block.Close();
+}
+
+/// <summary>
+/// Returns whether the reader is attached.
+/// </summary>
+bool SharedStateReader::isOpen() {
+	return header != nullptr;
+}
+
+/// <summary>
+/// Points a frame at the latest published slot.
+/// </summary>
+/// <param name="frame">Receives the frame.</param>
+/// <returns>False if nothing has been published yet, or no whole frame could be read this time.</returns>
+bool SharedStateReader::Latest(SharedStateFrame& frame) {
+	if (!header) return false;
+
+	// The writer can lap a slow reader, so the latest slot may be mid-write. Go round again if so, but only so often.
+	for (unsigned int attempt = 0; attempt < SHARED_STATE_READ_ATTEMPTS; attempt++) {
+		uint64_t published = header->published.load(std::memory_order_acquire);
+		if (published == 0) return false;
+
+		const char* start = block.getData() + SHARED_STATE_ALIGNMENT + ((published - 1) % header->slotCount) * header->slotBytes;
+		const SharedStateSlot* slot = (const SharedStateSlot*)start;
+		uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+		if (sequence & 1) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		frame.frame = slot->frame;
+		frame.tick = slot->tick;
+		frame.count = (size_t)slot->count;
+		for (int column = 0; column < SHARED_COLUMNS; column++) {
+			frame.columns[column] = (const float*)(start + 64 + header->columnBytes * column);
+		}
+		frame.slot = slot;
+		frame.sequence = sequence;
+
+		// A count read mid-write could be anything, so only trust it once the slot is known to be whole.
+		if (isValid(frame) && frame.count <= header->capacity) return true;
+		std::this_thread::yield();
+	}
+	frame.slot = nullptr;
+	return false;
+}
+
+/// <summary>
+/// Returns whether a frame's slot is unchanged since Latest, so everything read from it in between is whole.
+/// </summary>
+/// <param name="frame">The frame from Latest.</param>
+bool SharedStateReader::isValid(const SharedStateFrame& frame) {
+	if (!frame.slot) return false;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return frame.slot->sequence.load(std::memory_order_relaxed) == frame.sequence;
+}
+
+/// <summary>
+/// Returns whether the publisher has closed the block. The last frame can still be read.
+/// </summary>
+bool SharedStateReader::isClosed() {
+	return header && header->closed.load(std::memory_order_acquire) != 0;
+}
+
+/// <summary>
+/// Returns the number of frames published so far.
+/// </summary>
+uint64_t SharedStateReader::getPublishedCount() {
+	return header ? header->published.load(std::memory_order_relaxed) : 0;
+}
+
+/// <summary>
+/// Returns the most particles a frame can hold.
+/// </summary>
+size_t SharedStateReader::getCapacity() {
+	return header ? (size_t)header->capacity : 0;
+}
+
+/// <summary>
+/// Returns the bounds of the published world.
+/// </summary>
+Bounds SharedStateReader::getWorld() {
+	if (!header) return Bounds(Vector2(0.0f, 0.0f), Vector2(WORLD_WIDTH, WORLD_HEIGHT));
+	return Bounds(Vector2(header->worldMinX, header->worldMinY), Vector2(header->worldMaxX, header->worldMaxY));
+}
+
+/// <summary>
+/// Returns what happens at the edges of the published world.
+/// </summary>
+BoundaryMode SharedStateReader::getBoundary() {
+	return header ? (BoundaryMode)header->boundary : REFLECTING;
+}
+
+/// <summary>
+/// Returns why the last Open failed.
+/// </summary>
+const std::string& SharedStateReader::getError() {
+	return error;
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#ifndef SHAREDSTATE_H
+#define SHAREDSTATE_H
+
+#include "MappedFile.h"
+#include "../ParticleStorage.h"
+#include "../Bounds.h"
+#include "../Common.h"
+#include "../Parallel.h"
+#include <atomic>
+#include <stdint.h>
+#include <string>
+
+/*
+Live particle state in a named block of shared memory, for viewers and tools in other processes.
+The block is a header page followed by a ring of slots, each a small header and one float column
+per field. The simulation writes every frame into the slot after the last one and never waits for
+anyone, so a reader can at worst fall so far behind that the slot it is reading is written again.
+
+Each slot is guarded by a sequence count, odd while the slot is being written. A reader notes the
+count of the latest slot, reads its columns in place, then checks the count has not moved. If it
+has, what it read may be torn, and it takes the latest slot again.
+*/
+
+const uint32_t SHARED_STATE_VERSION = 1;
+const size_t SHARED_STATE_ALIGNMENT = 4096;
+const char SHARED_STATE_MAGIC[8] = { 'P', 'S', 'I', 'M', 'L', 'I', 'V', 'E' };
+
+// The columns of every slot.
+enum SharedStateColumn {
+	SHARED_POSITION_X,
+	SHARED_POSITION_Y,
+	SHARED_VELOCITY_X,
+	SHARED_VELOCITY_Y,
+	SHARED_RADIUS,
+	SHARED_COLUMNS
+};
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2 && sizeof(uint64_t) == sizeof(long long),
+	"Shared state counters must be lock free to work across processes");
+
+// How many times a reader goes round for a whole frame before giving up on it. A publisher that died mid-write
+// or a corrupt block would otherwise keep the reader going round for good, so it skips the frame instead.
+const unsigned int SHARED_STATE_READ_ATTEMPTS = 64;
+
+// The first page of the block.
+struct SharedStateHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t slotCount;
+	uint64_t capacity;
+	uint64_t slotBytes;
+	uint64_t columnBytes;
+	float worldMinX;
+	float worldMinY;
+	float worldMaxX;
+	float worldMaxY;
+	uint32_t boundary;
+	std::atomic<uint32_t> closed;
+
+	// The number of frames published. The latest is in slot (published - 1) % slotCount.
+	std::atomic<uint64_t> published;
+};
+
+// The start of a slot. Its columns follow, each columnBytes long.
+struct SharedStateSlot {
+	std::atomic<uint64_t> sequence;
+	uint64_t frame;
+	uint64_t tick;
+	uint64_t count;
+};
+
+static_assert(sizeof(SharedStateHeader) <= SHARED_STATE_ALIGNMENT, "The shared state header must fit in its page");
+static_assert(sizeof(SharedStateSlot) <= 64, "The slot header must fit in its cache line");
+
+// Publishes particle state to shared memory.
+class SharedStatePublisher
+{
+public:
+	SharedStatePublisher();
+	~SharedStatePublisher();
+	bool Create(const std::string& name, size_t capacity, uint32_t slots, const Bounds& world, BoundaryMode boundary);
+	void Close();
+	bool isOpen();
+	template<typename T> bool Publish(const ParticleView<T>& particles, uint64_t tick);
+	uint64_t getPublishedCount();
+	const std::string& getName();
+private:
+	SharedStateSlot* Begin(size_t count, uint64_t tick);
+	void End(SharedStateSlot* slot);
+	float* getColumn(SharedStateSlot* slot, int column);
+	MappedFile block;
+	SharedStateHeader* header = nullptr;
+};
+
+// A published frame, read in place. The columns can be overwritten while they are read, so check
+// SharedStateReader::isValid after using them.
+struct SharedStateFrame {
+	uint64_t frame = 0;
+	uint64_t tick = 0;
+	size_t count = 0;
+	const float* columns[SHARED_COLUMNS] = {};
+	const SharedStateSlot* slot = nullptr;
+	uint64_t sequence = 0;
+};
+
+// Attaches to shared particle state published by another process, for reading only.
+class SharedStateReader
+{
+public:
+	bool Open(const std::string& name);
+	void Close();
+	bool isOpen();
+	bool Latest(SharedStateFrame& frame);
+	bool isValid(const SharedStateFrame& frame);
+	bool isClosed();
+	uint64_t getPublishedCount();
+	size_t getCapacity();
+	Bounds getWorld();
+	BoundaryMode getBoundary();
+	const std::string& getError();
+private:
+	MappedFile block;
+	const SharedStateHeader* header = nullptr;
+	std::string error;
+};
+
+/// <summary>
+/// Copies particles into the next slot, converted to float. Never waits for readers.
+/// </summary>
+/// <param name="particles">The particles. Any past the capacity are left out.</param>
+/// <param name="tick">The tick the particles are at.</param>
+/// <returns>Whether the frame was published.</returns>
+template<typename T>
+bool SharedStatePublisher::Publish(const ParticleView<T>& particles, uint64_t tick) {
+	if (!header) return false;
+	size_t count = particles.getCount() < header->capacity ? particles.getCount() : (size_t)header->capacity;
+	SharedStateSlot* slot = Begin(count, tick);
+
+	const T* sources[SHARED_COLUMNS] = { particles.positionX, particles.positionY, particles.velocityX, particles.velocityY, particles.radius };
+	for (int column = 0; column < SHARED_COLUMNS; column++) {
+		const T* source = sources[column];
+		float* destination = getColumn(slot, column);
+		ParallelFor(count, 1 << 16, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				destination[i] = (float)source[i];
+			}
+		});
+	}
+
+	End(slot);
+	return true;
+}
+
+#endif
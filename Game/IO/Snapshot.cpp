@@ -0,0 +1,143 @@
+#include "Snapshot.h"
+
+/// <summary>
+/// Rounds a size up to the next page.
+/// </summary>
+static uint64_t AlignToPage(uint64_t size) {
+	return (size + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+}
+
+/// <summary>
+/// Creates a snapshot with room for a number of particles in the given columns, and writes its header.
+/// The caller fills in the world and tick through the header, and the columns through getColumn.
+/// </summary>
+/// <param name="path">The path of the snapshot.</param>
+/// <param name="count">The number of particles.</param>
+/// <param name="elementSizes">The element size of each of the SNAPSHOT_MAX_COLUMNS columns, zero if absent.</param>
+/// <returns>Whether the file was created.</returns>
+bool Snapshot::Create(const std::string& path, uint64_t count, const uint32_t* elementSizes) {
+	SnapshotHeader header = {};
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.version = SNAPSHOT_VERSION;
+	header.count = count;
+
+	uint64_t offset = SNAPSHOT_ALIGNMENT;
+	for (unsigned int column = 0; column < SNAPSHOT_MAX_COLUMNS; column++) {
+		if (elementSizes[column] == 0) continue;
+		header.columns[column].elementSize = elementSizes[column];
+		header.columns[column].offset = offset;
+		offset += AlignToPage(count * elementSizes[column]);
+	}
+
+	if (!file.Create(path, (size_t)offset)) {
+		error = "Could not create " + path;
+		return false;
+	}
+	memcpy(file.getData(), &header, sizeof(header));
+	return true;
+}
+
+/// <summary>
+/// Maps a snapshot and checks its header and column table against the file.
+/// </summary>
+/// <param name="path">The path of the snapshot.</param>
+/// <param name="copyOnWrite">Map it so the columns can be stepped in place without changing the file.</param>
+/// <returns>Whether the snapshot is open and valid.</returns>
+bool Snapshot::Open(const std::string& path, bool copyOnWrite) {
+	bool opened = copyOnWrite ? file.OpenPrivate(path) : file.Open(path, false);
+	if (!opened) {
+		error = "Could not open " + path;
+		return false;
+	}
+
+	if (file.getSize() < SNAPSHOT_ALIGNMENT || memcmp(getHeader()->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+		error = path + " is not a snapshot";
+		Close();
+		return false;
+	}
+
+	SnapshotHeader* header = getHeader();
+	if (header->version == 0 || header->version > SNAPSHOT_VERSION) {
+		error = path + " is snapshot version " + std::to_string(header->version) + ", newer than this build reads";
+		Close();
+		return false;
+	}
+
+	for (unsigned int column = 0; column < SNAPSHOT_MAX_COLUMNS; column++) {
+		const SnapshotColumnEntry& entry = header->columns[column];
+		if (entry.elementSize == 0) continue;
+		if (entry.offset % SNAPSHOT_ALIGNMENT != 0 || entry.offset + header->count * entry.elementSize > file.getSize()) {
+			error = path + " is truncated or corrupt";
+			Close();
+			return false;
+		}
+	}
+	return true;
+}
+
+/// <summary>
+/// Writes the snapshot back to disk.
+/// </summary>
+void Snapshot::Flush() {
+	file.Flush();
+}
+
+/// <summary>
+/// Unmaps and closes the snapshot. Columns from it are invalidated.
+/// </summary>
+void Snapshot::Close() {
+	file.Close();
+}
+
+/// <summary>
+/// Returns whether a snapshot is open.
+/// </summary>
+bool Snapshot::isOpen() {
+	return file.isOpen() && file.getData();
+}
+
+/// <summary>
+/// Returns the header, which lives in the mapping.
+/// </summary>
+SnapshotHeader* Snapshot::getHeader() {
+	return (SnapshotHeader*)file.getData();
+}
+
+/// <summary>
+/// Returns the number of particles in the snapshot.
+/// </summary>
+uint64_t Snapshot::getCount() {
+	return getHeader()->count;
+}
+
+/// <summary>
+/// Returns the world the snapshot was taken in.
+/// </summary>
+Bounds Snapshot::getWorld() {
+	SnapshotHeader* header = getHeader();
+	return Bounds(Vector2((float)header->worldMinX, (float)header->worldMinY), Vector2((float)header->worldMaxX, (float)header->worldMaxY));
+}
+
+/// <summary>
+/// Returns whether the snapshot holds a column.
+/// </summary>
+/// <param name="column">The column.</param>
+bool Snapshot::hasColumn(SnapshotColumn column) {
+	return column < SNAPSHOT_MAX_COLUMNS && getHeader()->columns[column].elementSize != 0;
+}
+
+/// <summary>
+/// Returns the start of a column in the mapping, or nullptr if it is absent.
+/// </summary>
+/// <param name="column">The column.</param>
+void* Snapshot::getColumn(SnapshotColumn column) {
+	if (!hasColumn(column)) return nullptr;
+	return file.getData() + getHeader()->columns[column].offset;
+}
+
+/// <summary>
+/// Returns why the last Create or Open failed.
+/// </summary>
+const std::string& Snapshot::getError() {
+	return this->error;
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "MappedFile.h"
+#include "../ParticleStorage.h"
+#include "../Bounds.h"
+#include "../Common.h"
+#include "../Parallel.h"
+#include <stdint.h>
+#include <string.h>
+
+/*
+A snapshot is a header page followed by one page-aligned column per field. Loading one is
+a single mapping, after which every column is used in place with no parsing or copying.
+Readers accept any version up to their own, and skip columns they don't know.
+*/
+
+const uint32_t SNAPSHOT_VERSION = 1;
+const size_t SNAPSHOT_ALIGNMENT = 4096;
+const unsigned int SNAPSHOT_MAX_COLUMNS = 32;
+const char SNAPSHOT_MAGIC[8] = { 'P', 'S', 'I', 'M', 'S', 'N', 'A', 'P' };
+
+// The columns a snapshot can hold. New columns are only ever appended.
+enum SnapshotColumn {
+	// Particle state, in the simulation's scalar.
+	COLUMN_POSITION_X,
+	COLUMN_POSITION_Y,
+	COLUMN_VELOCITY_X,
+	COLUMN_VELOCITY_Y,
+	COLUMN_FORCE_X,
+	COLUMN_FORCE_Y,
+	COLUMN_INVERSE_MASS,
+	COLUMN_RADIUS,
+
+	// Entity state of an interactive scene.
+	COLUMN_TYPE,
+	COLUMN_FLAGS,
+	COLUMN_ROTATION,
+	COLUMN_SCALE_X,
+	COLUMN_SCALE_Y,
+	COLUMN_COLOR_R,
+	COLUMN_COLOR_G,
+	COLUMN_COLOR_B,
+	COLUMN_LIFETIME,
+	COLUMN_AGE
+};
+
+// Flags of an entity in a scene snapshot.
+const uint32_t SNAPSHOT_KINEMATIC = 1;
+const uint32_t SNAPSHOT_POOLED = 2;
+
+// Where a column lives in the file. An element size of zero means the column is absent.
+struct SnapshotColumnEntry {
+	uint32_t elementSize;
+	uint32_t reserved;
+	uint64_t offset;
+};
+
+// The first page of a snapshot.
+struct SnapshotHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t boundary;
+	uint64_t count;
+	uint64_t tick;
+	double worldMinX;
+	double worldMinY;
+	double worldMaxX;
+	double worldMaxY;
+	SnapshotColumnEntry columns[SNAPSHOT_MAX_COLUMNS];
+};
+
+static_assert(sizeof(SnapshotHeader) <= SNAPSHOT_ALIGNMENT, "The snapshot header must fit in its page");
+
+// A snapshot file, mapped into memory.
+class Snapshot
+{
+public:
+	bool Create(const std::string& path, uint64_t count, const uint32_t* elementSizes);
+	bool Open(const std::string& path, bool copyOnWrite);
+	void Flush();
+	void Close();
+	bool isOpen();
+	SnapshotHeader* getHeader();
+	uint64_t getCount();
+	Bounds getWorld();
+	bool hasColumn(SnapshotColumn column);
+	void* getColumn(SnapshotColumn column);
+	const std::string& getError();
+	template<typename T> T* getColumn(SnapshotColumn column);
+	template<typename T> bool getView(ParticleView<T>& view);
+private:
+	MappedFile file;
+	std::string error;
+};
+
+/// <summary>
+/// Returns a column as an array of T, or nullptr if it is absent or its elements aren't the size of T.
+/// </summary>
+/// <param name="column">The column.</param>
+template<typename T>
+T* Snapshot::getColumn(SnapshotColumn column) {
+	if (!hasColumn(column) || getHeader()->columns[column].elementSize != sizeof(T)) return nullptr;
+	return (T*)getColumn(column);
+}
+
+/// <summary>
+/// Points a particle view straight at the snapshot's particle columns.
+/// </summary>
+/// <param name="view">Receives the columns.</param>
+/// <returns>False if a particle column is missing or not stored as T.</returns>
+template<typename T>
+bool Snapshot::getView(ParticleView<T>& view) {
+	view.positionX = getColumn<T>(COLUMN_POSITION_X);
+	view.positionY = getColumn<T>(COLUMN_POSITION_Y);
+	view.velocityX = getColumn<T>(COLUMN_VELOCITY_X);
+	view.velocityY = getColumn<T>(COLUMN_VELOCITY_Y);
+	view.forceX = getColumn<T>(COLUMN_FORCE_X);
+	view.forceY = getColumn<T>(COLUMN_FORCE_Y);
+	view.inverseMass = getColumn<T>(COLUMN_INVERSE_MASS);
+	view.radius = getColumn<T>(COLUMN_RADIUS);
+	view.count = (size_t)getCount();
+	return view.positionX && view.positionY && view.velocityX && view.velocityY
+		&& view.forceX && view.forceY && view.inverseMass && view.radius;
+}
+
+/// <summary>
+/// Writes particles to a new snapshot, copying the columns in parallel.
+/// </summary>
+/// <param name="path">The path of the snapshot.</param>
+/// <param name="particles">The particles.</param>
+/// <param name="world">The world the particles are in.</param>
+/// <param name="boundary">The boundary mode of the world.</param>
+/// <param name="tick">The tick the particles are at.</param>
+/// <returns>Whether the snapshot was written.</returns>
+template<typename T>
+bool SaveParticles(const std::string& path, const ParticleView<T>& particles, const Bounds& world, BoundaryMode boundary, uint64_t tick) {
+	uint32_t elementSizes[SNAPSHOT_MAX_COLUMNS] = {};
+	for (int column = COLUMN_POSITION_X; column <= COLUMN_RADIUS; column++) {
+		elementSizes[column] = sizeof(T);
+	}
+
+	Snapshot snapshot;
+	if (!snapshot.Create(path, particles.getCount(), elementSizes)) return false;
+	SnapshotHeader* header = snapshot.getHeader();
+	header->boundary = boundary;
+	header->tick = tick;
+	header->worldMinX = world.min.x;
+	header->worldMinY = world.min.y;
+	header->worldMaxX = world.max.x;
+	header->worldMaxY = world.max.y;
+
+	const T* sources[] = { particles.positionX, particles.positionY, particles.velocityX, particles.velocityY,
+		particles.forceX, particles.forceY, particles.inverseMass, particles.radius };
+	for (int column = COLUMN_POSITION_X; column <= COLUMN_RADIUS; column++) {
+		const T* source = sources[column];
+		T* destination = snapshot.getColumn<T>((SnapshotColumn)column);
+		ParallelFor(particles.getCount(), 1 << 18, [&](size_t begin, size_t end) {
+			memcpy(destination + begin, source + begin, (end - begin) * sizeof(T));
+		});
+	}
+
+	// Only report success once the columns are on disk.
+	snapshot.Flush();
+	return true;
+}
+
+#endif
@@ -0,0 +1,406 @@
+#include "Trajectory.h"
+#include "../Parallel.h"
+#include "../Simd.h"
+#include <atomic>
+#include <math.h>
+#include <string.h>
+
+/// <summary>
+/// Quantises values to integers.
+/// </summary>
+static inline int32_t Quantise(float value, float scale) {
+	return (int32_t)floorf(value * scale + 0.5f);
+}
+
+/// <summary>
+/// Zigzag encodes an integer so small magnitudes of either sign are small.
+/// </summary>
+static inline uint32_t Zigzag(int32_t value) {
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+#ifdef SIMD_AVX2
+/// <summary>
+/// Quantises eight values and returns the zigzag of their change from the state, optionally moving the state on.
+/// </summary>
+template<bool Store>
+static inline __m256i ZigzagDeltas(const float* values, int32_t* state, __m256 scale, __m256i keep) {
+	__m256i quantised = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(values), scale), _mm256_set1_ps(0.5f))));
+	__m256i previous = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)state), keep);
+	__m256i delta = _mm256_sub_epi32(quantised, previous);
+	if (Store) _mm256_storeu_si256((__m256i*)state, quantised);
+	return _mm256_xor_si256(_mm256_slli_epi32(delta, 1), _mm256_srai_epi32(delta, 31));
+}
+#endif
+
+/// <summary>
+/// Returns the bits set in any zigzag integer of a block.
+/// </summary>
+static uint32_t ZigzagBits(const float* values, const int32_t* state, size_t count, float scale, uint32_t keep) {
+	uint32_t bits = 0;
+	size_t i = 0;
+#ifdef SIMD_AVX2
+	__m256 scales = _mm256_set1_ps(scale);
+	__m256i keeps = _mm256_set1_epi32((int32_t)keep);
+	__m256i any = _mm256_setzero_si256();
+	for (; i + 8 <= count; i += 8) {
+		any = _mm256_or_si256(any, ZigzagDeltas<false>(values + i, (int32_t*)state + i, scales, keeps));
+	}
+	__m128i half = _mm_or_si128(_mm256_castsi256_si128(any), _mm256_extracti128_si256(any, 1));
+	half = _mm_or_si128(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+	half = _mm_or_si128(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+	bits = (uint32_t)_mm_cvtsi128_si32(half);
+#endif
+	for (; i < count; i++) {
+		bits |= Zigzag((int32_t)((uint32_t)Quantise(values[i], scale) - ((uint32_t)state[i] & keep)));
+	}
+	return bits;
+}
+
+/// <summary>
+/// Writes the zigzag integers of a block at one width and moves the state on to this frame.
+/// </summary>
+template<size_t Width>
+static void PackIntegers(const float* values, int32_t* state, size_t count, float scale, uint32_t keep, uint8_t* packed) {
+	size_t i = 0;
+#ifdef SIMD_AVX2
+	// Every integer fits the width, so saturating packs narrow them exactly.
+	if (Width != 3) {
+		__m256 scales = _mm256_set1_ps(scale);
+		__m256i keeps = _mm256_set1_epi32((int32_t)keep);
+		for (; i + 8 <= count; i += 8) {
+			__m256i zigzag = ZigzagDeltas<true>(values + i, state + i, scales, keeps);
+			if (Width == 4) {
+				_mm256_storeu_si256((__m256i*)(packed + i * 4), zigzag);
+			}
+			else if (Width != 0) {
+				__m128i words = _mm_packus_epi32(_mm256_castsi256_si128(zigzag), _mm256_extracti128_si256(zigzag, 1));
+				if (Width == 2) _mm_storeu_si128((__m128i*)(packed + i * 2), words);
+				else _mm_storel_epi64((__m128i*)(packed + i), _mm_packus_epi16(words, words));
+			}
+		}
+	}
+#endif
+	for (; i < count; i++) {
+		int32_t quantised = Quantise(values[i], scale);
+		uint32_t zigzag = Zigzag((int32_t)((uint32_t)quantised - ((uint32_t)state[i] & keep)));
+		state[i] = quantised;
+		memcpy(packed + i * Width, &zigzag, Width);
+	}
+}
+
+/// <summary>
+/// Applies packed integers of one width to quantised state.
+/// </summary>
+template<size_t Width>
+static void UnpackIntegers(const uint8_t* data, int32_t* state, size_t count, uint32_t keep) {
+	for (size_t i = 0; i < count; i++) {
+		uint32_t zigzag = 0;
+		memcpy(&zigzag, data + i * Width, Width);
+		uint32_t delta = (zigzag >> 1) ^ (0u - (zigzag & 1));
+		state[i] = (int32_t)(((uint32_t)state[i] & keep) + delta);
+	}
+}
+
+/// <summary>
+/// Returns the number of blocks a column of a number of particles is split into.
+/// </summary>
+size_t TrajectoryBlockCount(size_t count) {
+	return (count + TRAJECTORY_BLOCK_SIZE - 1) / TRAJECTORY_BLOCK_SIZE;
+}
+
+/// <summary>
+/// Quantises a block of a column and appends it as zigzag integers of the change from the previous frame,
+/// or of the values themselves on a keyframe. Every integer takes the fewest whole bytes that hold the
+/// largest in the block, given by a leading width byte, so a block that did not change takes one byte.
+/// The state is left at this frame's quantised values.
+/// </summary>
+/// <param name="values">The values of the block.</param>
+/// <param name="state">The previous frame's quantised values, updated to this frame's.</param>
+/// <param name="count">The number of values.</param>
+/// <param name="quantum">The size of one quantisation step.</param>
+/// <param name="keyframe">Whether to encode the values rather than their change.</param>
+/// <param name="out">The buffer the block is appended to.</param>
+void EncodeColumn(const float* values, int32_t* state, size_t count, float quantum, bool keyframe, std::vector<uint8_t>& out) {
+	float scale = 1.0f / quantum;
+
+	// A keyframe takes the change from zero.
+	uint32_t keep = keyframe ? 0 : 0xFFFFFFFFu;
+
+	// Find the widest integer first, so the block is written in one pass at its width.
+	uint32_t bits = ZigzagBits(values, state, count, scale, keep);
+
+	uint8_t width = 0;
+	while (width < 4 && (bits >> (width * 8)) != 0) width++;
+
+	size_t start = out.size();
+	out.resize(start + 1 + count * width);
+	out[start] = width;
+	uint8_t* packed = out.data() + start + 1;
+	switch (width) {
+	case 0: PackIntegers<0>(values, state, count, scale, keep, packed); break;
+	case 1: PackIntegers<1>(values, state, count, scale, keep, packed); break;
+	case 2: PackIntegers<2>(values, state, count, scale, keep, packed); break;
+	case 3: PackIntegers<3>(values, state, count, scale, keep, packed); break;
+	case 4: PackIntegers<4>(values, state, count, scale, keep, packed); break;
+	}
+}
+
+/// <summary>
+/// Decodes a block of a column written by EncodeColumn into quantised state.
+/// </summary>
+/// <param name="data">The start of the encoded block.</param>
+/// <param name="end">The end of the readable data.</param>
+/// <param name="state">The previous frame's quantised values, updated to this frame's.</param>
+/// <param name="count">The number of values.</param>
+/// <param name="keyframe">Whether the block holds values rather than their change.</param>
+/// <returns>The end of the block, or nullptr if it runs past the end of the data.</returns>
+const uint8_t* DecodeColumn(const uint8_t* data, const uint8_t* end, int32_t* state, size_t count, bool keyframe) {
+	if (data >= end) return nullptr;
+	uint8_t width = *data++;
+	if (width > 4 || (size_t)(end - data) < count * width) return nullptr;
+
+	uint32_t keep = keyframe ? 0 : 0xFFFFFFFFu;
+	switch (width) {
+	case 0: UnpackIntegers<0>(data, state, count, keep); break;
+	case 1: UnpackIntegers<1>(data, state, count, keep); break;
+	case 2: UnpackIntegers<2>(data, state, count, keep); break;
+	case 3: UnpackIntegers<3>(data, state, count, keep); break;
+	case 4: UnpackIntegers<4>(data, state, count, keep); break;
+	}
+	return data + count * width;
+}
+
+/// <summary>
+/// Maps a recording and loads its index, rebuilding it from the frames if the recording was never closed.
+/// </summary>
+/// <param name="path">The path of the recording.</param>
+/// <returns>Whether the recording is open.</returns>
+bool TrajectoryReader::Open(const std::string& path) {
+	Close();
+	if (!file.Open(path, false)) {
+		error = "Could not open " + path;
+		return false;
+	}
+	if (file.getSize() < sizeof(TrajectoryHeader) || memcmp(file.getData(), TRAJECTORY_MAGIC, sizeof(TRAJECTORY_MAGIC)) != 0) {
+		error = path + " is not a trajectory recording";
+		Close();
+		return false;
+	}
+	memcpy(&header, file.getData(), sizeof(header));
+	if (header.version == 0 || header.version > TRAJECTORY_VERSION) {
+		error = path + " is recording version " + std::to_string(header.version) + ", newer than this build reads";
+		Close();
+		return false;
+	}
+
+	size_t size = file.getSize();
+	if (header.indexOffset != 0 && header.indexOffset + header.frameCount * sizeof(TrajectoryIndexEntry) <= size) {
+		index.resize((size_t)header.frameCount);
+		memcpy(index.data(), file.getData() + header.indexOffset, index.size() * sizeof(TrajectoryIndexEntry));
+		return true;
+	}
+
+	// No index, so walk the frames up to the first one that was cut short.
+	size_t offset = sizeof(TrajectoryHeader);
+	while (offset + sizeof(TrajectoryFrameHeader) <= size) {
+		TrajectoryFrameHeader frameHeader;
+		memcpy(&frameHeader, file.getData() + offset, sizeof(frameHeader));
+		uint64_t frameSize = sizeof(TrajectoryFrameHeader);
+		for (int column = 0; column < TRAJECTORY_COLUMNS; column++) {
+			frameSize += frameHeader.columnBytes[column];
+		}
+		if (offset + frameSize > size) break;
+		index.push_back({ frameHeader.tick, offset, frameHeader.count, frameHeader.flags });
+		offset += (size_t)frameSize;
+	}
+	return true;
+}
+
+/// <summary>
+/// Unmaps the recording.
+/// </summary>
+void TrajectoryReader::Close() {
+	file.Close();
+	index.clear();
+	frame = (size_t)-1;
+	count = 0;
+}
+
+/// <summary>
+/// Returns whether a recording is open.
+/// </summary>
+bool TrajectoryReader::isOpen() {
+	return file.isOpen();
+}
+
+/// <summary>
+/// Returns the number of frames.
+/// </summary>
+size_t TrajectoryReader::getFrameCount() {
+	return index.size();
+}
+
+/// <summary>
+/// Returns the tick a frame was recorded on.
+/// </summary>
+/// <param name="frame">The frame.</param>
+uint64_t TrajectoryReader::getTick(size_t frame) {
+	return index[frame].tick;
+}
+
+/// <summary>
+/// Returns the last frame recorded on or before a tick, or the first frame if there is none.
+/// </summary>
+/// <param name="tick">The tick.</param>
+size_t TrajectoryReader::FindFrame(uint64_t tick) {
+	size_t low = 0, high = index.size();
+	while (low < high) {
+		size_t middle = (low + high) / 2;
+		if (index[middle].tick <= tick) low = middle + 1;
+		else high = middle;
+	}
+	return low > 0 ? low - 1 : 0;
+}
+
+/// <summary>
+/// Decodes a frame, forward from the decoded frame when it can, or else from the keyframe before it.
+/// </summary>
+/// <param name="frame">The frame.</param>
+/// <returns>Whether the frame was decoded.</returns>
+bool TrajectoryReader::Seek(size_t frame) {
+	if (frame >= index.size()) return false;
+	if (frame == this->frame) return true;
+
+	size_t start = frame;
+	while (start > 0 && !(index[start].flags & TRAJECTORY_KEYFRAME)) start--;
+
+	// Carry on from the decoded frame when it lies between that keyframe and the target.
+	if (this->frame != (size_t)-1 && this->frame < frame && this->frame >= start) start = this->frame + 1;
+
+	// Only the target frame is converted back to floats, the frames before it just move the state on.
+	for (size_t i = start; i <= frame; i++) {
+		if (!Decode(i, i == frame)) {
+			this->frame = (size_t)-1;
+			return false;
+		}
+	}
+	return true;
+}
+
+/// <summary>
+/// Decodes one frame on top of the state of the frame before it.
+/// </summary>
+/// <param name="frame">The frame.</param>
+/// <param name="convert">Whether to convert the state to values.</param>
+bool TrajectoryReader::Decode(size_t frame, bool convert) {
+	const TrajectoryIndexEntry& entry = index[frame];
+	const uint8_t* base = (const uint8_t*)file.getData();
+	const uint8_t* end = base + file.getSize();
+
+	TrajectoryFrameHeader frameHeader;
+	memcpy(&frameHeader, base + entry.offset, sizeof(frameHeader));
+	bool keyframe = (frameHeader.flags & TRAJECTORY_KEYFRAME) != 0;
+	if (!keyframe && frameHeader.count != count) {
+		error = "A delta frame does not follow a frame of the same size";
+		return false;
+	}
+
+	count = frameHeader.count;
+	size_t blocks = TrajectoryBlockCount(count);
+	const uint8_t* data = base + entry.offset + sizeof(TrajectoryFrameHeader);
+	if (data > end) {
+		error = "The recording is truncated or corrupt";
+		return false;
+	}
+
+	// Find where every block starts from the size tables, then decode all of them at once.
+	blockStarts.resize(TRAJECTORY_COLUMNS * blocks);
+	blockEnds.resize(TRAJECTORY_COLUMNS * blocks);
+	for (int column = 0; column < TRAJECTORY_COLUMNS; column++) {
+		state[column].resize(count);
+		values[column].resize(count);
+		const uint8_t* columnEnd = data + frameHeader.columnBytes[column];
+		if (columnEnd > end || data + blocks * sizeof(uint32_t) > columnEnd) {
+			error = "The recording is truncated or corrupt";
+			return false;
+		}
+		const uint8_t* block = data + blocks * sizeof(uint32_t);
+		for (size_t b = 0; b < blocks; b++) {
+			uint32_t blockBytes;
+			memcpy(&blockBytes, data + b * sizeof(uint32_t), sizeof(blockBytes));
+			blockStarts[column * blocks + b] = block;
+			block += blockBytes;
+			blockEnds[column * blocks + b] = block;
+		}
+		if (block != columnEnd) {
+			error = "The recording is truncated or corrupt";
+			return false;
+		}
+		data = columnEnd;
+	}
+
+	std::atomic<bool> corrupt(false);
+	ParallelFor(TRAJECTORY_COLUMNS * blocks, 1, [&](size_t begin, size_t end) {
+		for (size_t task = begin; task < end; task++) {
+			size_t column = task / blocks;
+			size_t first = (task % blocks) * TRAJECTORY_BLOCK_SIZE;
+			size_t last = first + TRAJECTORY_BLOCK_SIZE < count ? first + TRAJECTORY_BLOCK_SIZE : count;
+			int32_t* quantised = state[column].data();
+			if (DecodeColumn(blockStarts[task], blockEnds[task], quantised + first, last - first, keyframe) != blockEnds[task]) {
+				corrupt = true;
+				continue;
+			}
+			if (!convert) continue;
+
+			float quantum = header.quantum[column];
+			float* decoded = values[column].data();
+			for (size_t i = first; i < last; i++) {
+				decoded[i] = quantised[i] * quantum;
+			}
+		}
+	});
+	if (corrupt) {
+		error = "The recording is truncated or corrupt";
+		return false;
+	}
+
+	this->frame = frame;
+	return true;
+}
+
+/// <summary>
+/// Returns the decoded frame.
+/// </summary>
+size_t TrajectoryReader::getFrame() {
+	return this->frame;
+}
+
+/// <summary>
+/// Returns the number of particles in the decoded frame.
+/// </summary>
+size_t TrajectoryReader::getCount() {
+	return this->count;
+}
+
+/// <summary>
+/// Returns a column of the decoded frame.
+/// </summary>
+/// <param name="column">The column.</param>
+const float* TrajectoryReader::getColumn(TrajectoryColumn column) {
+	return values[column].data();
+}
+
+/// <summary>
+/// Returns the world the recording was made in.
+/// </summary>
+Bounds TrajectoryReader::getWorld() {
+	return Bounds(Vector2((float)header.worldMinX, (float)header.worldMinY), Vector2((float)header.worldMaxX, (float)header.worldMaxY));
+}
+
+/// <summary>
+/// Returns why the last Open or Seek failed.
+/// </summary>
+const std::string& TrajectoryReader::getError() {
+	return this->error;
+}
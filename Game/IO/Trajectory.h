@@ -0,0 +1,109 @@
+#pragma once
+
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include "MappedFile.h"
+#include "../Bounds.h"
+#include <stdint.h>
+#include <vector>
+
+/*
+A trajectory recording is a header, a run of frames and an index. Each frame is one tick of
+particle state stored column by column. Values are quantised to integers, and every column is
+written as zigzag integers of the change from the previous frame, or of the value itself on a
+keyframe, packed to the fewest bytes that hold them. Columns are split into blocks of a fixed number of particles, led by a table of the
+encoded size of each block, so both ends encode and decode the blocks in parallel. Keyframes come
+at a fixed interval and whenever the particle count changes, so a reader seeks to any tick by
+decoding forward from the keyframe before it.
+*/
+
+const uint32_t TRAJECTORY_VERSION = 1;
+const char TRAJECTORY_MAGIC[8] = { 'P', 'S', 'I', 'M', 'T', 'R', 'A', 'J' };
+
+// The number of particles in each independently coded block of a column.
+const size_t TRAJECTORY_BLOCK_SIZE = 65536;
+
+// The columns of a frame.
+enum TrajectoryColumn {
+	TRAJECTORY_POSITION_X,
+	TRAJECTORY_POSITION_Y,
+	TRAJECTORY_VELOCITY_X,
+	TRAJECTORY_VELOCITY_Y,
+	TRAJECTORY_RADIUS,
+	TRAJECTORY_COLUMNS
+};
+
+// Flags of a frame.
+const uint32_t TRAJECTORY_KEYFRAME = 1;
+
+// The start of a recording. The frame count and index offset are filled in when it is closed.
+struct TrajectoryHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t keyframeInterval;
+	float quantum[TRAJECTORY_COLUMNS];
+	uint32_t reserved;
+	double worldMinX;
+	double worldMinY;
+	double worldMaxX;
+	double worldMaxY;
+	uint64_t frameCount;
+	uint64_t indexOffset;
+};
+
+// The start of a frame, followed by its encoded columns. Each column is a uint32_t table of the
+// encoded size of each block, then the blocks.
+struct TrajectoryFrameHeader {
+	uint64_t tick;
+	uint32_t count;
+	uint32_t flags;
+	uint64_t columnBytes[TRAJECTORY_COLUMNS];
+};
+
+// Where a frame is in the file.
+struct TrajectoryIndexEntry {
+	uint64_t tick;
+	uint64_t offset;
+	uint32_t count;
+	uint32_t flags;
+};
+
+size_t TrajectoryBlockCount(size_t count);
+void EncodeColumn(const float* values, int32_t* state, size_t count, float quantum, bool keyframe, std::vector<uint8_t>& out);
+const uint8_t* DecodeColumn(const uint8_t* data, const uint8_t* end, int32_t* state, size_t count, bool keyframe);
+
+// Reads a recording through a memory mapping. Frames are found through the index, or by
+// scanning the frames if the recording was never closed, and decoded on demand.
+class TrajectoryReader
+{
+public:
+	bool Open(const std::string& path);
+	void Close();
+	bool isOpen();
+	size_t getFrameCount();
+	uint64_t getTick(size_t frame);
+	size_t FindFrame(uint64_t tick);
+	bool Seek(size_t frame);
+	size_t getFrame();
+	size_t getCount();
+	const float* getColumn(TrajectoryColumn column);
+	Bounds getWorld();
+	const std::string& getError();
+private:
+	bool Decode(size_t frame, bool convert);
+	MappedFile file;
+	TrajectoryHeader header;
+	std::vector<TrajectoryIndexEntry> index;
+	std::string error;
+	std::vector<const uint8_t*> blockStarts;
+	std::vector<const uint8_t*> blockEnds;
+
+	// The decoded frame, and the quantised state deltas are applied to.
+	size_t frame = (size_t)-1;
+	size_t count = 0;
+	std::vector<int32_t> state[TRAJECTORY_COLUMNS];
+	std::vector<float> values[TRAJECTORY_COLUMNS];
+};
+
+#endif
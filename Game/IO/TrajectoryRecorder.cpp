@@ -0,0 +1,253 @@
+/*
+The background half of trajectory recording. The simulation thread only ever
+takes the mutex to pop a free buffer or push a full one, so it is never held
+up by encoding or disk writes.
+*/
+
+#include "TrajectoryRecorder.h"
+
+/// <summary>
+/// Trajectory Recorder Constructor. Recording starts with Open.
+/// </summary>
+TrajectoryRecorder::TrajectoryRecorder() : recordedFrames(0), droppedFrames(0), bytesWritten(0) {
+
+}
+
+/// <summary>
+/// Trajectory Recorder Deconstructor. Finishes writing and closes the recording.
+/// </summary>
+TrajectoryRecorder::~TrajectoryRecorder() {
+	Close();
+}
+
+/// <summary>
+/// Creates a recording and starts the writer thread.
+/// </summary>
+/// <param name="path">The path of the recording.</param>
+/// <param name="world">The world being recorded.</param>
+/// <param name="buffers">The number of frames that can be in flight at once.</param>
+/// <param name="keyframeInterval">The number of frames between keyframes.</param>
+/// <param name="positionQuantum">The precision positions are stored to.</param>
+/// <param name="velocityQuantum">The precision velocities are stored to.</param>
+/// <returns>Whether the recording was created.</returns>
+bool TrajectoryRecorder::Open(const std::string& path, const Bounds& world, unsigned int buffers, uint32_t keyframeInterval, float positionQuantum, float velocityQuantum) {
+	Close();
+	stream.open(path, std::ios::binary | std::ios::trunc);
+	if (!stream) return false;
+	this->path = path;
+
+	header = {};
+	memcpy(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic));
+	header.version = TRAJECTORY_VERSION;
+	header.keyframeInterval = keyframeInterval > 0 ? keyframeInterval : 1;
+	header.quantum[TRAJECTORY_POSITION_X] = positionQuantum;
+	header.quantum[TRAJECTORY_POSITION_Y] = positionQuantum;
+	header.quantum[TRAJECTORY_VELOCITY_X] = velocityQuantum;
+	header.quantum[TRAJECTORY_VELOCITY_Y] = velocityQuantum;
+	header.quantum[TRAJECTORY_RADIUS] = positionQuantum;
+	header.worldMinX = world.min.x;
+	header.worldMinY = world.min.y;
+	header.worldMaxX = world.max.x;
+	header.worldMaxY = world.max.y;
+	stream.write((const char*)&header, sizeof(header));
+
+	offset = sizeof(header);
+	lastCount = 0;
+	index.clear();
+	recordedFrames = 0;
+	droppedFrames = 0;
+	bytesWritten = sizeof(header);
+
+	frames = std::vector<TrajectoryFrame>(buffers > 0 ? buffers : 1);
+	free.clear();
+	for (size_t i = 0; i < frames.size(); i++) {
+		free.push_back(&frames[i]);
+	}
+	stopping = false;
+	writer = std::thread(&TrajectoryRecorder::WriterLoop, this);
+	return true;
+}
+
+/// <summary>
+/// Writes every frame still in flight, then the index, and closes the recording.
+/// </summary>
+void TrajectoryRecorder::Close() {
+	if (!writer.joinable()) return;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	writer.join();
+
+	// The index goes at the end, and the header is rewritten to point at it.
+	header.frameCount = index.size();
+	header.indexOffset = offset;
+	stream.write((const char*)index.data(), index.size() * sizeof(TrajectoryIndexEntry));
+	stream.seekp(0);
+	stream.write((const char*)&header, sizeof(header));
+	stream.close();
+	bytesWritten += index.size() * sizeof(TrajectoryIndexEntry);
+}
+
+/// <summary>
+/// Returns whether a recording is open.
+/// </summary>
+bool TrajectoryRecorder::isOpen() {
+	return writer.joinable();
+}
+
+/// <summary>
+/// Makes Acquire wait for the writer to free a buffer instead of dropping the frame.
+/// </summary>
+/// <param name="blocking">Whether to wait. The interactive loop drops frames rather than stall a tick.</param>
+void TrajectoryRecorder::setBlocking(bool blocking) {
+	std::lock_guard<std::mutex> lock(mutex);
+	this->blocking = blocking;
+}
+
+/// <summary>
+/// Takes a free frame buffer sized for a number of particles, waiting for one if the recorder is blocking.
+/// </summary>
+/// <param name="count">The number of particles in the frame.</param>
+/// <returns>The buffer, or nullptr if every buffer is in flight and the frame has to be dropped.</returns>
+TrajectoryFrame* TrajectoryRecorder::Acquire(size_t count) {
+	TrajectoryFrame* frame = nullptr;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (blocking) returned.wait(lock, [this] { return !free.empty(); });
+		if (!free.empty()) {
+			frame = free.back();
+			free.pop_back();
+		}
+	}
+	if (!frame) {
+		droppedFrames++;
+		return nullptr;
+	}
+
+	frame->count = count;
+	for (int column = 0; column < TRAJECTORY_COLUMNS; column++) {
+		frame->columns[column].resize(count);
+	}
+	return frame;
+}
+
+/// <summary>
+/// Hands a filled frame buffer to the writer thread.
+/// </summary>
+/// <param name="frame">A buffer from Acquire.</param>
+void TrajectoryRecorder::Submit(TrajectoryFrame* frame) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending.push_back(frame);
+	}
+	wake.notify_one();
+}
+
+/// <summary>
+/// Writes frames as they arrive until the recording is closed and nothing is left in flight.
+/// </summary>
+void TrajectoryRecorder::WriterLoop() {
+	while (true) {
+		TrajectoryFrame* frame;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return stopping || !pending.empty(); });
+			if (pending.empty()) return;
+			frame = pending.front();
+			pending.pop_front();
+		}
+
+		Write(frame);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			free.push_back(frame);
+		}
+		returned.notify_one();
+	}
+}
+
+/// <summary>
+/// Encodes a frame and appends it to the file.
+/// </summary>
+void TrajectoryRecorder::Write(TrajectoryFrame* frame) {
+	bool keyframe = index.empty() || frame->count != lastCount || index.size() % header.keyframeInterval == 0;
+	lastCount = frame->count;
+
+	TrajectoryFrameHeader frameHeader = {};
+	frameHeader.tick = frame->tick;
+	frameHeader.count = (uint32_t)frame->count;
+	frameHeader.flags = keyframe ? TRAJECTORY_KEYFRAME : 0;
+
+	// Every block of every column is independent, so they all encode in parallel.
+	size_t blocks = TrajectoryBlockCount(frame->count);
+	for (int column = 0; column < TRAJECTORY_COLUMNS; column++) {
+		state[column].resize(frame->count);
+		encoded[column].resize(blocks);
+		blockBytes[column].resize(blocks);
+	}
+	ParallelFor(TRAJECTORY_COLUMNS * blocks, 1, [&](size_t begin, size_t end) {
+		for (size_t task = begin; task < end; task++) {
+			size_t column = task / blocks;
+			size_t block = task % blocks;
+			size_t first = block * TRAJECTORY_BLOCK_SIZE;
+			size_t last = first + TRAJECTORY_BLOCK_SIZE < frame->count ? first + TRAJECTORY_BLOCK_SIZE : frame->count;
+			std::vector<uint8_t>& out = encoded[column][block];
+			out.clear();
+			EncodeColumn(frame->columns[column].data() + first, state[column].data() + first, last - first, header.quantum[column], keyframe, out);
+			blockBytes[column][block] = (uint32_t)out.size();
+		}
+	});
+
+	uint64_t frameSize = sizeof(frameHeader);
+	for (int column = 0; column < TRAJECTORY_COLUMNS; column++) {
+		frameHeader.columnBytes[column] = blocks * sizeof(uint32_t);
+		for (size_t block = 0; block < blocks; block++) {
+			frameHeader.columnBytes[column] += blockBytes[column][block];
+		}
+		frameSize += frameHeader.columnBytes[column];
+	}
+
+	stream.write((const char*)&frameHeader, sizeof(frameHeader));
+	for (int column = 0; column < TRAJECTORY_COLUMNS; column++) {
+		stream.write((const char*)blockBytes[column].data(), blocks * sizeof(uint32_t));
+		for (size_t block = 0; block < blocks; block++) {
+			stream.write((const char*)encoded[column][block].data(), encoded[column][block].size());
+		}
+	}
+
+	index.push_back({ frame->tick, offset, frameHeader.count, frameHeader.flags });
+	offset += frameSize;
+	bytesWritten += frameSize;
+	recordedFrames++;
+}
+
+/// <summary>
+/// Returns the number of frames written.
+/// </summary>
+uint64_t TrajectoryRecorder::getRecordedFrames() {
+	return recordedFrames;
+}
+
+/// <summary>
+/// Returns the number of frames dropped because the writer had fallen behind.
+/// </summary>
+uint64_t TrajectoryRecorder::getDroppedFrames() {
+	return droppedFrames;
+}
+
+/// <summary>
+/// Returns the number of bytes written so far.
+/// </summary>
+uint64_t TrajectoryRecorder::getBytesWritten() {
+	return bytesWritten;
+}
+
+/// <summary>
+/// Returns the path of the recording.
+/// </summary>
+const std::string& TrajectoryRecorder::getPath() {
+	return this->path;
+}
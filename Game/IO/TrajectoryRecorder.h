@@ -0,0 +1,103 @@
+#pragma once
+
+#ifndef TRAJECTORYRECORDER_H
+#define TRAJECTORYRECORDER_H
+
+#include "Trajectory.h"
+#include "../ParticleStorage.h"
+#include "../Parallel.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <string.h>
+
+// One tick of particle state on its way to disk.
+struct TrajectoryFrame {
+	uint64_t tick = 0;
+	size_t count = 0;
+	std::vector<float> columns[TRAJECTORY_COLUMNS];
+};
+
+// Streams trajectories to disk from a background thread. The simulation thread fills a frame
+// buffer from a small fixed set and hands its pointer over. Encoding and writing happen on the
+// writer thread, and if every buffer is still in flight the frame is dropped rather than waited for,
+// unless the recorder is blocking. Runs with no real-time deadline block so every frame is kept.
+class TrajectoryRecorder
+{
+public:
+	TrajectoryRecorder();
+	~TrajectoryRecorder();
+	bool Open(const std::string& path, const Bounds& world, unsigned int buffers, uint32_t keyframeInterval, float positionQuantum, float velocityQuantum);
+	void Close();
+	bool isOpen();
+	void setBlocking(bool blocking);
+	TrajectoryFrame* Acquire(size_t count);
+	void Submit(TrajectoryFrame* frame);
+	template<typename T> bool Record(const ParticleView<T>& particles, uint64_t tick);
+	uint64_t getRecordedFrames();
+	uint64_t getDroppedFrames();
+	uint64_t getBytesWritten();
+	const std::string& getPath();
+private:
+	void WriterLoop();
+	void Write(TrajectoryFrame* frame);
+	std::string path;
+	std::ofstream stream;
+	TrajectoryHeader header;
+	std::vector<TrajectoryIndexEntry> index;
+
+	// Frame buffers, free or waiting to be written.
+	std::vector<TrajectoryFrame> frames;
+	std::vector<TrajectoryFrame*> free;
+	std::deque<TrajectoryFrame*> pending;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable returned;
+	std::thread writer;
+	bool stopping = false;
+	bool blocking = false;
+
+	// Writer thread state.
+	std::vector<int32_t> state[TRAJECTORY_COLUMNS];
+	std::vector<std::vector<uint8_t>> encoded[TRAJECTORY_COLUMNS];
+	std::vector<uint32_t> blockBytes[TRAJECTORY_COLUMNS];
+	size_t lastCount = 0;
+	uint64_t offset = 0;
+
+	// Metrics
+	std::atomic<uint64_t> recordedFrames;
+	std::atomic<uint64_t> droppedFrames;
+	std::atomic<uint64_t> bytesWritten;
+};
+
+/// <summary>
+/// Copies particles into a frame buffer and hands it to the writer. Only waits on the writer if the recorder is blocking.
+/// </summary>
+/// <param name="particles">The particles.</param>
+/// <param name="tick">The tick being recorded.</param>
+/// <returns>False if the frame was dropped because every buffer was in flight.</returns>
+template<typename T>
+bool TrajectoryRecorder::Record(const ParticleView<T>& particles, uint64_t tick) {
+	TrajectoryFrame* frame = Acquire(particles.getCount());
+	if (!frame) return false;
+	frame->tick = tick;
+
+	const T* sources[TRAJECTORY_COLUMNS] = { particles.positionX, particles.positionY, particles.velocityX, particles.velocityY, particles.radius };
+	for (int column = 0; column < TRAJECTORY_COLUMNS; column++) {
+		const T* source = sources[column];
+		float* destination = frame->columns[column].data();
+		ParallelFor(particles.getCount(), 1 << 16, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				destination[i] = (float)source[i];
+			}
+		});
+	}
+
+	Submit(frame);
+	return true;
+}
+
+#endif
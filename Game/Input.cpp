@@ -6,6 +6,32 @@
 /// <param name="window">The window displaying information.</param>
 Input::Input(GLFWwindow* window) {
 	this->window = window;
+	for (int i = 0; i < 65535; i++) {
+		keyStates[i] = false;
+	}
+	for (int i = 0; i < 8; i++) {
+		mouseStates[i] = false;
+	}
+	glfwSetWindowUserPointer(window, this);
+	glfwSetScrollCallback(window, ScrollCallback);
+}
+
+/// <summary>
+/// GLFW scroll callback. Accumulates the vertical scroll until it is read.
+/// </summary>
+void Input::ScrollCallback(GLFWwindow* window, double, double yoffset) {
+	Input* input = (Input*)glfwGetWindowUserPointer(window);
+	if (input) input->scroll += yoffset;
+}
+
+/// <summary>
+/// Returns how far the mouse wheel has scrolled since the last call.
+/// </summary>
+/// <returns>The scroll offset, positive away from the user.</returns>
+double Input::getScroll() {
+	double value = this->scroll;
+	this->scroll = 0.0;
+	return value;
 }
 
 /// <summary>
@@ -42,10 +68,9 @@ bool Input::getKeyDown(int key) {
 /// <returns>True if the key was pressed.</returns>
 bool Input::getKeyPressed(int key) {
 	if (glfwGetKey(window, key) == GLFW_PRESS) {
+		bool wasDown = this->keyStates[key];
 		this->keyStates[key] = true;
-		if (!this->keyStates[key]) {
-			return true;
-		}
+		return !wasDown;
 	}
 	
 	this->keyStates[key] = false;
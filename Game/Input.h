@@ -19,7 +19,10 @@ public:
 	bool getMouseButtonPressed(int button);
 	bool getMouseButtonDown(int button);
 	bool getMouseButtonUp(int button);
+	double getScroll();
 private:
+	static void ScrollCallback(GLFWwindow* window, double xoffset, double yoffset);
+	double scroll = 0.0;
 	bool keyStates[65535];
 	bool mouseStates[8];
 	GLFWwindow* window;
@@ -0,0 +1,125 @@
+#include "InstanceBatch.h"
+#include "Transform2D.h"
+
+// Vertex attribute locations of the instance data in main.vs.
+const GLuint BASIS_ATTRIBUTE = 1;
+const GLuint OFFSET_ATTRIBUTE = 2;
+const GLuint COLOR_ATTRIBUTE = 3;
+
+/// <summary>
+/// Instance Batch Constructor.
+/// </summary>
+/// <param name="mesh">The mesh every instance draws.</param>
+InstanceBatch::InstanceBatch(Mesh* mesh) {
+    this->mesh = mesh;
+    glGenBuffers(1, &buffer);
+}
+
+/// <summary>
+/// Instance Batch Deconstructor.
+/// </summary>
+InstanceBatch::~InstanceBatch() {
+    glDeleteBuffers(1, &buffer);
+}
+
+/// <summary>
+/// Empties the batch for a new frame.
+/// </summary>
+void InstanceBatch::Clear() {
+    x.clear();
+    y.clear();
+    cos.clear();
+    sin.clear();
+    scaleX.clear();
+    scaleY.clear();
+    colors.clear();
+}
+
+/// <summary>
+/// Adds an instance to the batch.
+/// </summary>
+/// <param name="position">The position of the instance.</param>
+/// <param name="cos">The cosine of its rotation.</param>
+/// <param name="sin">The sine of its rotation.</param>
+/// <param name="scale">The scale of the instance.</param>
+/// <param name="color">The RGB color of the instance.</param>
+void InstanceBatch::Add(const Vector2& position, float cos, float sin, const Vector2& scale, const float* color) {
+    this->x.push_back(position.x);
+    this->y.push_back(position.y);
+    this->cos.push_back(cos);
+    this->sin.push_back(sin);
+    this->scaleX.push_back(scale.x);
+    this->scaleY.push_back(scale.y);
+    this->colors.insert(this->colors.end(), color, color + 3);
+}
+
+/// <summary>
+/// Grows the instance buffer and points the mesh's instance attributes at its regions.
+/// </summary>
+/// <param name="capacity">The number of instances the buffer must hold.</param>
+void InstanceBatch::Reserve(size_t capacity) {
+    if (capacity <= this->capacity) return;
+    size_t size = this->capacity == 0 ? 1024 : this->capacity;
+    while (size < capacity) size *= 2;
+    this->capacity = size;
+
+    // The buffer holds every basis, then every offset, then every color.
+    size_t basisBytes = size * 4 * sizeof(float);
+    size_t offsetBytes = size * 2 * sizeof(float);
+    size_t colorBytes = size * 3 * sizeof(float);
+
+    glBindVertexArray(mesh->getVAO().index);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, basisBytes + offsetBytes + colorBytes, NULL, GL_STREAM_DRAW);
+
+    glVertexAttribPointer(BASIS_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glVertexAttribPointer(OFFSET_ATTRIBUTE, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)basisBytes);
+    glVertexAttribPointer(COLOR_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)(basisBytes + offsetBytes));
+    GLuint attributes[] = { BASIS_ATTRIBUTE, OFFSET_ATTRIBUTE, COLOR_ATTRIBUTE };
+    for (GLuint attribute : attributes) {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribDivisor(attribute, 1);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+/// <summary>
+/// Builds every transform in the batch, uploads them and draws all instances in one call.
+/// </summary>
+void InstanceBatch::Draw() {
+    size_t count = x.size();
+    if (count == 0) return;
+    Reserve(count);
+
+    basis.resize(count * 4);
+    offset.resize(count * 2);
+    Transform2D::WriteBatch(count, x.data(), y.data(), cos.data(), sin.data(), scaleX.data(), scaleY.data(), basis.data(), offset.data());
+
+    size_t basisBytes = capacity * 4 * sizeof(float);
+    size_t offsetBytes = capacity * 2 * sizeof(float);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count * 4 * sizeof(float), basis.data());
+    glBufferSubData(GL_ARRAY_BUFFER, basisBytes, count * 2 * sizeof(float), offset.data());
+    glBufferSubData(GL_ARRAY_BUFFER, basisBytes + offsetBytes, count * 3 * sizeof(float), colors.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindVertexArray(mesh->getVAO().index);
+    glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)mesh->getIndexCount(), GL_UNSIGNED_INT, 0, (GLsizei)count);
+    glBindVertexArray(0);
+}
+
+/// <summary>
+/// Returns the number of instances in the batch.
+/// </summary>
+size_t InstanceBatch::getCount() {
+    return x.size();
+}
+
+/// <summary>
+/// Returns the mesh every instance draws.
+/// </summary>
+Mesh* InstanceBatch::getMesh() {
+    return this->mesh;
+}
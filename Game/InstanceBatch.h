@@ -0,0 +1,43 @@
+#pragma once
+
+#ifndef INSTANCEBATCH_H
+#define INSTANCEBATCH_H
+
+#include "Common.h"
+#include "Mesh.h"
+#include "Vector2.h"
+#include "AlignedAllocator.h"
+
+// Collects the instances of one mesh for a frame and draws them in a single instanced call.
+// Transforms are built for the whole batch at once by Transform2D::WriteBatch.
+class InstanceBatch
+{
+public:
+	InstanceBatch(Mesh* mesh);
+	~InstanceBatch();
+	void Clear();
+	void Add(const Vector2& position, float cos, float sin, const Vector2& scale, const float* color);
+	void Draw();
+	size_t getCount();
+	Mesh* getMesh();
+private:
+	void Reserve(size_t capacity);
+	Mesh* mesh;
+	GLuint buffer = 0;
+	size_t capacity = 0;
+
+	// Per instance inputs, gathered as the entities are walked.
+	std::vector<float, AlignedAllocator<float>> x;
+	std::vector<float, AlignedAllocator<float>> y;
+	std::vector<float, AlignedAllocator<float>> cos;
+	std::vector<float, AlignedAllocator<float>> sin;
+	std::vector<float, AlignedAllocator<float>> scaleX;
+	std::vector<float, AlignedAllocator<float>> scaleY;
+	std::vector<float> colors;
+
+	// Per instance outputs, uploaded as three regions of the instance buffer.
+	std::vector<float, AlignedAllocator<float>> basis;
+	std::vector<float, AlignedAllocator<float>> offset;
+};
+
+#endif
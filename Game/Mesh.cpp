@@ -27,6 +27,12 @@ Mesh::Mesh(std::vector<GLfloat> vertices, std::vector<GLuint> indices) {
     glBindVertexArray(0);
 }
 
+Mesh::~Mesh() {
+    glDeleteBuffers(1, &vao.verticesVBO);
+    glDeleteBuffers(1, &vao.indicesEBO);
+    glDeleteVertexArrays(1, &vao.index);
+}
+
 std::vector<GLfloat> Mesh::getVertices() {
 	return this->vertices;
 }
@@ -35,6 +41,10 @@ std::vector<GLuint> Mesh::getIndices() {
 	return this->indices;
 }
 
+size_t Mesh::getIndexCount() {
+    return this->indices.size();
+}
+
 VAO Mesh::getVAO() {
     return this->vao;
 }
\ No newline at end of file
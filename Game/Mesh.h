@@ -9,8 +9,10 @@ class Mesh
 {
 public:
 	Mesh(std::vector<GLfloat> vertices, std::vector<GLuint> indices);
+	~Mesh();
 	std::vector<GLfloat> getVertices();
 	std::vector<GLuint> getIndices();
+	size_t getIndexCount();
 	VAO getVAO();
 private:
 	std::vector<GLfloat> vertices;
@@ -0,0 +1,214 @@
+/*
+Multi-rate time stepping. Regions with fast or non-pooled entities, and the
+regions on screen, step every tick. Every other region steps every 2^level
+ticks, with its level set by its distance to the nearest such region, so the
+step only ever doubles from one region to the next. Levels are reassigned
+every 2^maxLevel ticks, when every region has just stepped.
+*/
+
+#include "MultiRateScheduler.h"
+#include <math.h>
+
+// The camera only keeps regions at full rate when it covers fewer regions than this.
+const size_t MAX_VIEW_REGIONS = 4096;
+
+/// <summary>
+/// Multi-Rate Scheduler Constructor.
+/// </summary>
+/// <param name="regionSize">The width of a region in world units.</param>
+/// <param name="maxLevel">The slowest level. Its regions step every 2^maxLevel ticks.</param>
+/// <param name="calmSpeed">The speed above which an entity keeps its region at full rate.</param>
+MultiRateScheduler::MultiRateScheduler(float regionSize, unsigned int maxLevel, float calmSpeed) {
+    this->regionSize = regionSize;
+    this->maxLevel = maxLevel;
+    this->calmSpeed = calmSpeed;
+    this->regionCounts.assign(maxLevel + 1, 0);
+}
+
+/// <summary>
+/// Packs a region's coordinates into a key.
+/// </summary>
+uint64_t MultiRateScheduler::getKey(int regionX, int regionY) {
+    return ((uint64_t)(uint32_t)regionX << 32) | (uint64_t)(uint32_t)regionY;
+}
+
+/// <summary>
+/// Returns the key of the region containing a position.
+/// </summary>
+uint64_t MultiRateScheduler::getKey(const Vector2& position) {
+    return getKey((int)floorf(position.x / regionSize), (int)floorf(position.y / regionSize));
+}
+
+/// <summary>
+/// Works out which entities step this tick. On ticks where every level is due the levels are
+/// reassigned. On other ticks a slow entity that has sped up drops to full rate, which is always in step.
+/// </summary>
+/// <param name="tick">The tick about to be stepped.</param>
+/// <param name="entities">The list of live entities.</param>
+/// <param name="pool">The pool, as only pooled particles may step slowly.</param>
+/// <param name="view">The region on screen, which always steps every tick.</param>
+void MultiRateScheduler::BeginTick(unsigned int tick, const std::vector<Entity*>& entities, ParticlePool* pool, const Bounds& view) {
+    this->tick = tick;
+    bool synchronised = (tick & ((1u << maxLevel) - 1)) == 0;
+
+    // Switching on or off waits until every region is in step.
+    if (synchronised && enabled != requested) {
+        enabled = requested;
+        for (size_t i = 0; i < entities.size(); i++) {
+            entities[i]->setRateLevel(0);
+        }
+    }
+
+    if (!enabled) {
+        dueCount = entityCount = entities.size();
+        return;
+    }
+
+    if (synchronised) Assign(entities, pool, view);
+
+    dueCount = 0;
+    entityCount = entities.size();
+    for (size_t i = 0; i < entities.size(); i++) {
+        Entity* ent = entities[i];
+        if (!isDue(ent)) continue;
+        if (ent->getRateLevel() > 0 && ent->velocity.MagnitudeSqr() > calmSpeed * calmSpeed) ent->setRateLevel(0);
+        dueCount++;
+    }
+}
+
+/// <summary>
+/// Assigns every region its level, and every entity the level of its region.
+/// </summary>
+void MultiRateScheduler::Assign(const std::vector<Entity*>& entities, ParticlePool* pool, const Bounds& view) {
+    levels.clear();
+
+    // Regions with anything fast, or anything that isn't a free pooled circle, run at full rate.
+    // The constraint solver moves its bodies every substep, so rope and cloth nodes count as active too.
+    std::vector<uint64_t> frontier;
+    for (size_t i = 0; i < entities.size(); i++) {
+        Entity* ent = entities[i];
+        if (!ent->isAlive()) continue;
+
+        uint64_t key = getKey(ent->position);
+        auto inserted = levels.emplace(key, maxLevel);
+        bool active = ent->type != CIRCLE || ent->isKinematic() || ent->isConstrained() || !pool->Owns(ent)
+            || ent->velocity.MagnitudeSqr() > calmSpeed * calmSpeed;
+        if (active && inserted.first->second != 0) {
+            inserted.first->second = 0;
+            frontier.push_back(key);
+        }
+    }
+
+    int minX = (int)floorf(view.min.x / regionSize), maxX = (int)floorf(view.max.x / regionSize);
+    int minY = (int)floorf(view.min.y / regionSize), maxY = (int)floorf(view.max.y / regionSize);
+    if ((size_t)(maxX - minX + 1) * (size_t)(maxY - minY + 1) <= MAX_VIEW_REGIONS) {
+        for (int y = minY; y <= maxY; y++) {
+            for (int x = minX; x <= maxX; x++) {
+                uint64_t key = getKey(x, y);
+                unsigned int& level = levels.emplace(key, maxLevel).first->second;
+                if (level == 0) continue;
+                level = 0;
+                frontier.push_back(key);
+            }
+        }
+    }
+
+    // Spread outward one ring of regions per level, so each region's level is its distance
+    // to the nearest full rate region and neighbours never differ by more than one.
+    std::vector<uint64_t> next;
+    for (unsigned int level = 1; level < maxLevel && !frontier.empty(); level++) {
+        next.clear();
+        for (size_t i = 0; i < frontier.size(); i++) {
+            int regionX = (int)(int32_t)(uint32_t)(frontier[i] >> 32);
+            int regionY = (int)(int32_t)(uint32_t)(frontier[i] & 0xFFFFFFFF);
+            for (int y = regionY - 1; y <= regionY + 1; y++) {
+                for (int x = regionX - 1; x <= regionX + 1; x++) {
+                    uint64_t key = getKey(x, y);
+                    unsigned int& neighbour = levels.emplace(key, maxLevel).first->second;
+                    if (neighbour <= level) continue;
+                    neighbour = level;
+                    next.push_back(key);
+                }
+            }
+        }
+        frontier.swap(next);
+    }
+
+    regionCounts.assign(maxLevel + 1, 0);
+    for (auto it = levels.begin(); it != levels.end(); ++it) {
+        regionCounts[it->second]++;
+    }
+
+    for (size_t i = 0; i < entities.size(); i++) {
+        Entity* ent = entities[i];
+        ent->setRateLevel(ent->isAlive() ? levels[getKey(ent->position)] : 0);
+    }
+}
+
+/// <summary>
+/// Returns whether an entity steps this tick.
+/// </summary>
+/// <param name="entity">The entity.</param>
+/// <returns>True if the tick is a multiple of the entity's step.</returns>
+bool MultiRateScheduler::isDue(Entity* entity) {
+    return (tick & ((1u << entity->getRateLevel()) - 1)) == 0;
+}
+
+/// <summary>
+/// Returns how far an entity steps when it is due, covering every tick since it last stepped.
+/// </summary>
+/// <param name="entity">The entity.</param>
+/// <param name="timestep">The step at full rate.</param>
+/// <returns>The entity's step.</returns>
+float MultiRateScheduler::getTimestep(Entity* entity, float timestep) {
+    return timestep * (float)(1u << entity->getRateLevel());
+}
+
+/// <summary>
+/// Returns whether slow regions step at a slower rate, or will once the switch takes effect.
+/// </summary>
+/// <returns>True if multi-rate stepping is on.</returns>
+bool MultiRateScheduler::isEnabled() {
+    return this->requested;
+}
+
+/// <summary>
+/// Turns multi-rate stepping on or off. It takes effect on the next tick where every region is in step.
+/// </summary>
+/// <param name="enabled">Whether multi-rate stepping is on.</param>
+void MultiRateScheduler::setEnabled(bool enabled) {
+    this->requested = enabled;
+}
+
+/// <summary>
+/// Returns the slowest level.
+/// </summary>
+/// <returns>The maximum level.</returns>
+unsigned int MultiRateScheduler::getMaxLevel() {
+    return this->maxLevel;
+}
+
+/// <summary>
+/// Returns how many entities step this tick.
+/// </summary>
+/// <returns>The number of due entities.</returns>
+size_t MultiRateScheduler::getDueCount() {
+    return this->dueCount;
+}
+
+/// <summary>
+/// Returns how many entities there were this tick.
+/// </summary>
+/// <returns>The number of entities.</returns>
+size_t MultiRateScheduler::getEntityCount() {
+    return this->entityCount;
+}
+
+/// <summary>
+/// Returns how many regions were at a level when levels were last assigned.
+/// </summary>
+/// <param name="level">The level.</param>
+/// <returns>The number of regions at that level.</returns>
+size_t MultiRateScheduler::getRegionCount(unsigned int level) {
+    return level < regionCounts.size() ? regionCounts[level] : 0;
+}
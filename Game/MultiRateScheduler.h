@@ -0,0 +1,48 @@
+#pragma once
+
+#ifndef MULTIRATESCHEDULER_H
+#define MULTIRATESCHEDULER_H
+
+#include "ParticlePool.h"
+#include "Bounds.h"
+#include <stdint.h>
+#include <unordered_map>
+
+// Steps calm regions away from the camera at a slower rate. The world is split into regions,
+// and each region runs at a step of 2^level ticks, where the level grows with the distance
+// from the nearest active region. Neighbouring regions are at most one level apart, and levels
+// are only reassigned on ticks where every level is due, so all regions are in step there.
+class MultiRateScheduler
+{
+public:
+	MultiRateScheduler(float regionSize, unsigned int maxLevel, float calmSpeed);
+	void BeginTick(unsigned int tick, const std::vector<Entity*>& entities, ParticlePool* pool, const Bounds& view);
+	bool isDue(Entity* entity);
+	float getTimestep(Entity* entity, float timestep);
+	bool isEnabled();
+	void setEnabled(bool enabled);
+	unsigned int getMaxLevel();
+	size_t getDueCount();
+	size_t getEntityCount();
+	size_t getRegionCount(unsigned int level);
+private:
+	uint64_t getKey(int regionX, int regionY);
+	uint64_t getKey(const Vector2& position);
+	void Assign(const std::vector<Entity*>& entities, ParticlePool* pool, const Bounds& view);
+	float regionSize;
+	unsigned int maxLevel;
+	float calmSpeed;
+	bool enabled = true;
+	bool requested = true;
+	unsigned int tick = 0;
+
+	// The level of every region holding or near an entity, from the last time levels were assigned.
+	std::unordered_map<uint64_t, unsigned int> levels;
+	std::vector<size_t> regionCounts;
+
+	// Metrics
+	size_t dueCount = 0;
+	size_t entityCount = 0;
+};
+
+#endif
@@ -0,0 +1,130 @@
+#include "Parallel.h"
+
+/// <summary>
+/// Returns the process wide thread pool, starting it on first use.
+/// </summary>
+/// <returns>The thread pool.</returns>
+ThreadPool& ThreadPool::Instance() {
+	static ThreadPool pool;
+	return pool;
+}
+
+/// <summary>
+/// Thread Pool Constructor. Starts one worker per hardware thread, less the caller.
+/// </summary>
+ThreadPool::ThreadPool() {
+	unsigned int threads = std::thread::hardware_concurrency();
+	for (unsigned int i = 1; i < threads; i++) {
+		workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+/// <summary>
+/// Thread Pool Deconstructor. Stops and joins every worker.
+/// </summary>
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (size_t i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+}
+
+/// <summary>
+/// Returns the number of threads that run jobs, including the caller.
+/// </summary>
+/// <returns>The thread count.</returns>
+unsigned int ThreadPool::getThreadCount() {
+	return (unsigned int)workers.size() + 1;
+}
+
+/// <summary>
+/// Runs a job to completion. The caller works through chunks alongside the workers.
+/// </summary>
+/// <param name="count">The number of items.</param>
+/// <param name="grain">The minimum number of items per chunk.</param>
+/// <param name="function">Called with the [begin, end) range of each chunk.</param>
+void ThreadPool::Run(size_t count, size_t grain, const std::function<void(size_t, size_t)>& function) {
+	if (grain == 0) grain = 1;
+
+	// Aim for a few chunks per thread so uneven work still balances.
+	size_t chunks = (count + grain - 1) / grain;
+	size_t maxChunks = (size_t)getThreadCount() * 4;
+	if (chunks > maxChunks) chunks = maxChunks;
+
+	if (chunks <= 1 || workers.empty()) {
+		function(0, count);
+		return;
+	}
+
+	Job job;
+	job.function = &function;
+	job.count = count;
+	job.grain = grain;
+	job.chunks = chunks;
+	job.next = 0;
+	job.remaining = chunks;
+	job.users = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(&job);
+	}
+	wake.notify_all();
+
+	while (RunChunk(&job));
+
+	// Wait for the workers still running chunks, and for every worker to let go of the job.
+	std::unique_lock<std::mutex> lock(mutex);
+	for (size_t i = 0; i < jobs.size(); i++) {
+		if (jobs[i] == &job) {
+			jobs.erase(jobs.begin() + i);
+			break;
+		}
+	}
+	done.wait(lock, [&job] { return job.remaining == 0 && job.users == 0; });
+}
+
+/// <summary>
+/// Claims and runs the next chunk of a job.
+/// </summary>
+/// <param name="job">The job being worked on.</param>
+/// <returns>False once every chunk has been claimed.</returns>
+bool ThreadPool::RunChunk(Job* job) {
+	size_t chunk = job->next.fetch_add(1);
+	if (chunk >= job->chunks) return false;
+
+	size_t begin = job->count * chunk / job->chunks;
+	size_t end = job->count * (chunk + 1) / job->chunks;
+	(*job->function)(begin, end);
+	job->remaining.fetch_sub(1);
+	return true;
+}
+
+/// <summary>
+/// Worker thread body. Sleeps until a job is queued and helps finish it.
+/// </summary>
+void ThreadPool::WorkerLoop() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+		if (stopping) return;
+
+		Job* job = jobs.front();
+		job->users++;
+		lock.unlock();
+
+		while (RunChunk(job));
+
+		lock.lock();
+		// The job is exhausted, so nobody else should pick it up.
+		if (!jobs.empty() && jobs.front() == job) {
+			jobs.pop_front();
+		}
+		job->users--;
+		done.notify_all();
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A persistent pool of worker threads shared by the simulation passes.
+// The calling thread always helps run its own job, so nested or concurrent
+// calls from several threads never deadlock.
+class ThreadPool
+{
+public:
+	static ThreadPool& Instance();
+	unsigned int getThreadCount();
+	void Run(size_t count, size_t grain, const std::function<void(size_t, size_t)>& function);
+private:
+	struct Job {
+		const std::function<void(size_t, size_t)>* function;
+		size_t count;
+		size_t grain;
+		size_t chunks;
+		std::atomic<size_t> next;
+		std::atomic<size_t> remaining;
+		unsigned int users;
+	};
+
+	ThreadPool();
+	~ThreadPool();
+	void WorkerLoop();
+	bool RunChunk(Job* job);
+	std::vector<std::thread> workers;
+	std::deque<Job*> jobs;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	bool stopping = false;
+};
+
+/// <summary>
+/// Splits [0, count) into chunks of at least grain items and runs them across the thread pool.
+/// </summary>
+/// <param name="count">The number of items.</param>
+/// <param name="grain">The minimum number of items per chunk.</param>
+/// <param name="function">Called with the [begin, end) range of each chunk.</param>
+template<typename Function>
+void ParallelFor(size_t count, size_t grain, Function function) {
+	if (count == 0) return;
+	if (count <= grain) {
+		function((size_t)0, count);
+		return;
+	}
+	std::function<void(size_t, size_t)> wrapped = function;
+	ThreadPool::Instance().Run(count, grain, wrapped);
+}
+
+#endif
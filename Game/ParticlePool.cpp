@@ -0,0 +1,233 @@
+/*
+A pool of circles. Slots are allocated a block at a time as more particles are
+alive at once, and expired slots are recycled through a ring buffer, so
+emitting and absorbing particles only touches the heap when the pool grows.
+Blocks left with no live particle are freed again, keeping one block's worth
+of free slots in hand, so memory shrinks once particles are paged out or
+absorbed but steady churn never frees and reallocates the same block.
+*/
+
+#include "ParticlePool.h"
+#include <algorithm>
+#include <functional>
+
+/// <summary>
+/// Particle Pool Constructor. Slots are allocated as they are first needed.
+/// </summary>
+/// <param name="capacity">The maximum number of live particles.</param>
+/// <param name="mesh">The mesh shared by every particle.</param>
+ParticlePool::ParticlePool(unsigned int capacity, Mesh* mesh) {
+    this->capacity = capacity;
+    this->mesh = mesh;
+}
+
+/// <summary>
+/// Allocates another block of slots and puts them all in the ring buffer. Only called when it is empty.
+/// Blocks freed by Trim are made again before the pool grows past them.
+/// </summary>
+/// <returns>False if the pool is at its capacity.</returns>
+bool ParticlePool::Grow() {
+    unsigned int added = 0;
+    while (added < blocks.size() && !blocks[added].empty()) added++;
+    if (added * PARTICLE_BLOCK_SIZE >= capacity) return false;
+    unsigned int count = std::min(PARTICLE_BLOCK_SIZE, capacity - added * PARTICLE_BLOCK_SIZE);
+    unsigned int first = added * PARTICLE_BLOCK_SIZE;
+
+    if (added == blocks.size()) {
+        blocks.emplace_back();
+        blockLive.push_back(0);
+        radii.resize(first + count);
+    }
+    std::vector<EntityCircle>& block = blocks[added];
+    block.reserve(count);
+    for (unsigned int i = 0; i < count; i++) {
+        block.emplace_back(Vector2(0.0f, 0.0f), mesh);
+        block[i].Kill();
+        radii[first + i] = block[i].getRadius();
+    }
+    allocated += count;
+
+    std::less<const EntityCircle*> before;
+    blockOrder.insert(std::upper_bound(blockOrder.begin(), blockOrder.end(), added, [&](unsigned int a, unsigned int b) {
+        return before(blocks[a].data(), blocks[b].data());
+    }), added);
+
+    // The ring is empty, so it can be laid out afresh with room for every slot.
+    freeRing.resize(allocated);
+    for (unsigned int i = 0; i < count; i++) {
+        freeRing[i] = first + i;
+    }
+    freeHead = 0;
+    freeCount = count;
+    return true;
+}
+
+/// <summary>
+/// Frees blocks with no live particles, as long as another block's worth of free slots stays allocated.
+/// A block holding a dead particle the constraint solver still refers to is kept until the constraint is pruned.
+/// </summary>
+void ParticlePool::Trim() {
+    unsigned int spare = freeCount;
+    bool trimmed = false;
+    for (size_t b = blocks.size(); b-- > 0;) {
+        std::vector<EntityCircle>& block = blocks[b];
+        unsigned int count = (unsigned int)block.size();
+        if (count == 0 || blockLive[b] > 0 || spare < count + PARTICLE_BLOCK_SIZE) continue;
+
+        bool referenced = false;
+        for (unsigned int i = 0; i < count && !referenced; i++) {
+            referenced = block[i].isConstrained();
+        }
+        if (referenced) continue;
+
+        blockOrder.erase(std::find(blockOrder.begin(), blockOrder.end(), (unsigned int)b));
+        std::vector<EntityCircle>().swap(block);
+        allocated -= count;
+        spare -= count;
+        trimmed = true;
+    }
+    if (!trimmed) return;
+
+    // Drop the freed slots from the ring, keeping the rest oldest first.
+    std::vector<unsigned int> ring;
+    ring.reserve(allocated);
+    for (unsigned int i = 0; i < freeCount; i++) {
+        unsigned int index = freeRing[(freeHead + i) % freeRing.size()];
+        if (!blocks[index / PARTICLE_BLOCK_SIZE].empty()) ring.push_back(index);
+    }
+    freeCount = (unsigned int)ring.size();
+    ring.resize(allocated);
+    freeRing.swap(ring);
+    freeHead = 0;
+}
+
+/// <summary>
+/// Returns the slot at an index. Every block but the last is full.
+/// </summary>
+EntityCircle* ParticlePool::getSlot(unsigned int index) {
+    return &blocks[index / PARTICLE_BLOCK_SIZE][index % PARTICLE_BLOCK_SIZE];
+}
+
+/// <summary>
+/// Finds the index of an entity's slot.
+/// </summary>
+/// <param name="entity">The entity.</param>
+/// <param name="index">Receives the index of its slot.</param>
+/// <returns>False if the entity isn't one of the pool's slots.</returns>
+bool ParticlePool::Find(Entity* entity, unsigned int& index) {
+    std::less<const Entity*> before;
+    auto after = std::upper_bound(blockOrder.begin(), blockOrder.end(), entity, [&](Entity* e, unsigned int b) {
+        return before(e, blocks[b].data());
+    });
+    if (after == blockOrder.begin()) return false;
+
+    unsigned int block = *(after - 1);
+    const EntityCircle* first = blocks[block].data();
+    if (!before(entity, first + blocks[block].size())) return false;
+
+    // Only a pointer to the start of a slot is one of ours.
+    size_t offset = (size_t)((const char*)entity - (const char*)first);
+    if (offset % sizeof(EntityCircle) != 0) return false;
+    index = block * PARTICLE_BLOCK_SIZE + (unsigned int)(offset / sizeof(EntityCircle));
+    return true;
+}
+
+/// <summary>
+/// Takes the oldest free slot from the ring buffer and respawns it with the slot's own radius and mass.
+/// </summary>
+/// <param name="position">The position the particle will spawn.</param>
+/// <param name="velocity">The initial velocity of the particle.</param>
+/// <param name="lifetime">The time-to-live in seconds. Zero or less never expires.</param>
+/// <returns>The spawned particle, or nullptr if the pool is exhausted.</returns>
+EntityCircle* ParticlePool::Spawn(Vector2 position, Vector2 velocity, float lifetime) {
+    if (freeCount == 0 && !Grow()) return nullptr;
+
+    unsigned int index = freeRing[freeHead];
+    freeHead = (freeHead + 1) % freeRing.size();
+    freeCount--;
+
+    blockLive[index / PARTICLE_BLOCK_SIZE]++;
+
+    EntityCircle* particle = getSlot(index);
+    particle->setRadius(radii[index]);
+    particle->Respawn(position, velocity, lifetime);
+    particle->setKinematic(false);
+    return particle;
+}
+
+/// <summary>
+/// Returns a slot to the back of the ring buffer.
+/// </summary>
+/// <param name="index">The index of the slot being released.</param>
+void ParticlePool::Release(unsigned int index) {
+    blockLive[index / PARTICLE_BLOCK_SIZE]--;
+    freeRing[(freeHead + freeCount) % freeRing.size()] = index;
+    freeCount++;
+}
+
+/// <summary>
+/// Removes expired and absorbed particles from the entity list and recycles their slots, then frees blocks left empty.
+/// Dead entities the pool doesn't own are deleted. Entities are swap-removed so the list never reallocates.
+/// </summary>
+/// <param name="entities">The list of live entities.</param>
+/// <param name="absorbers">The absorber regions that remove particles entering them.</param>
+void ParticlePool::Reap(std::vector<Entity*>& entities, const std::vector<Absorber>& absorbers) {
+    for (size_t i = 0; i < entities.size();) {
+        Entity* ent = entities[i];
+
+        if (ent->isAlive()) {
+            for (size_t j = 0; j < absorbers.size(); j++) {
+                if (absorbers[j].Contains(ent->position)) {
+                    ent->Kill();
+                    break;
+                }
+            }
+        }
+
+        if (ent->isAlive()) {
+            i++;
+            continue;
+        }
+
+        unsigned int index;
+        if (Find(ent, index)) Release(index);
+        else delete ent;
+        entities[i] = entities.back();
+        entities.pop_back();
+    }
+    Trim();
+}
+
+/// <summary>
+/// Returns whether an entity lives in this pool.
+/// </summary>
+/// <param name="entity">The entity being checked.</param>
+/// <returns>True if the entity is one of the pool's slots.</returns>
+bool ParticlePool::Owns(Entity* entity) {
+    unsigned int index;
+    return Find(entity, index);
+}
+
+/// <summary>
+/// Returns the most slots the pool will grow to.
+/// </summary>
+/// <returns>The capacity of the pool.</returns>
+unsigned int ParticlePool::getCapacity() {
+    return this->capacity;
+}
+
+/// <summary>
+/// Returns the number of slots in memory.
+/// </summary>
+/// <returns>The number of slots in allocated blocks.</returns>
+unsigned int ParticlePool::getAllocatedCount() {
+    return this->allocated;
+}
+
+/// <summary>
+/// Returns the number of slots currently in use.
+/// </summary>
+/// <returns>The number of live particles.</returns>
+unsigned int ParticlePool::getActiveCount() {
+    return getAllocatedCount() - freeCount;
+}
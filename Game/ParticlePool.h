@@ -0,0 +1,48 @@
+#pragma once
+
+#ifndef PARTICLEPOOL_H
+#define PARTICLEPOOL_H
+
+#include "Common.h"
+#include "Entities/Entity.h"
+#include "Absorber.h"
+
+// A pool of circles, allocated a block at a time as more are alive at once and freed again a block
+// at a time once they are gone, so its memory follows the particles alive rather than the capacity.
+class ParticlePool
+{
+public:
+	ParticlePool(unsigned int capacity, Mesh* mesh);
+	~ParticlePool() = default;
+	EntityCircle* Spawn(Vector2 position, Vector2 velocity, float lifetime);
+	void Reap(std::vector<Entity*>& entities, const std::vector<Absorber>& absorbers);
+	bool Owns(Entity* entity);
+	unsigned int getCapacity();
+	unsigned int getAllocatedCount();
+	unsigned int getActiveCount();
+private:
+	bool Grow();
+	void Trim();
+	bool Find(Entity* entity, unsigned int& index);
+	EntityCircle* getSlot(unsigned int index);
+	void Release(unsigned int index);
+	unsigned int capacity;
+	Mesh* mesh;
+
+	// Blocks never move once made, so their slots can be handed out as pointers. A freed block is left empty,
+	// so every slot keeps its index, and is made again before the pool grows past it.
+	std::vector<std::vector<EntityCircle>> blocks;
+	std::vector<unsigned int> blockLive;
+	unsigned int allocated = 0;
+
+	// Block indices sorted by the address of their first slot, to find a slot's block.
+	std::vector<unsigned int> blockOrder;
+
+	// The radius each slot was made with, restored on spawn so a slot never keeps its last user's size.
+	std::vector<float> radii;
+	std::vector<unsigned int> freeRing;
+	unsigned int freeHead = 0;
+	unsigned int freeCount = 0;
+};
+
+#endif
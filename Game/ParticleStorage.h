@@ -0,0 +1,231 @@
+#pragma once
+
+#ifndef PARTICLESTORAGE_H
+#define PARTICLESTORAGE_H
+
+#include "Vector2.h"
+#include "AlignedAllocator.h"
+#include <vector>
+
+// Pointers to the columns of a set of particles, wherever they live. Kernels that take a view
+// run the same on particle storage and on columns mapped straight from a snapshot file.
+template<typename T>
+struct ParticleView {
+	T* positionX;
+	T* positionY;
+	T* velocityX;
+	T* velocityY;
+	T* forceX;
+	T* forceY;
+	T* inverseMass;
+	T* radius;
+	size_t count;
+
+	size_t getCount() const { return count; }
+};
+
+// Particle state for the bulk simulation core, stored as one aligned array per field
+// so kernels stream through exactly the fields they need. T is the simulation's scalar,
+// chosen at compile time through Real in Common.h.
+template<typename T>
+class ParticleStorage
+{
+public:
+	typedef std::vector<T, AlignedAllocator<T>> Array;
+
+	ParticleStorage();
+	ParticleStorage(size_t capacity);
+	size_t Add(const Vector2T<T>& position, const Vector2T<T>& velocity, T radius, T mass);
+	void Remove(size_t index);
+	void Clear();
+	void Reserve(size_t capacity);
+	void Resize(size_t count);
+	size_t getCount() const;
+	size_t getCapacity() const;
+	Vector2T<T> getPosition(size_t index) const;
+	void setPosition(size_t index, const Vector2T<T>& position);
+	Vector2T<T> getVelocity(size_t index) const;
+	void setVelocity(size_t index, const Vector2T<T>& velocity);
+	ParticleView<T> getView();
+	void Assign(const ParticleView<T>& view);
+	Array positionX;
+	Array positionY;
+	Array velocityX;
+	Array velocityY;
+	Array forceX;
+	Array forceY;
+	Array inverseMass;
+	Array radius;
+};
+
+/// <summary>
+/// Empty Particle Storage Constructor.
+/// </summary>
+template<typename T>
+ParticleStorage<T>::ParticleStorage() {
+
+}
+
+/// <summary>
+/// Particle Storage Constructor that reserves room up front.
+/// </summary>
+/// <param name="capacity">The number of particles to reserve room for.</param>
+template<typename T>
+ParticleStorage<T>::ParticleStorage(size_t capacity) {
+	Reserve(capacity);
+}
+
+/// <summary>
+/// Appends a particle.
+/// </summary>
+/// <param name="position">The position of the particle.</param>
+/// <param name="velocity">The velocity of the particle.</param>
+/// <param name="radius">The radius of the particle.</param>
+/// <param name="mass">The mass of the particle. Zero makes it immovable.</param>
+/// <returns>The index of the new particle.</returns>
+template<typename T>
+size_t ParticleStorage<T>::Add(const Vector2T<T>& position, const Vector2T<T>& velocity, T radius, T mass) {
+	positionX.push_back(position.x);
+	positionY.push_back(position.y);
+	velocityX.push_back(velocity.x);
+	velocityY.push_back(velocity.y);
+	forceX.push_back(T(0));
+	forceY.push_back(T(0));
+	inverseMass.push_back(mass > T(0) ? T(1) / mass : T(0));
+	this->radius.push_back(radius);
+	return positionX.size() - 1;
+}
+
+/// <summary>
+/// Removes a particle by moving the last particle into its place. Indices past it are unchanged.
+/// </summary>
+/// <param name="index">The index of the particle.</param>
+template<typename T>
+void ParticleStorage<T>::Remove(size_t index) {
+	Array* fields[] = { &positionX, &positionY, &velocityX, &velocityY, &forceX, &forceY, &inverseMass, &radius };
+	for (Array* field : fields) {
+		(*field)[index] = field->back();
+		field->pop_back();
+	}
+}
+
+/// <summary>
+/// Removes every particle, keeping the memory.
+/// </summary>
+template<typename T>
+void ParticleStorage<T>::Clear() {
+	Array* fields[] = { &positionX, &positionY, &velocityX, &velocityY, &forceX, &forceY, &inverseMass, &radius };
+	for (Array* field : fields) {
+		field->clear();
+	}
+}
+
+/// <summary>
+/// Reserves room for a number of particles so adding them never reallocates.
+/// </summary>
+/// <param name="capacity">The number of particles.</param>
+template<typename T>
+void ParticleStorage<T>::Reserve(size_t capacity) {
+	Array* fields[] = { &positionX, &positionY, &velocityX, &velocityY, &forceX, &forceY, &inverseMass, &radius };
+	for (Array* field : fields) {
+		field->reserve(capacity);
+	}
+}
+
+/// <summary>
+/// Sets the number of particles. New particles are zeroed, and are only meant to be overwritten.
+/// </summary>
+/// <param name="count">The number of particles.</param>
+template<typename T>
+void ParticleStorage<T>::Resize(size_t count) {
+	Array* fields[] = { &positionX, &positionY, &velocityX, &velocityY, &forceX, &forceY, &inverseMass, &radius };
+	for (Array* field : fields) {
+		field->resize(count);
+	}
+}
+
+/// <summary>
+/// Returns the number of particles.
+/// </summary>
+template<typename T>
+size_t ParticleStorage<T>::getCount() const {
+	return positionX.size();
+}
+
+/// <summary>
+/// Returns the number of particles that fit before the arrays reallocate.
+/// </summary>
+template<typename T>
+size_t ParticleStorage<T>::getCapacity() const {
+	return positionX.capacity();
+}
+
+/// <summary>
+/// Returns the position of a particle.
+/// </summary>
+template<typename T>
+Vector2T<T> ParticleStorage<T>::getPosition(size_t index) const {
+	return Vector2T<T>(positionX[index], positionY[index]);
+}
+
+/// <summary>
+/// Sets the position of a particle.
+/// </summary>
+template<typename T>
+void ParticleStorage<T>::setPosition(size_t index, const Vector2T<T>& position) {
+	positionX[index] = position.x;
+	positionY[index] = position.y;
+}
+
+/// <summary>
+/// Returns the velocity of a particle.
+/// </summary>
+template<typename T>
+Vector2T<T> ParticleStorage<T>::getVelocity(size_t index) const {
+	return Vector2T<T>(velocityX[index], velocityY[index]);
+}
+
+/// <summary>
+/// Sets the velocity of a particle.
+/// </summary>
+template<typename T>
+void ParticleStorage<T>::setVelocity(size_t index, const Vector2T<T>& velocity) {
+	velocityX[index] = velocity.x;
+	velocityY[index] = velocity.y;
+}
+
+/// <summary>
+/// Returns pointers to the columns. Adding particles may reallocate and invalidate it.
+/// </summary>
+template<typename T>
+ParticleView<T> ParticleStorage<T>::getView() {
+	ParticleView<T> view;
+	view.positionX = positionX.data();
+	view.positionY = positionY.data();
+	view.velocityX = velocityX.data();
+	view.velocityY = velocityY.data();
+	view.forceX = forceX.data();
+	view.forceY = forceY.data();
+	view.inverseMass = inverseMass.data();
+	view.radius = radius.data();
+	view.count = getCount();
+	return view;
+}
+
+/// <summary>
+/// Replaces the particles with copies of the particles in a view.
+/// </summary>
+/// <param name="view">The particles to copy.</param>
+template<typename T>
+void ParticleStorage<T>::Assign(const ParticleView<T>& view) {
+	positionX.assign(view.positionX, view.positionX + view.count);
+	positionY.assign(view.positionY, view.positionY + view.count);
+	velocityX.assign(view.velocityX, view.velocityX + view.count);
+	velocityY.assign(view.velocityY, view.velocityY + view.count);
+	forceX.assign(view.forceX, view.forceX + view.count);
+	forceY.assign(view.forceY, view.forceY + view.count);
+	inverseMass.assign(view.inverseMass, view.inverseMass + view.count);
+	radius.assign(view.radius, view.radius + view.count);
+}
+
+#endif
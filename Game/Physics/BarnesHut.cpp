@@ -0,0 +1,379 @@
+/*
+Barnes-Hut self-gravity. Bodies are split into a 4x4 grid of buckets whose
+subtrees are built in parallel and then stitched under a shared root, and the
+force on every body is evaluated in parallel by walking the tree.
+*/
+
+#include "BarnesHut.h"
+#include "../Parallel.h"
+
+// Two levels of the tree are built serially, giving 16 subtrees built in parallel.
+const unsigned int BUCKET_GRID = 4;
+
+// Below this depth bodies are treated as coincident and chained in the same leaf.
+const int MAX_TREE_DEPTH = 24;
+
+/// <summary>
+/// Barnes-Hut Constructor.
+/// </summary>
+/// <param name="theta">The opening angle. Cells smaller than theta times their distance are treated as one body.</param>
+/// <param name="gravitationalConstant">The gravitational constant.</param>
+/// <param name="softening">The softening length, preventing infinite forces between close bodies.</param>
+BarnesHut::BarnesHut(float theta, float gravitationalConstant, float softening) {
+    this->theta = theta;
+    this->gravitationalConstant = gravitationalConstant;
+    this->softening = softening;
+    subtrees.resize(BUCKET_GRID * BUCKET_GRID);
+    buckets.resize(BUCKET_GRID * BUCKET_GRID);
+}
+
+/// <summary>
+/// Adds the self-gravity of all circles to the force on every circle, weighted by their mass.
+/// </summary>
+/// <param name="entities">The list of live entities.</param>
+void BarnesHut::ApplyForces(const std::vector<Entity*>& entities) {
+    Gather(entities);
+    if (bodies.empty()) return;
+
+    Build();
+
+    ParallelFor(bodies.size(), 256, [this](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            Vector2 acceleration = Evaluate((unsigned int)i);
+            bodies[i]->force = bodies[i]->force + acceleration * bodyMass[i];
+        }
+    });
+}
+
+/// <summary>
+/// Copies the position and mass of every live circle into flat arrays.
+/// </summary>
+/// <param name="entities">The list of live entities.</param>
+void BarnesHut::Gather(const std::vector<Entity*>& entities) {
+    bodies.clear();
+    for (size_t i = 0; i < entities.size(); i++) {
+        if (entities[i]->type == CIRCLE && entities[i]->isAlive())
+            bodies.push_back(entities[i]);
+    }
+
+    bodyX.resize(bodies.size());
+    bodyY.resize(bodies.size());
+    bodyMass.resize(bodies.size());
+    nextBody.resize(bodies.size());
+
+    ParallelFor(bodies.size(), 4096, [this](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            bodyX[i] = bodies[i]->position.x;
+            bodyY[i] = bodies[i]->position.y;
+            bodyMass[i] = bodies[i]->mass;
+            nextBody[i] = -1;
+        }
+    });
+}
+
+/// <summary>
+/// Builds the quadtree. The top two levels are built serially and the 16 subtrees below them in parallel.
+/// </summary>
+void BarnesHut::Build() {
+    // Square bounds around every body.
+    float minX = bodyX[0], maxX = bodyX[0];
+    float minY = bodyY[0], maxY = bodyY[0];
+    for (size_t i = 1; i < bodies.size(); i++) {
+        if (bodyX[i] < minX) minX = bodyX[i];
+        if (bodyX[i] > maxX) maxX = bodyX[i];
+        if (bodyY[i] < minY) minY = bodyY[i];
+        if (bodyY[i] > maxY) maxY = bodyY[i];
+    }
+    float halfSize = fmaxf(maxX - minX, maxY - minY) * 0.5f + 1.0f;
+    float centerX = (minX + maxX) * 0.5f;
+    float centerY = (minY + maxY) * 0.5f;
+    float cellSize = halfSize * 2.0f / BUCKET_GRID;
+
+    // Sort bodies into buckets.
+    for (size_t b = 0; b < buckets.size(); b++) {
+        buckets[b].clear();
+    }
+    for (size_t i = 0; i < bodies.size(); i++) {
+        int gx = (int)((bodyX[i] - (centerX - halfSize)) / cellSize);
+        int gy = (int)((bodyY[i] - (centerY - halfSize)) / cellSize);
+        if (gx < 0) gx = 0; else if (gx >= (int)BUCKET_GRID) gx = BUCKET_GRID - 1;
+        if (gy < 0) gy = 0; else if (gy >= (int)BUCKET_GRID) gy = BUCKET_GRID - 1;
+        buckets[gy * BUCKET_GRID + gx].push_back((int)i);
+    }
+
+    // Build every bucket's subtree in parallel.
+    ParallelFor(buckets.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; b++) {
+            unsigned int gx = (unsigned int)b % BUCKET_GRID;
+            unsigned int gy = (unsigned int)b / BUCKET_GRID;
+            BuildSubtree((unsigned int)b,
+                centerX - halfSize + cellSize * (gx + 0.5f),
+                centerY - halfSize + cellSize * (gy + 0.5f),
+                cellSize * 0.5f);
+        }
+    });
+
+    // Stitch the subtrees under the root and its four quadrants.
+    nodes.clear();
+    int root = NewNode(nodes, centerX, centerY, halfSize);
+    nodes[root].leaf = false;
+    for (int q = 0; q < 4; q++) {
+        float offsetX = (q & 1) ? halfSize * 0.5f : -halfSize * 0.5f;
+        float offsetY = (q & 2) ? halfSize * 0.5f : -halfSize * 0.5f;
+        int child = NewNode(nodes, centerX + offsetX, centerY + offsetY, halfSize * 0.5f);
+        nodes[child].leaf = false;
+        nodes[root].children[q] = child;
+    }
+
+    for (unsigned int b = 0; b < buckets.size(); b++) {
+        if (buckets[b].empty()) continue;
+
+        int offset = (int)nodes.size();
+        for (size_t n = 0; n < subtrees[b].size(); n++) {
+            QuadNode node = subtrees[b][n];
+            for (int c = 0; c < 4; c++) {
+                if (node.children[c] != -1) node.children[c] += offset;
+            }
+            nodes.push_back(node);
+        }
+
+        unsigned int gx = b % BUCKET_GRID;
+        unsigned int gy = b / BUCKET_GRID;
+        int quadrant = (gx >= 2 ? 1 : 0) | (gy >= 2 ? 2 : 0);
+        int subQuadrant = (gx & 1) | ((gy & 1) << 1);
+        nodes[nodes[root].children[quadrant]].children[subQuadrant] = offset;
+    }
+
+    for (int q = 0; q < 4; q++) {
+        Combine(nodes[root].children[q]);
+    }
+    Combine(root);
+}
+
+/// <summary>
+/// Builds the subtree of a single bucket into its own node array.
+/// </summary>
+/// <param name="bucket">The index of the bucket.</param>
+/// <param name="centerX">The X coordinate of the bucket's center.</param>
+/// <param name="centerY">The Y coordinate of the bucket's center.</param>
+/// <param name="halfSize">Half the width of the bucket.</param>
+void BarnesHut::BuildSubtree(unsigned int bucket, float centerX, float centerY, float halfSize) {
+    std::vector<QuadNode>& tree = subtrees[bucket];
+    tree.clear();
+    if (buckets[bucket].empty()) return;
+
+    NewNode(tree, centerX, centerY, halfSize);
+    for (size_t i = 0; i < buckets[bucket].size(); i++) {
+        Insert(tree, buckets[bucket][i]);
+    }
+    Summarize(tree, 0);
+}
+
+/// <summary>
+/// Appends an empty leaf to a node array.
+/// </summary>
+/// <returns>The index of the new node.</returns>
+int BarnesHut::NewNode(std::vector<QuadNode>& tree, float centerX, float centerY, float halfSize) {
+    QuadNode node;
+    node.centerX = centerX;
+    node.centerY = centerY;
+    node.halfSize = halfSize;
+    node.massX = 0.0f;
+    node.massY = 0.0f;
+    node.mass = 0.0f;
+    node.children[0] = node.children[1] = node.children[2] = node.children[3] = -1;
+    node.body = -1;
+    node.leaf = true;
+    tree.push_back(node);
+    return (int)tree.size() - 1;
+}
+
+/// <summary>
+/// Inserts a body into a tree, splitting occupied leaves as it descends.
+/// </summary>
+/// <param name="tree">The node array, whose first node is the root.</param>
+/// <param name="body">The index of the body.</param>
+void BarnesHut::Insert(std::vector<QuadNode>& tree, int body) {
+    int node = 0;
+    int depth = 0;
+
+    while (true) {
+        if (tree[node].leaf) {
+            if (tree[node].body == -1) {
+                tree[node].body = body;
+                return;
+            }
+
+            // Coincident bodies share the leaf.
+            if (depth >= MAX_TREE_DEPTH) {
+                nextBody[body] = tree[node].body;
+                tree[node].body = body;
+                return;
+            }
+
+            // Split the leaf and push its body down a level.
+            int old = tree[node].body;
+            tree[node].body = -1;
+            tree[node].leaf = false;
+            int q = (bodyX[old] >= tree[node].centerX ? 1 : 0) | (bodyY[old] >= tree[node].centerY ? 2 : 0);
+            float half = tree[node].halfSize * 0.5f;
+            int child = NewNode(tree, tree[node].centerX + ((q & 1) ? half : -half), tree[node].centerY + ((q & 2) ? half : -half), half);
+            tree[child].body = old;
+            tree[node].children[q] = child;
+        }
+
+        int q = (bodyX[body] >= tree[node].centerX ? 1 : 0) | (bodyY[body] >= tree[node].centerY ? 2 : 0);
+        if (tree[node].children[q] == -1) {
+            float half = tree[node].halfSize * 0.5f;
+            int child = NewNode(tree, tree[node].centerX + ((q & 1) ? half : -half), tree[node].centerY + ((q & 2) ? half : -half), half);
+            tree[child].body = body;
+            tree[node].children[q] = child;
+            return;
+        }
+        node = tree[node].children[q];
+        depth++;
+    }
+}
+
+/// <summary>
+/// Computes the mass and center of mass of a node and everything below it.
+/// </summary>
+/// <param name="tree">The node array.</param>
+/// <param name="node">The index of the node.</param>
+void BarnesHut::Summarize(std::vector<QuadNode>& tree, int node) {
+    float mass = 0.0f, massX = 0.0f, massY = 0.0f;
+
+    if (tree[node].leaf) {
+        for (int b = tree[node].body; b != -1; b = nextBody[b]) {
+            mass += bodyMass[b];
+            massX += bodyX[b] * bodyMass[b];
+            massY += bodyY[b] * bodyMass[b];
+        }
+    }
+    else {
+        for (int c = 0; c < 4; c++) {
+            int child = tree[node].children[c];
+            if (child == -1) continue;
+            Summarize(tree, child);
+            mass += tree[child].mass;
+            massX += tree[child].massX * tree[child].mass;
+            massY += tree[child].massY * tree[child].mass;
+        }
+    }
+
+    tree[node].mass = mass;
+    tree[node].massX = mass > 0.0f ? massX / mass : tree[node].centerX;
+    tree[node].massY = mass > 0.0f ? massY / mass : tree[node].centerY;
+}
+
+/// <summary>
+/// Computes the mass of a stitched node from its already summarized children.
+/// </summary>
+/// <param name="node">The index of the node.</param>
+void BarnesHut::Combine(int node) {
+    float mass = 0.0f, massX = 0.0f, massY = 0.0f;
+    for (int c = 0; c < 4; c++) {
+        int child = nodes[node].children[c];
+        if (child == -1) continue;
+        mass += nodes[child].mass;
+        massX += nodes[child].massX * nodes[child].mass;
+        massY += nodes[child].massY * nodes[child].mass;
+    }
+    nodes[node].mass = mass;
+    nodes[node].massX = mass > 0.0f ? massX / mass : nodes[node].centerX;
+    nodes[node].massY = mass > 0.0f ? massY / mass : nodes[node].centerY;
+}
+
+/// <summary>
+/// Walks the tree and sums the gravitational acceleration acting on a body.
+/// </summary>
+/// <param name="body">The index of the body.</param>
+/// <returns>The acceleration of the body.</returns>
+Vector2 BarnesHut::Evaluate(unsigned int body) {
+    int stack[4 * (MAX_TREE_DEPTH + 4)];
+    int top = 0;
+    stack[top++] = 0;
+
+    float x = bodyX[body];
+    float y = bodyY[body];
+    float soft = softening * softening;
+    float thetaSqr = theta * theta;
+    float ax = 0.0f, ay = 0.0f;
+
+    while (top > 0) {
+        const QuadNode& node = nodes[stack[--top]];
+        if (node.mass <= 0.0f) continue;
+
+        if (node.leaf) {
+            for (int b = node.body; b != -1; b = nextBody[b]) {
+                if (b == (int)body) continue;
+                float dx = bodyX[b] - x;
+                float dy = bodyY[b] - y;
+                float distSqr = dx * dx + dy * dy + soft;
+                float inv = bodyMass[b] / (distSqr * sqrtf(distSqr));
+                ax += dx * inv;
+                ay += dy * inv;
+            }
+            continue;
+        }
+
+        float dx = node.massX - x;
+        float dy = node.massY - y;
+        float distSqr = dx * dx + dy * dy + soft;
+        float size = node.halfSize * 2.0f;
+
+        // Far enough away to treat the whole cell as one body.
+        if (size * size < thetaSqr * distSqr) {
+            float inv = node.mass / (distSqr * sqrtf(distSqr));
+            ax += dx * inv;
+            ay += dy * inv;
+            continue;
+        }
+
+        for (int c = 0; c < 4; c++) {
+            if (node.children[c] != -1) stack[top++] = node.children[c];
+        }
+    }
+
+    return Vector2(ax * gravitationalConstant, ay * gravitationalConstant);
+}
+
+/// <summary>
+/// Returns the opening angle.
+/// </summary>
+/// <returns>The opening angle.</returns>
+float BarnesHut::getTheta() {
+    return this->theta;
+}
+
+/// <summary>
+/// Sets the opening angle. Zero is an exact sum, larger values trade accuracy for speed.
+/// </summary>
+/// <param name="theta">The opening angle.</param>
+void BarnesHut::setTheta(float theta) {
+    this->theta = theta;
+}
+
+/// <summary>
+/// Returns the gravitational constant.
+/// </summary>
+/// <returns>The gravitational constant.</returns>
+float BarnesHut::getGravitationalConstant() {
+    return this->gravitationalConstant;
+}
+
+/// <summary>
+/// Sets the gravitational constant.
+/// </summary>
+/// <param name="gravitationalConstant">The gravitational constant.</param>
+void BarnesHut::setGravitationalConstant(float gravitationalConstant) {
+    this->gravitationalConstant = gravitationalConstant;
+}
+
+/// <summary>
+/// Returns the number of nodes in the last built tree.
+/// </summary>
+/// <returns>The node count.</returns>
+unsigned int BarnesHut::getNodeCount() {
+    return (unsigned int)nodes.size();
+}
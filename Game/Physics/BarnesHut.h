@@ -0,0 +1,57 @@
+#pragma once
+
+#ifndef BARNESHUT_H
+#define BARNESHUT_H
+
+#include "../Entities/Entity.h"
+
+// A cell of the Barnes-Hut quadtree. Children are indices into the node array, -1 when empty.
+struct QuadNode {
+	float centerX;
+	float centerY;
+	float halfSize;
+	float massX;
+	float massY;
+	float mass;
+	int children[4];
+	int body;
+	bool leaf;
+};
+
+class BarnesHut
+{
+public:
+	BarnesHut(float theta, float gravitationalConstant, float softening);
+	void ApplyForces(const std::vector<Entity*>& entities);
+	float getTheta();
+	void setTheta(float theta);
+	float getGravitationalConstant();
+	void setGravitationalConstant(float gravitationalConstant);
+	unsigned int getNodeCount();
+private:
+	void Gather(const std::vector<Entity*>& entities);
+	void Build();
+	void BuildSubtree(unsigned int bucket, float centerX, float centerY, float halfSize);
+	Vector2 Evaluate(unsigned int body);
+	int NewNode(std::vector<QuadNode>& nodes, float centerX, float centerY, float halfSize);
+	void Insert(std::vector<QuadNode>& nodes, int body);
+	void Summarize(std::vector<QuadNode>& nodes, int node);
+	void Combine(int node);
+	float theta;
+	float gravitationalConstant;
+	float softening;
+
+	// Bodies gathered from the entity list.
+	std::vector<Entity*> bodies;
+	std::vector<float> bodyX;
+	std::vector<float> bodyY;
+	std::vector<float> bodyMass;
+	std::vector<int> nextBody;
+
+	// The final tree, and the per-bucket subtrees built in parallel before being stitched together.
+	std::vector<QuadNode> nodes;
+	std::vector<std::vector<QuadNode>> subtrees;
+	std::vector<std::vector<int>> buckets;
+};
+
+#endif
@@ -0,0 +1,164 @@
+/*
+AVX2 specialisations of the batch integrator. Float runs eight particles per
+register and double four. The walls are applied with compares and blends, so
+the whole pass is branch free and limited by memory bandwidth.
+*/
+
+#include "BatchIntegrator.h"
+#include "../Simd.h"
+
+/// <summary>
+/// Float integration, eight particles at a time.
+/// </summary>
+template<>
+void BatchIntegrator<float>::StepRange(const ParticleView<float>& particles, size_t begin, size_t end, const IntegrationStep<float>& step) {
+	size_t i = begin;
+#ifdef SIMD_AVX2
+	float* positionX = particles.positionX;
+	float* positionY = particles.positionY;
+	float* velocityX = particles.velocityX;
+	float* velocityY = particles.velocityY;
+	float* forceX = particles.forceX;
+	float* forceY = particles.forceY;
+	const float* inverseMass = particles.inverseMass;
+	const float* radius = particles.radius;
+
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 dt = _mm256_set1_ps(step.timestep);
+	const __m256 gx = _mm256_set1_ps(step.gravityX);
+	const __m256 gy = _mm256_set1_ps(step.gravityY);
+	const __m256 bounce = _mm256_set1_ps(-step.bounciness);
+	const __m256 minX = _mm256_set1_ps(step.minX);
+	const __m256 minY = _mm256_set1_ps(step.minY);
+	const __m256 maxX = _mm256_set1_ps(step.maxX);
+	const __m256 maxY = _mm256_set1_ps(step.maxY);
+	const __m256 width = _mm256_set1_ps(step.maxX - step.minX);
+	const __m256 height = _mm256_set1_ps(step.maxY - step.minY);
+	const bool periodic = step.boundary == PERIODIC;
+
+	for (; i + 8 <= end; i += 8) {
+		__m256 im = _mm256_loadu_ps(inverseMass + i);
+		__m256 movable = _mm256_cmp_ps(im, zero, _CMP_NEQ_OQ);
+		__m256 fx = _mm256_loadu_ps(forceX + i);
+		__m256 fy = _mm256_loadu_ps(forceY + i);
+		_mm256_storeu_ps(forceX + i, zero);
+		_mm256_storeu_ps(forceY + i, zero);
+
+		__m256 oldVX = _mm256_loadu_ps(velocityX + i);
+		__m256 oldVY = _mm256_loadu_ps(velocityY + i);
+		__m256 oldX = _mm256_loadu_ps(positionX + i);
+		__m256 oldY = _mm256_loadu_ps(positionY + i);
+
+		__m256 vx = _mm256_add_ps(oldVX, _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(fx, im), gx), dt));
+		__m256 vy = _mm256_add_ps(oldVY, _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(fy, im), gy), dt));
+		__m256 x = _mm256_add_ps(oldX, _mm256_mul_ps(vx, dt));
+		__m256 y = _mm256_add_ps(oldY, _mm256_mul_ps(vy, dt));
+
+		if (periodic) {
+			x = _mm256_sub_ps(x, _mm256_mul_ps(width, _mm256_floor_ps(_mm256_div_ps(_mm256_sub_ps(x, minX), width))));
+			y = _mm256_sub_ps(y, _mm256_mul_ps(height, _mm256_floor_ps(_mm256_div_ps(_mm256_sub_ps(y, minY), height))));
+		}
+		else {
+			__m256 r = _mm256_loadu_ps(radius + i);
+			__m256 low = _mm256_add_ps(minX, r);
+			__m256 high = _mm256_sub_ps(maxX, r);
+			__m256 below = _mm256_cmp_ps(x, low, _CMP_LT_OQ);
+			__m256 above = _mm256_andnot_ps(below, _mm256_cmp_ps(x, high, _CMP_GT_OQ));
+			x = _mm256_blendv_ps(_mm256_blendv_ps(x, low, below), high, above);
+			vx = _mm256_blendv_ps(vx, _mm256_mul_ps(vx, bounce), _mm256_or_ps(below, above));
+
+			low = _mm256_add_ps(minY, r);
+			high = _mm256_sub_ps(maxY, r);
+			below = _mm256_cmp_ps(y, low, _CMP_LT_OQ);
+			above = _mm256_andnot_ps(below, _mm256_cmp_ps(y, high, _CMP_GT_OQ));
+			y = _mm256_blendv_ps(_mm256_blendv_ps(y, low, below), high, above);
+			vy = _mm256_blendv_ps(vy, _mm256_mul_ps(vy, bounce), _mm256_or_ps(below, above));
+		}
+
+		// Immovable particles keep their state.
+		_mm256_storeu_ps(velocityX + i, _mm256_blendv_ps(oldVX, vx, movable));
+		_mm256_storeu_ps(velocityY + i, _mm256_blendv_ps(oldVY, vy, movable));
+		_mm256_storeu_ps(positionX + i, _mm256_blendv_ps(oldX, x, movable));
+		_mm256_storeu_ps(positionY + i, _mm256_blendv_ps(oldY, y, movable));
+	}
+#endif
+	StepScalar(particles, i, end, step);
+}
+
+/// <summary>
+/// Double integration, four particles at a time.
+/// </summary>
+template<>
+void BatchIntegrator<double>::StepRange(const ParticleView<double>& particles, size_t begin, size_t end, const IntegrationStep<double>& step) {
+	size_t i = begin;
+#ifdef SIMD_AVX2
+	double* positionX = particles.positionX;
+	double* positionY = particles.positionY;
+	double* velocityX = particles.velocityX;
+	double* velocityY = particles.velocityY;
+	double* forceX = particles.forceX;
+	double* forceY = particles.forceY;
+	const double* inverseMass = particles.inverseMass;
+	const double* radius = particles.radius;
+
+	const __m256d zero = _mm256_setzero_pd();
+	const __m256d dt = _mm256_set1_pd(step.timestep);
+	const __m256d gx = _mm256_set1_pd(step.gravityX);
+	const __m256d gy = _mm256_set1_pd(step.gravityY);
+	const __m256d bounce = _mm256_set1_pd(-step.bounciness);
+	const __m256d minX = _mm256_set1_pd(step.minX);
+	const __m256d minY = _mm256_set1_pd(step.minY);
+	const __m256d maxX = _mm256_set1_pd(step.maxX);
+	const __m256d maxY = _mm256_set1_pd(step.maxY);
+	const __m256d width = _mm256_set1_pd(step.maxX - step.minX);
+	const __m256d height = _mm256_set1_pd(step.maxY - step.minY);
+	const bool periodic = step.boundary == PERIODIC;
+
+	for (; i + 4 <= end; i += 4) {
+		__m256d im = _mm256_loadu_pd(inverseMass + i);
+		__m256d movable = _mm256_cmp_pd(im, zero, _CMP_NEQ_OQ);
+		__m256d fx = _mm256_loadu_pd(forceX + i);
+		__m256d fy = _mm256_loadu_pd(forceY + i);
+		_mm256_storeu_pd(forceX + i, zero);
+		_mm256_storeu_pd(forceY + i, zero);
+
+		__m256d oldVX = _mm256_loadu_pd(velocityX + i);
+		__m256d oldVY = _mm256_loadu_pd(velocityY + i);
+		__m256d oldX = _mm256_loadu_pd(positionX + i);
+		__m256d oldY = _mm256_loadu_pd(positionY + i);
+
+		__m256d vx = _mm256_add_pd(oldVX, _mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(fx, im), gx), dt));
+		__m256d vy = _mm256_add_pd(oldVY, _mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(fy, im), gy), dt));
+		__m256d x = _mm256_add_pd(oldX, _mm256_mul_pd(vx, dt));
+		__m256d y = _mm256_add_pd(oldY, _mm256_mul_pd(vy, dt));
+
+		if (periodic) {
+			x = _mm256_sub_pd(x, _mm256_mul_pd(width, _mm256_floor_pd(_mm256_div_pd(_mm256_sub_pd(x, minX), width))));
+			y = _mm256_sub_pd(y, _mm256_mul_pd(height, _mm256_floor_pd(_mm256_div_pd(_mm256_sub_pd(y, minY), height))));
+		}
+		else {
+			__m256d r = _mm256_loadu_pd(radius + i);
+			__m256d low = _mm256_add_pd(minX, r);
+			__m256d high = _mm256_sub_pd(maxX, r);
+			__m256d below = _mm256_cmp_pd(x, low, _CMP_LT_OQ);
+			__m256d above = _mm256_andnot_pd(below, _mm256_cmp_pd(x, high, _CMP_GT_OQ));
+			x = _mm256_blendv_pd(_mm256_blendv_pd(x, low, below), high, above);
+			vx = _mm256_blendv_pd(vx, _mm256_mul_pd(vx, bounce), _mm256_or_pd(below, above));
+
+			low = _mm256_add_pd(minY, r);
+			high = _mm256_sub_pd(maxY, r);
+			below = _mm256_cmp_pd(y, low, _CMP_LT_OQ);
+			above = _mm256_andnot_pd(below, _mm256_cmp_pd(y, high, _CMP_GT_OQ));
+			y = _mm256_blendv_pd(_mm256_blendv_pd(y, low, below), high, above);
+			vy = _mm256_blendv_pd(vy, _mm256_mul_pd(vy, bounce), _mm256_or_pd(below, above));
+		}
+
+		// Immovable particles keep their state.
+		_mm256_storeu_pd(velocityX + i, _mm256_blendv_pd(oldVX, vx, movable));
+		_mm256_storeu_pd(velocityY + i, _mm256_blendv_pd(oldVY, vy, movable));
+		_mm256_storeu_pd(positionX + i, _mm256_blendv_pd(oldX, x, movable));
+		_mm256_storeu_pd(positionY + i, _mm256_blendv_pd(oldY, y, movable));
+	}
+#endif
+	StepScalar(particles, i, end, step);
+}
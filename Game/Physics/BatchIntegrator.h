@@ -0,0 +1,181 @@
+#pragma once
+
+#ifndef BATCHINTEGRATOR_H
+#define BATCHINTEGRATOR_H
+
+#include "../ParticleStorage.h"
+#include "../Bounds.h"
+#include "../Common.h"
+#include "../Parallel.h"
+#include "Kernels.h"
+#include <math.h>
+
+// Everything one integration pass needs, converted to the storage's scalar once per step.
+template<typename T>
+struct IntegrationStep {
+	T timestep;
+	T gravityX;
+	T gravityY;
+	T bounciness;
+	T minX;
+	T minY;
+	T maxX;
+	T maxY;
+	BoundaryMode boundary;
+};
+
+// Semi-implicit Euler over particle storage, fused with the walls into a single streaming pass:
+// kick by force times inverse mass plus uniform gravity, drift, then clamp and reflect off the
+// walls or wrap around them. Forces are cleared in the same pass, ready for the next tick.
+// Float and double are specialised with AVX2 in BatchIntegrator.cpp.
+template<typename T>
+class BatchIntegrator
+{
+public:
+	BatchIntegrator(Vector2T<T> gravity, T bounciness);
+	void Step(ParticleStorage<T>& particles, const Bounds& world, BoundaryMode boundary, T timestep);
+	void Step(const ParticleView<T>& particles, const Bounds& world, BoundaryMode boundary, T timestep);
+	Vector2T<T> getGravity();
+	void setGravity(Vector2T<T> gravity);
+	T getBounciness();
+	void setBounciness(T bounciness);
+	static void StepRange(const ParticleView<T>& particles, size_t begin, size_t end, const IntegrationStep<T>& step);
+	static void StepScalar(const ParticleView<T>& particles, size_t begin, size_t end, const IntegrationStep<T>& step);
+private:
+	Vector2T<T> gravity;
+	T bounciness;
+};
+
+/// <summary>
+/// Batch Integrator Constructor.
+/// </summary>
+/// <param name="gravity">The uniform acceleration of gravity.</param>
+/// <param name="bounciness">The fraction of speed kept when bouncing off a wall.</param>
+template<typename T>
+BatchIntegrator<T>::BatchIntegrator(Vector2T<T> gravity, T bounciness) {
+	this->gravity = gravity;
+	this->bounciness = bounciness;
+}
+
+/// <summary>
+/// Advances every particle by one timestep.
+/// </summary>
+/// <param name="particles">The particles.</param>
+/// <param name="world">The walls of the world, or its unit cell if it is periodic.</param>
+/// <param name="boundary">Whether the walls reflect or wrap.</param>
+/// <param name="timestep">The timestep.</param>
+template<typename T>
+void BatchIntegrator<T>::Step(ParticleStorage<T>& particles, const Bounds& world, BoundaryMode boundary, T timestep) {
+	Step(particles.getView(), world, boundary, timestep);
+}
+
+/// <summary>
+/// Advances every particle in a view by one timestep, wherever its columns live.
+/// </summary>
+/// <param name="particles">The particle columns.</param>
+/// <param name="world">The walls of the world, or its unit cell if it is periodic.</param>
+/// <param name="boundary">Whether the walls reflect or wrap.</param>
+/// <param name="timestep">The timestep.</param>
+template<typename T>
+void BatchIntegrator<T>::Step(const ParticleView<T>& particles, const Bounds& world, BoundaryMode boundary, T timestep) {
+	IntegrationStep<T> step;
+	step.timestep = timestep;
+	step.gravityX = gravity.x;
+	step.gravityY = gravity.y;
+	step.bounciness = bounciness;
+	step.minX = (T)world.min.x;
+	step.minY = (T)world.min.y;
+	step.maxX = (T)world.max.x;
+	step.maxY = (T)world.max.y;
+	step.boundary = boundary;
+
+	ParallelFor(particles.getCount(), KERNEL_GRAIN, [&](size_t begin, size_t end) {
+		StepRange(particles, begin, end, step);
+	});
+}
+
+/// <summary>
+/// Integrates [begin, end). Specialised with SIMD for float and double.
+/// </summary>
+template<typename T>
+void BatchIntegrator<T>::StepRange(const ParticleView<T>& particles, size_t begin, size_t end, const IntegrationStep<T>& step) {
+	StepScalar(particles, begin, end, step);
+}
+
+/// <summary>
+/// Scalar integration of [begin, end), also used for the tails of the SIMD kernels.
+/// Particles with no inverse mass are immovable and only have their force cleared.
+/// </summary>
+template<typename T>
+void BatchIntegrator<T>::StepScalar(const ParticleView<T>& particles, size_t begin, size_t end, const IntegrationStep<T>& step) {
+	T width = step.maxX - step.minX;
+	T height = step.maxY - step.minY;
+
+	for (size_t i = begin; i < end; i++) {
+		T inverseMass = particles.inverseMass[i];
+		T fx = particles.forceX[i];
+		T fy = particles.forceY[i];
+		particles.forceX[i] = T(0);
+		particles.forceY[i] = T(0);
+		if (inverseMass == T(0)) continue;
+
+		T vx = particles.velocityX[i] + (fx * inverseMass + step.gravityX) * step.timestep;
+		T vy = particles.velocityY[i] + (fy * inverseMass + step.gravityY) * step.timestep;
+		T x = particles.positionX[i] + vx * step.timestep;
+		T y = particles.positionY[i] + vy * step.timestep;
+
+		if (step.boundary == PERIODIC) {
+			x -= width * std::floor((x - step.minX) / width);
+			y -= height * std::floor((y - step.minY) / height);
+		}
+		else {
+			T r = particles.radius[i];
+			if (x < step.minX + r) { x = step.minX + r; vx = -vx * step.bounciness; }
+			else if (x > step.maxX - r) { x = step.maxX - r; vx = -vx * step.bounciness; }
+			if (y < step.minY + r) { y = step.minY + r; vy = -vy * step.bounciness; }
+			else if (y > step.maxY - r) { y = step.maxY - r; vy = -vy * step.bounciness; }
+		}
+
+		particles.velocityX[i] = vx;
+		particles.velocityY[i] = vy;
+		particles.positionX[i] = x;
+		particles.positionY[i] = y;
+	}
+}
+
+/// <summary>
+/// Returns the uniform acceleration of gravity.
+/// </summary>
+template<typename T>
+Vector2T<T> BatchIntegrator<T>::getGravity() {
+	return this->gravity;
+}
+
+/// <summary>
+/// Sets the uniform acceleration of gravity.
+/// </summary>
+template<typename T>
+void BatchIntegrator<T>::setGravity(Vector2T<T> gravity) {
+	this->gravity = gravity;
+}
+
+/// <summary>
+/// Returns the fraction of speed kept when bouncing off a wall.
+/// </summary>
+template<typename T>
+T BatchIntegrator<T>::getBounciness() {
+	return this->bounciness;
+}
+
+/// <summary>
+/// Sets the fraction of speed kept when bouncing off a wall.
+/// </summary>
+template<typename T>
+void BatchIntegrator<T>::setBounciness(T bounciness) {
+	this->bounciness = bounciness;
+}
+
+template<> void BatchIntegrator<float>::StepRange(const ParticleView<float>& particles, size_t begin, size_t end, const IntegrationStep<float>& step);
+template<> void BatchIntegrator<double>::StepRange(const ParticleView<double>& particles, size_t begin, size_t end, const IntegrationStep<double>& step);
+
+#endif
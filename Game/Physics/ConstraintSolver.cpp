@@ -0,0 +1,297 @@
+/*
+Extended position based dynamics for ropes, soft bodies and cloth. Constraints
+are solved Gauss-Seidel style one colour at a time, and the colouring is only
+recomputed when constraints are added or removed.
+*/
+
+#include "ConstraintSolver.h"
+#include "../Parallel.h"
+#include <stdint.h>
+#include <unordered_map>
+
+// Colours are tracked as a bitmask per entity.
+const unsigned int MAX_COLOURS = 64;
+
+/// <summary>
+/// Constraint Solver Constructor.
+/// </summary>
+/// <param name="iterations">The number of solver iterations per tick.</param>
+ConstraintSolver::ConstraintSolver(unsigned int iterations) {
+    this->iterations = iterations;
+}
+
+/// <summary>
+/// Adds a rigid distance constraint between two entities.
+/// </summary>
+/// <param name="a">The first entity.</param>
+/// <param name="b">The second entity.</param>
+/// <param name="restLength">The distance to keep between them.</param>
+void ConstraintSolver::AddDistance(Entity* a, Entity* b, float restLength) {
+    AddSpring(a, b, restLength, 0.0f);
+}
+
+/// <summary>
+/// Adds a spring between two entities.
+/// </summary>
+/// <param name="a">The first entity.</param>
+/// <param name="b">The second entity.</param>
+/// <param name="restLength">The rest length of the spring.</param>
+/// <param name="compliance">The inverse stiffness of the spring. Zero is rigid.</param>
+void ConstraintSolver::AddSpring(Entity* a, Entity* b, float restLength, float compliance) {
+    DistanceConstraint constraint;
+    constraint.a = a;
+    constraint.b = b;
+    constraint.restLength = restLength;
+    constraint.compliance = compliance;
+    constraint.lambda = 0.0f;
+    constraint.bodyA = 0;
+    constraint.bodyB = 0;
+    constraints.push_back(constraint);
+    a->setConstrained(true);
+    b->setConstrained(true);
+
+    // Constrained bodies step every tick, so bring bodies already in a slow region up to full rate.
+    a->setRateLevel(0);
+    b->setRateLevel(0);
+    dirty = true;
+}
+
+/// <summary>
+/// Removes every constraint attached to an entity.
+/// </summary>
+/// <param name="entity">The entity being removed.</param>
+void ConstraintSolver::Remove(Entity* entity) {
+    size_t kept = 0;
+    for (size_t i = 0; i < constraints.size(); i++) {
+        if (constraints[i].a == entity || constraints[i].b == entity) continue;
+        constraints[kept++] = constraints[i];
+    }
+    if (kept != constraints.size()) {
+        constraints.resize(kept);
+        dirty = true;
+    }
+}
+
+/// <summary>
+/// Removes every constraint attached to a dead entity. Call after reaping and before any respawn,
+/// since recycled slots come back to life.
+/// </summary>
+void ConstraintSolver::Prune() {
+    size_t kept = 0;
+    for (size_t i = 0; i < constraints.size(); i++) {
+        if (!constraints[i].a->isAlive() || !constraints[i].b->isAlive()) continue;
+        constraints[kept++] = constraints[i];
+    }
+    if (kept != constraints.size()) {
+        constraints.resize(kept);
+        dirty = true;
+    }
+}
+
+/// <summary>
+/// Removes every constraint.
+/// </summary>
+void ConstraintSolver::Clear() {
+    for (size_t i = 0; i < constraints.size(); i++) {
+        constraints[i].a->setConstrained(false);
+        constraints[i].b->setConstrained(false);
+    }
+    constraints.clear();
+    bodies.clear();
+    dirty = true;
+}
+
+/// <summary>
+/// Greedily colours the constraint graph so no two constraints of a colour share an entity.
+/// </summary>
+void ConstraintSolver::Colour() {
+    // Index every entity touched by a constraint, and mark only those as constrained.
+    std::unordered_map<Entity*, unsigned int> index;
+    for (size_t i = 0; i < bodies.size(); i++) {
+        bodies[i]->setConstrained(false);
+    }
+    bodies.clear();
+    for (size_t i = 0; i < constraints.size(); i++) {
+        Entity* ends[2] = { constraints[i].a, constraints[i].b };
+        unsigned int* slots[2] = { &constraints[i].bodyA, &constraints[i].bodyB };
+        for (int e = 0; e < 2; e++) {
+            auto found = index.find(ends[e]);
+            if (found == index.end()) {
+                found = index.emplace(ends[e], (unsigned int)bodies.size()).first;
+                bodies.push_back(ends[e]);
+                ends[e]->setConstrained(true);
+            }
+            *slots[e] = found->second;
+        }
+    }
+
+    // Lowest colour unused by either end, or the serial batch if all are taken.
+    std::vector<uint64_t> used(bodies.size(), 0);
+    std::vector<unsigned int> colour(constraints.size());
+    unsigned int colourCount = 0;
+    serialBatch = false;
+    for (size_t i = 0; i < constraints.size(); i++) {
+        uint64_t taken = used[constraints[i].bodyA] | used[constraints[i].bodyB];
+        unsigned int c = 0;
+        while (c < MAX_COLOURS && (taken & ((uint64_t)1 << c))) c++;
+
+        if (c < MAX_COLOURS) {
+            used[constraints[i].bodyA] |= (uint64_t)1 << c;
+            used[constraints[i].bodyB] |= (uint64_t)1 << c;
+            if (c + 1 > colourCount) colourCount = c + 1;
+        }
+        else {
+            serialBatch = true;
+        }
+        colour[i] = c;
+    }
+    if (serialBatch) {
+        for (size_t i = 0; i < colour.size(); i++) {
+            if (colour[i] == MAX_COLOURS) colour[i] = colourCount;
+        }
+        colourCount++;
+    }
+
+    // Counting sort of the constraints by colour.
+    colourStart.assign(colourCount + 1, 0);
+    for (size_t i = 0; i < colour.size(); i++) {
+        colourStart[colour[i] + 1]++;
+    }
+    for (size_t c = 1; c < colourStart.size(); c++) {
+        colourStart[c] += colourStart[c - 1];
+    }
+    order.resize(constraints.size());
+    std::vector<unsigned int> cursor(colourStart.begin(), colourStart.end() - 1);
+    for (size_t i = 0; i < colour.size(); i++) {
+        order[cursor[colour[i]]++] = (unsigned int)i;
+    }
+
+    inverseMass.resize(bodies.size());
+    startPosition.resize(bodies.size());
+    recolourCount++;
+    dirty = false;
+}
+
+/// <summary>
+/// Projects a single constraint.
+/// </summary>
+/// <param name="constraint">The constraint.</param>
+/// <param name="alpha">The compliance scaled by the timestep squared.</param>
+void ConstraintSolver::SolveConstraint(DistanceConstraint& constraint, float alpha) {
+    float wa = inverseMass[constraint.bodyA];
+    float wb = inverseMass[constraint.bodyB];
+    float alphaTilde = constraint.compliance * alpha;
+    if (wa + wb + alphaTilde <= 0.0f) return;
+
+    Vector2 difference = constraint.a->position - constraint.b->position;
+    if (boundary == PERIODIC) difference = world.MinimumImage(difference);
+    float distance = difference.Magnitude();
+    if (distance <= 0.0f) return;
+
+    Vector2 normal = difference / distance;
+    float error = distance - constraint.restLength;
+    float deltaLambda = (-error - alphaTilde * constraint.lambda) / (wa + wb + alphaTilde);
+    constraint.lambda += deltaLambda;
+
+    constraint.a->position = constraint.a->position + normal * (wa * deltaLambda);
+    constraint.b->position = constraint.b->position - normal * (wb * deltaLambda);
+}
+
+/// <summary>
+/// Solves every constraint after the entities have been integrated, then turns the
+/// position corrections into velocity.
+/// </summary>
+/// <param name="timestep">The length of the substep in seconds.</param>
+void ConstraintSolver::Solve(float timestep) {
+    if (dirty) Colour();
+    if (constraints.empty()) return;
+
+    for (size_t i = 0; i < bodies.size(); i++) {
+        inverseMass[i] = bodies[i]->isKinematic() ? 0.0f : 1.0f / bodies[i]->mass;
+        startPosition[i] = bodies[i]->position;
+    }
+    for (size_t i = 0; i < constraints.size(); i++) {
+        constraints[i].lambda = 0.0f;
+    }
+
+    float alpha = 1.0f / (timestep * timestep);
+    size_t colours = colourStart.size() - 1;
+
+    for (unsigned int iteration = 0; iteration < iterations; iteration++) {
+        for (size_t c = 0; c < colours; c++) {
+            unsigned int begin = colourStart[c];
+            unsigned int end = colourStart[c + 1];
+
+            // The overflow batch may share entities, so it runs on one thread.
+            if (serialBatch && c == colours - 1) {
+                for (unsigned int k = begin; k < end; k++) {
+                    SolveConstraint(constraints[order[k]], alpha);
+                }
+                continue;
+            }
+
+            ParallelFor(end - begin, 512, [&](size_t first, size_t last) {
+                for (size_t k = first; k < last; k++) {
+                    SolveConstraint(constraints[order[begin + k]], alpha);
+                }
+            });
+        }
+    }
+
+    // The correction becomes velocity so the bodies carry the constraint's motion.
+    for (size_t i = 0; i < bodies.size(); i++) {
+        if (inverseMass[i] == 0.0f) continue;
+        Vector2 correction = bodies[i]->position - startPosition[i];
+        bodies[i]->velocity = bodies[i]->velocity + correction / timestep;
+    }
+}
+
+/// <summary>
+/// Sets whether constraints reach across the edges of the world to the nearest image of their other end.
+/// </summary>
+/// <param name="boundary">The boundary mode.</param>
+/// <param name="world">The periodic unit cell.</param>
+void ConstraintSolver::setBoundary(BoundaryMode boundary, const Bounds& world) {
+    this->boundary = boundary;
+    this->world = world;
+}
+
+/// <summary>
+/// Returns the number of solver iterations per tick.
+/// </summary>
+/// <returns>The iteration count.</returns>
+unsigned int ConstraintSolver::getIterations() {
+    return this->iterations;
+}
+
+/// <summary>
+/// Sets the number of solver iterations per tick.
+/// </summary>
+/// <param name="iterations">The iteration count.</param>
+void ConstraintSolver::setIterations(unsigned int iterations) {
+    this->iterations = iterations;
+}
+
+/// <summary>
+/// Returns the number of constraints.
+/// </summary>
+/// <returns>The constraint count.</returns>
+size_t ConstraintSolver::getConstraintCount() {
+    return this->constraints.size();
+}
+
+/// <summary>
+/// Returns the number of colours in the current colouring, including any serial batch.
+/// </summary>
+/// <returns>The colour count.</returns>
+unsigned int ConstraintSolver::getColourCount() {
+    return colourStart.empty() ? 0 : (unsigned int)colourStart.size() - 1;
+}
+
+/// <summary>
+/// Returns the number of times the constraints have been recoloured.
+/// </summary>
+/// <returns>The recolour count.</returns>
+unsigned int ConstraintSolver::getRecolourCount() {
+    return this->recolourCount;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#ifndef CONSTRAINTSOLVER_H
+#define CONSTRAINTSOLVER_H
+
+#include "../Entities/Entity.h"
+
+// Keeps two entities at a rest length. Zero compliance is a rigid rod, larger values a softer spring.
+struct DistanceConstraint {
+	Entity* a;
+	Entity* b;
+	float restLength;
+	float compliance;
+	float lambda;
+	unsigned int bodyA;
+	unsigned int bodyB;
+};
+
+// An XPBD solver for distance and spring constraints. Constraints are graph-coloured so
+// no two in a colour share an entity, letting each colour be solved in parallel without atomics.
+class ConstraintSolver
+{
+public:
+	ConstraintSolver(unsigned int iterations);
+	void AddDistance(Entity* a, Entity* b, float restLength);
+	void AddSpring(Entity* a, Entity* b, float restLength, float compliance);
+	void Remove(Entity* entity);
+	void Prune();
+	void Clear();
+	void Solve(float timestep);
+	void setBoundary(BoundaryMode boundary, const Bounds& world);
+	unsigned int getIterations();
+	void setIterations(unsigned int iterations);
+	size_t getConstraintCount();
+	unsigned int getColourCount();
+	unsigned int getRecolourCount();
+private:
+	void Colour();
+	void SolveConstraint(DistanceConstraint& constraint, float alpha);
+	unsigned int iterations;
+	BoundaryMode boundary = REFLECTING;
+	Bounds world;
+	bool dirty = false;
+	unsigned int recolourCount = 0;
+	std::vector<DistanceConstraint> constraints;
+
+	// Constraints sorted by colour. The last batch holds any that couldn't be coloured and is solved serially.
+	std::vector<unsigned int> colourStart;
+	std::vector<unsigned int> order;
+	bool serialBatch = false;
+
+	// Every entity touched by a constraint.
+	std::vector<Entity*> bodies;
+	std::vector<float> inverseMass;
+	std::vector<Vector2> startPosition;
+};
+
+#endif
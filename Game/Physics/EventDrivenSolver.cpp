@@ -0,0 +1,414 @@
+/*
+Event-driven molecular dynamics for hard circles. Collision, wall and cell
+crossing times are solved exactly and kept in a priority queue. Rather than
+removing events when a particle's course changes, every particle carries a
+stamp that is bumped on each of its events, and queued events predicted
+under an older stamp are skipped as they come off the queue.
+*/
+
+#include "EventDrivenSolver.h"
+#include <math.h>
+
+// Once the queue holds this many events per particle, most of them are stale and it is rebuilt.
+const size_t QUEUE_EVENTS_PER_PARTICLE = 32;
+
+// Directions of a cell crossing, and the walls of the world.
+const uint32_t CROSS_RIGHT = 0;
+const uint32_t CROSS_LEFT = 1;
+const uint32_t CROSS_UP = 2;
+const uint32_t CROSS_DOWN = 3;
+const uint32_t WALL_LEFT = 0;
+const uint32_t WALL_RIGHT = 1;
+const uint32_t WALL_BOTTOM = 2;
+const uint32_t WALL_TOP = 3;
+
+/// <summary>
+/// Event Driven Solver Constructor.
+/// </summary>
+/// <param name="world">The walls the particles bounce off.</param>
+/// <param name="cellSize">The smallest width of a cell. It is raised to the largest diameter if that is bigger.</param>
+EventDrivenSolver::EventDrivenSolver(const Bounds& world, double cellSize) {
+    this->world = world;
+    this->cellSize = cellSize;
+}
+
+/// <summary>
+/// Adds a particle. Call Initialise once every particle is added.
+/// </summary>
+/// <param name="position">The position of the particle. It must not overlap another particle or a wall.</param>
+/// <param name="velocity">The velocity of the particle.</param>
+/// <param name="radius">The radius of the particle.</param>
+/// <param name="mass">The mass of the particle.</param>
+/// <returns>The index of the particle.</returns>
+size_t EventDrivenSolver::Add(const Vector2d& position, const Vector2d& velocity, double radius, double mass) {
+    localTime.push_back(now);
+    stamps.push_back(0);
+    eventCounts.push_back(0);
+    return particles.Add(position, velocity, radius, mass);
+}
+
+/// <summary>
+/// Bins the particles into cells and predicts every particle's first events.
+/// </summary>
+void EventDrivenSolver::Initialise() {
+    double largest = cellSize;
+    for (size_t i = 0; i < particles.getCount(); i++) {
+        largest = fmax(largest, 2.0 * particles.radius[i]);
+    }
+
+    double spanX = (double)world.max.x - world.min.x;
+    double spanY = (double)world.max.y - world.min.y;
+    width = (int)fmax(floor(spanX / largest), 1.0);
+    height = (int)fmax(floor(spanY / largest), 1.0);
+    cellWidth = spanX / width;
+    cellHeight = spanY / height;
+
+    cells.assign((size_t)width * height, std::vector<uint32_t>());
+    cellOf.assign(particles.getCount(), 0);
+    slotOf.assign(particles.getCount(), 0);
+    for (uint32_t i = 0; i < particles.getCount(); i++) {
+        int x = (int)floor((particles.positionX[i] - world.min.x) / cellWidth);
+        int y = (int)floor((particles.positionY[i] - world.min.y) / cellHeight);
+        x = x < 0 ? 0 : (x >= width ? width - 1 : x);
+        y = y < 0 ? 0 : (y >= height ? height - 1 : y);
+        Insert(i, (uint32_t)(y * width + x));
+    }
+
+    Rebuild();
+}
+
+/// <summary>
+/// Throws away every queued event and predicts each particle's events again from now.
+/// </summary>
+void EventDrivenSolver::Rebuild() {
+    queue = std::priority_queue<CollisionEvent, std::vector<CollisionEvent>, EventLater>();
+    for (uint32_t i = 0; i < particles.getCount(); i++) {
+        stamps[i]++;
+    }
+    for (uint32_t i = 0; i < particles.getCount(); i++) {
+        Predict(i);
+    }
+}
+
+/// <summary>
+/// Processes every event up to a time, then brings every particle forward to it.
+/// </summary>
+/// <param name="time">The time to advance to.</param>
+void EventDrivenSolver::AdvanceTo(double time) {
+    while (!queue.empty() && queue.top().time <= time) {
+        CollisionEvent event = queue.top();
+        queue.pop();
+
+        if (event.stampA != stamps[event.a] || (event.type == EVENT_COLLISION && event.stampB != stamps[event.b])) {
+            staleEvents++;
+            continue;
+        }
+
+        now = event.time;
+        switch (event.type) {
+        case EVENT_COLLISION: Collide(event.a, event.b); break;
+        case EVENT_WALL: Bounce(event.a, event.b); break;
+        case EVENT_CELL: Cross(event.a, event.b); break;
+        }
+
+        if (queue.size() > QUEUE_EVENTS_PER_PARTICLE * particles.getCount()) {
+            for (uint32_t i = 0; i < particles.getCount(); i++) {
+                Synchronise(i, now);
+            }
+            Rebuild();
+        }
+    }
+
+    // Moving every particle along its course doesn't change any prediction, so the queue stays valid.
+    now = time;
+    for (uint32_t i = 0; i < particles.getCount(); i++) {
+        Synchronise(i, now);
+    }
+}
+
+/// <summary>
+/// Brings a particle's position forward to a time along its straight course.
+/// </summary>
+void EventDrivenSolver::Synchronise(uint32_t index, double time) {
+    double elapsed = time - localTime[index];
+    particles.positionX[index] += particles.velocityX[index] * elapsed;
+    particles.positionY[index] += particles.velocityY[index] * elapsed;
+    localTime[index] = time;
+}
+
+/// <summary>
+/// Predicts a particle's collisions with the particles in the cells around it, its next wall
+/// bounce and when it leaves its cell. Call it after the particle's stamp has been bumped.
+/// </summary>
+void EventDrivenSolver::Predict(uint32_t index) {
+    Synchronise(index, now);
+
+    int cellX = (int)(cellOf[index] % width);
+    int cellY = (int)(cellOf[index] / width);
+    for (int y = cellY - 1; y <= cellY + 1; y++) {
+        if (y < 0 || y >= height) continue;
+        for (int x = cellX - 1; x <= cellX + 1; x++) {
+            if (x < 0 || x >= width) continue;
+            const std::vector<uint32_t>& cell = cells[(size_t)y * width + x];
+            for (size_t k = 0; k < cell.size(); k++) {
+                if (cell[k] != index) PredictPair(index, cell[k]);
+            }
+        }
+    }
+
+    double px = particles.positionX[index], py = particles.positionY[index];
+    double vx = particles.velocityX[index], vy = particles.velocityY[index];
+    double radius = particles.radius[index];
+
+    // The first wall the particle will touch.
+    double wallTime = INFINITY;
+    uint32_t wall = 0;
+    if (vx < 0.0) { wallTime = (world.min.x + radius - px) / vx; wall = WALL_LEFT; }
+    else if (vx > 0.0) { wallTime = (world.max.x - radius - px) / vx; wall = WALL_RIGHT; }
+    if (vy < 0.0) {
+        double t = (world.min.y + radius - py) / vy;
+        if (t < wallTime) { wallTime = t; wall = WALL_BOTTOM; }
+    }
+    else if (vy > 0.0) {
+        double t = (world.max.y - radius - py) / vy;
+        if (t < wallTime) { wallTime = t; wall = WALL_TOP; }
+    }
+    if (wallTime < INFINITY) {
+        queue.push({ now + fmax(wallTime, 0.0), index, wall, stamps[index], 0, EVENT_WALL });
+    }
+
+    // The first edge of its cell the particle will cross, unless that edge is a wall.
+    double cellTime = INFINITY;
+    uint32_t direction = 0;
+    if (vx > 0.0 && cellX + 1 < width) { cellTime = (world.min.x + (cellX + 1) * cellWidth - px) / vx; direction = CROSS_RIGHT; }
+    else if (vx < 0.0 && cellX > 0) { cellTime = (world.min.x + cellX * cellWidth - px) / vx; direction = CROSS_LEFT; }
+    if (vy > 0.0 && cellY + 1 < height) {
+        double t = (world.min.y + (cellY + 1) * cellHeight - py) / vy;
+        if (t < cellTime) { cellTime = t; direction = CROSS_UP; }
+    }
+    else if (vy < 0.0 && cellY > 0) {
+        double t = (world.min.y + cellY * cellHeight - py) / vy;
+        if (t < cellTime) { cellTime = t; direction = CROSS_DOWN; }
+    }
+    if (cellTime < INFINITY) {
+        queue.push({ now + fmax(cellTime, 0.0), index, direction, stamps[index], 0, EVENT_CELL });
+    }
+}
+
+/// <summary>
+/// Solves when two circles will touch, and queues the collision if they are closing on each other.
+/// </summary>
+void EventDrivenSolver::PredictPair(uint32_t i, uint32_t j) {
+    pairTests++;
+    if (particles.inverseMass[i] + particles.inverseMass[j] == 0.0) return;
+
+    // The other particle may still be at the time of its last event.
+    double elapsed = now - localTime[j];
+    double dx = particles.positionX[j] + particles.velocityX[j] * elapsed - particles.positionX[i];
+    double dy = particles.positionY[j] + particles.velocityY[j] * elapsed - particles.positionY[i];
+    double dvx = particles.velocityX[j] - particles.velocityX[i];
+    double dvy = particles.velocityY[j] - particles.velocityY[i];
+
+    double closing = dx * dvx + dy * dvy;
+    if (closing >= 0.0) return;
+
+    double sigma = particles.radius[i] + particles.radius[j];
+    double speedSqr = dvx * dvx + dvy * dvy;
+    double gap = dx * dx + dy * dy - sigma * sigma;
+    double discriminant = closing * closing - speedSqr * gap;
+    if (discriminant < 0.0) return;
+
+    // The smaller root, written so it doesn't cancel when the circles are close. Already touching collides now.
+    double time = gap <= 0.0 ? 0.0 : gap / (-closing + sqrt(discriminant));
+    queue.push({ now + time, i, j, stamps[i], stamps[j], EVENT_COLLISION });
+}
+
+/// <summary>
+/// Exchanges momentum along the line between two touching circles, then predicts both again.
+/// </summary>
+void EventDrivenSolver::Collide(uint32_t i, uint32_t j) {
+    Synchronise(i, now);
+    Synchronise(j, now);
+
+    double dx = particles.positionX[j] - particles.positionX[i];
+    double dy = particles.positionY[j] - particles.positionY[i];
+    double dvx = particles.velocityX[j] - particles.velocityX[i];
+    double dvy = particles.velocityY[j] - particles.velocityY[i];
+    double distanceSqr = dx * dx + dy * dy;
+
+    double inverseMassI = particles.inverseMass[i];
+    double inverseMassJ = particles.inverseMass[j];
+    double impulse = 2.0 * (dx * dvx + dy * dvy) / (distanceSqr * (inverseMassI + inverseMassJ));
+    particles.velocityX[i] += impulse * inverseMassI * dx;
+    particles.velocityY[i] += impulse * inverseMassI * dy;
+    particles.velocityX[j] -= impulse * inverseMassJ * dx;
+    particles.velocityY[j] -= impulse * inverseMassJ * dy;
+
+    collisions++;
+    eventCounts[i]++;
+    eventCounts[j]++;
+    stamps[i]++;
+    stamps[j]++;
+    Predict(i);
+    Predict(j);
+}
+
+/// <summary>
+/// Reflects a particle off a wall, then predicts it again.
+/// </summary>
+void EventDrivenSolver::Bounce(uint32_t index, uint32_t wall) {
+    Synchronise(index, now);
+    if (wall == WALL_LEFT || wall == WALL_RIGHT) particles.velocityX[index] = -particles.velocityX[index];
+    else particles.velocityY[index] = -particles.velocityY[index];
+
+    wallBounces++;
+    eventCounts[index]++;
+    stamps[index]++;
+    Predict(index);
+}
+
+/// <summary>
+/// Moves a particle into the next cell, then predicts it against its new neighbours.
+/// </summary>
+void EventDrivenSolver::Cross(uint32_t index, uint32_t direction) {
+    uint32_t cell = cellOf[index];
+    Remove(index);
+    switch (direction) {
+    case CROSS_RIGHT: cell += 1; break;
+    case CROSS_LEFT: cell -= 1; break;
+    case CROSS_UP: cell += width; break;
+    case CROSS_DOWN: cell -= width; break;
+    }
+    Insert(index, cell);
+
+    cellCrossings++;
+    stamps[index]++;
+    Predict(index);
+}
+
+/// <summary>
+/// Adds a particle to a cell.
+/// </summary>
+void EventDrivenSolver::Insert(uint32_t index, uint32_t cell) {
+    cellOf[index] = cell;
+    slotOf[index] = (uint32_t)cells[cell].size();
+    cells[cell].push_back(index);
+}
+
+/// <summary>
+/// Removes a particle from its cell by moving the cell's last particle into its slot.
+/// </summary>
+void EventDrivenSolver::Remove(uint32_t index) {
+    std::vector<uint32_t>& cell = cells[cellOf[index]];
+    uint32_t moved = cell.back();
+    cell[slotOf[index]] = moved;
+    slotOf[moved] = slotOf[index];
+    cell.pop_back();
+}
+
+/// <summary>
+/// Returns the time the solver has advanced to.
+/// </summary>
+/// <returns>The simulation time.</returns>
+double EventDrivenSolver::getTime() {
+    return this->now;
+}
+
+/// <summary>
+/// Returns the number of particles.
+/// </summary>
+/// <returns>The number of particles.</returns>
+size_t EventDrivenSolver::getCount() {
+    return particles.getCount();
+}
+
+/// <summary>
+/// Returns the position of a particle at the current time.
+/// </summary>
+/// <param name="index">The particle.</param>
+/// <returns>Its position.</returns>
+Vector2d EventDrivenSolver::getPosition(size_t index) {
+    double elapsed = now - localTime[index];
+    return Vector2d(particles.positionX[index] + particles.velocityX[index] * elapsed,
+        particles.positionY[index] + particles.velocityY[index] * elapsed);
+}
+
+/// <summary>
+/// Returns the velocity of a particle.
+/// </summary>
+/// <param name="index">The particle.</param>
+/// <returns>Its velocity.</returns>
+Vector2d EventDrivenSolver::getVelocity(size_t index) {
+    return particles.getVelocity(index);
+}
+
+/// <summary>
+/// Returns how many collisions and wall bounces a particle has had.
+/// </summary>
+/// <param name="index">The particle.</param>
+/// <returns>Its number of events.</returns>
+uint32_t EventDrivenSolver::getEventCount(size_t index) {
+    return eventCounts[index];
+}
+
+/// <summary>
+/// Returns the total kinetic energy, which elastic collisions keep constant.
+/// </summary>
+/// <returns>The kinetic energy.</returns>
+double EventDrivenSolver::KineticEnergy() {
+    double total = 0.0;
+    for (size_t i = 0; i < particles.getCount(); i++) {
+        if (particles.inverseMass[i] == 0.0) continue;
+        double speedSqr = particles.velocityX[i] * particles.velocityX[i] + particles.velocityY[i] * particles.velocityY[i];
+        total += 0.5 * speedSqr / particles.inverseMass[i];
+    }
+    return total;
+}
+
+/// <summary>
+/// Returns the number of collisions between particles so far.
+/// </summary>
+/// <returns>The number of collisions.</returns>
+unsigned long long EventDrivenSolver::getCollisionCount() {
+    return this->collisions;
+}
+
+/// <summary>
+/// Returns the number of wall bounces so far.
+/// </summary>
+/// <returns>The number of wall bounces.</returns>
+unsigned long long EventDrivenSolver::getWallCount() {
+    return this->wallBounces;
+}
+
+/// <summary>
+/// Returns the number of cell crossings so far.
+/// </summary>
+/// <returns>The number of cell crossings.</returns>
+unsigned long long EventDrivenSolver::getCellCrossingCount() {
+    return this->cellCrossings;
+}
+
+/// <summary>
+/// Returns the number of queued events skipped because a particle's course changed after they were predicted.
+/// </summary>
+/// <returns>The number of stale events.</returns>
+unsigned long long EventDrivenSolver::getStaleCount() {
+    return this->staleEvents;
+}
+
+/// <summary>
+/// Returns the number of pairs whose collision time has been solved.
+/// </summary>
+/// <returns>The number of pair tests.</returns>
+unsigned long long EventDrivenSolver::getPairTestCount() {
+    return this->pairTests;
+}
+
+/// <summary>
+/// Returns the number of events in the queue, stale ones included.
+/// </summary>
+/// <returns>The queue size.</returns>
+size_t EventDrivenSolver::getQueueSize() {
+    return queue.size();
+}
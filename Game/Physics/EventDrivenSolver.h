@@ -0,0 +1,97 @@
+#pragma once
+
+#ifndef EVENTDRIVENSOLVER_H
+#define EVENTDRIVENSOLVER_H
+
+#include "../ParticleStorage.h"
+#include "../Bounds.h"
+#include <stdint.h>
+#include <queue>
+
+// What happens at an event.
+enum EventType {
+	EVENT_COLLISION,
+	EVENT_WALL,
+	EVENT_CELL
+};
+
+// A predicted event. It is stale once either particle's stamp has moved on since it was predicted.
+struct CollisionEvent {
+	double time;
+	uint32_t a;
+	uint32_t b;
+	uint32_t stampA;
+	uint32_t stampB;
+	EventType type;
+};
+
+// Orders the event queue so the earliest event is on top.
+struct EventLater {
+	bool operator()(const CollisionEvent& left, const CollisionEvent& right) const {
+		return left.time > right.time;
+	}
+};
+
+// Event-driven hard-sphere dynamics. Circles fly in straight lines between events, and the
+// solver jumps from one exactly predicted collision, wall bounce or cell crossing to the next.
+// Each particle keeps its state at the time of its last event and is only brought forward
+// when something touches it. Collisions are elastic, so kinetic energy is conserved.
+class EventDrivenSolver
+{
+public:
+	EventDrivenSolver(const Bounds& world, double cellSize);
+	size_t Add(const Vector2d& position, const Vector2d& velocity, double radius, double mass);
+	void Initialise();
+	void AdvanceTo(double time);
+	double getTime();
+	size_t getCount();
+	Vector2d getPosition(size_t index);
+	Vector2d getVelocity(size_t index);
+	uint32_t getEventCount(size_t index);
+	double KineticEnergy();
+	unsigned long long getCollisionCount();
+	unsigned long long getWallCount();
+	unsigned long long getCellCrossingCount();
+	unsigned long long getStaleCount();
+	unsigned long long getPairTestCount();
+	size_t getQueueSize();
+private:
+	void Synchronise(uint32_t index, double time);
+	void Predict(uint32_t index);
+	void PredictPair(uint32_t i, uint32_t j);
+	void Collide(uint32_t i, uint32_t j);
+	void Bounce(uint32_t index, uint32_t wall);
+	void Cross(uint32_t index, uint32_t direction);
+	void Insert(uint32_t index, uint32_t cell);
+	void Remove(uint32_t index);
+	void Rebuild();
+	Bounds world;
+	double cellSize;
+	double now = 0.0;
+
+	// Particles, the time their state was last brought forward, and how many times it has changed.
+	ParticleStorage<double> particles;
+	std::vector<double> localTime;
+	std::vector<uint32_t> stamps;
+	std::vector<uint32_t> eventCounts;
+
+	// Cells at least one diameter wide, so a particle can only hit particles in the cells around its own.
+	int width = 1;
+	int height = 1;
+	double cellWidth = 1.0;
+	double cellHeight = 1.0;
+	std::vector<std::vector<uint32_t>> cells;
+	std::vector<uint32_t> cellOf;
+	std::vector<uint32_t> slotOf;
+
+	std::priority_queue<CollisionEvent, std::vector<CollisionEvent>, EventLater> queue;
+
+	// Metrics
+	unsigned long long collisions = 0;
+	unsigned long long wallBounces = 0;
+	unsigned long long cellCrossings = 0;
+	unsigned long long staleEvents = 0;
+	unsigned long long pairTests = 0;
+};
+
+#endif
@@ -0,0 +1,329 @@
+/*
+Weakly compressible SPH. Density and pressure are computed in one pass and the
+pressure and viscosity accelerations in a second, both running in parallel over
+grid cells. Mass is the circle's area, so density is the local area fraction of circles.
+*/
+
+#include "FluidSolver.h"
+
+/// <summary>
+/// Fluid Solver Constructor.
+/// </summary>
+/// <param name="kernelRadius">The smoothing length, and the cell size of the neighbour grid.</param>
+/// <param name="restDensity">The density the fluid relaxes to, as a fraction of area covered.</param>
+/// <param name="stiffness">The pressure per unit of density above rest.</param>
+/// <param name="viscosity">The viscosity coefficient.</param>
+FluidSolver::FluidSolver(float kernelRadius, float restDensity, float stiffness, float viscosity) : grid(kernelRadius) {
+    this->kernelRadius = kernelRadius;
+    this->restDensity = restDensity;
+    this->stiffness = stiffness;
+    this->viscosity = viscosity;
+}
+
+/// <summary>
+/// Adds the pressure and viscosity forces to every circle.
+/// </summary>
+/// <param name="entities">The list of live entities.</param>
+void FluidSolver::ApplyForces(const std::vector<Entity*>& entities) {
+    Gather(entities);
+    if (bodies.empty()) return;
+
+    grid.setCellSize(kernelRadius);
+    grid.Build(x, y);
+
+    ComputeDensity();
+    ComputeAccelerations();
+
+    // Forces are applied as an impulse per tick, so scale the acceleration by the timestep.
+    ParallelFor(bodies.size(), 4096, [this](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            bodies[i]->force.x += accelerationX[i] * mass[i] * TIMESTEP;
+            bodies[i]->force.y += accelerationY[i] * mass[i] * TIMESTEP;
+        }
+    });
+}
+
+/// <summary>
+/// Copies the state of every live circle into flat arrays.
+/// </summary>
+/// <param name="entities">The list of live entities.</param>
+void FluidSolver::Gather(const std::vector<Entity*>& entities) {
+    bodies.clear();
+    for (size_t i = 0; i < entities.size(); i++) {
+        if (entities[i]->type == CIRCLE && entities[i]->isAlive())
+            bodies.push_back(entities[i]);
+    }
+
+    size_t count = bodies.size();
+    Resize(count);
+
+    ParallelFor(count, 4096, [this](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            x[i] = bodies[i]->position.x;
+            y[i] = bodies[i]->position.y;
+            velocityX[i] = bodies[i]->velocity.x;
+            velocityY[i] = bodies[i]->velocity.y;
+            mass[i] = bodies[i]->mass;
+            fixed[i] = bodies[i]->isKinematic();
+        }
+    });
+}
+
+/// <summary>
+/// Sizes the flat arrays for a number of bodies.
+/// </summary>
+/// <param name="count">The number of bodies.</param>
+void FluidSolver::Resize(size_t count) {
+    x.resize(count);
+    y.resize(count);
+    velocityX.resize(count);
+    velocityY.resize(count);
+    mass.resize(count);
+    density.resize(count);
+    pressure.resize(count);
+    radius.resize(count);
+    accelerationX.resize(count);
+    accelerationY.resize(count);
+    fixed.resize(count);
+}
+
+/// <summary>
+/// Sums the poly6 kernel over each circle's neighbours to get its density, then its pressure.
+/// </summary>
+void FluidSolver::ComputeDensity() {
+    float h = kernelRadius;
+    float hSqr = h * h;
+    float poly6 = 4.0f / (float)(PI * pow(h, 8));
+
+    ParallelFor(grid.getCellCount(), 64, [&](size_t begin, size_t end) {
+        for (size_t cell = begin; cell < end; cell++) {
+            int cellX = (int)cell % grid.getWidth();
+            int cellY = (int)cell / grid.getWidth();
+
+            for (unsigned int k = grid.cellStart[cell]; k < grid.cellStart[cell + 1]; k++) {
+                unsigned int i = grid.cellEntries[k];
+                float sum = 0.0f;
+
+                int minX, maxX, minY, maxY;
+                grid.getStencil(cellX, cellY, minX, maxX, minY, maxY);
+                for (int ny = minY; ny <= maxY; ny++) {
+                    for (int nx = minX; nx <= maxX; nx++) {
+                        unsigned int other;
+                        if (!grid.getNeighbourCell(nx, ny, other)) continue;
+                        for (unsigned int l = grid.cellStart[other]; l < grid.cellStart[other + 1]; l++) {
+                            unsigned int j = grid.cellEntries[l];
+                            float dx = x[j] - x[i];
+                            float dy = y[j] - y[i];
+                            grid.MinimumImage(dx, dy);
+                            float distSqr = dx * dx + dy * dy;
+                            if (distSqr >= hSqr) continue;
+                            float w = hSqr - distSqr;
+                            sum += mass[j] * w * w * w;
+                        }
+                    }
+                }
+
+                density[i] = sum * poly6;
+
+                // Clamped to zero so the fluid doesn't clump under tension.
+                pressure[i] = fmaxf(stiffness * (density[i] - restDensity), 0.0f);
+            }
+        }
+    });
+
+    double total = 0.0;
+    for (size_t i = 0; i < density.size(); i++) {
+        total += density[i];
+    }
+    averageDensity = (float)(total / density.size());
+}
+
+/// <summary>
+/// Sums the spiky kernel pressure gradient and the viscosity laplacian into each body's acceleration.
+/// </summary>
+void FluidSolver::ComputeAccelerations() {
+    float h = kernelRadius;
+    float hSqr = h * h;
+    float spiky = -30.0f / (float)(PI * pow(h, 5));
+    float laplacian = 40.0f / (float)(PI * pow(h, 5));
+
+    ParallelFor(grid.getCellCount(), 64, [&](size_t begin, size_t end) {
+        for (size_t cell = begin; cell < end; cell++) {
+            int cellX = (int)cell % grid.getWidth();
+            int cellY = (int)cell / grid.getWidth();
+
+            for (unsigned int k = grid.cellStart[cell]; k < grid.cellStart[cell + 1]; k++) {
+                unsigned int i = grid.cellEntries[k];
+                accelerationX[i] = 0.0f;
+                accelerationY[i] = 0.0f;
+                if (fixed[i] || density[i] <= 0.0f) continue;
+
+                float ax = 0.0f, ay = 0.0f;
+                float pressureTerm = pressure[i] / (density[i] * density[i]);
+
+                int minX, maxX, minY, maxY;
+                grid.getStencil(cellX, cellY, minX, maxX, minY, maxY);
+                for (int ny = minY; ny <= maxY; ny++) {
+                    for (int nx = minX; nx <= maxX; nx++) {
+                        unsigned int other;
+                        if (!grid.getNeighbourCell(nx, ny, other)) continue;
+                        for (unsigned int l = grid.cellStart[other]; l < grid.cellStart[other + 1]; l++) {
+                            unsigned int j = grid.cellEntries[l];
+                            if (j == i) continue;
+                            float dx = x[i] - x[j];
+                            float dy = y[i] - y[j];
+                            grid.MinimumImage(dx, dy);
+                            float distSqr = dx * dx + dy * dy;
+                            if (distSqr >= hSqr || distSqr <= 0.0f) continue;
+
+                            float distance = sqrtf(distSqr);
+                            float falloff = h - distance;
+
+                            // Pressure pushes apart along the pair.
+                            float p = -mass[j] * (pressureTerm + pressure[j] / (density[j] * density[j])) * spiky * falloff * falloff / distance;
+                            ax += p * dx;
+                            ay += p * dy;
+
+                            // Viscosity pulls the velocities together.
+                            float v = viscosity * mass[j] / density[j] * laplacian * falloff;
+                            ax += v * (velocityX[j] - velocityX[i]);
+                            ay += v * (velocityY[j] - velocityY[i]);
+                        }
+                    }
+                }
+
+                accelerationX[i] = ax;
+                accelerationY[i] = ay;
+            }
+        }
+    });
+}
+
+/// <summary>
+/// Sums half the overlap with every touching neighbour into each body's correction, kept in the acceleration arrays.
+/// Every body only writes its own correction, so the pass runs over cells in parallel.
+/// </summary>
+void FluidSolver::ComputeSeparation() {
+    ParallelFor(grid.getCellCount(), 64, [&](size_t begin, size_t end) {
+        for (size_t cell = begin; cell < end; cell++) {
+            int cellX = (int)cell % grid.getWidth();
+            int cellY = (int)cell / grid.getWidth();
+
+            for (unsigned int k = grid.cellStart[cell]; k < grid.cellStart[cell + 1]; k++) {
+                unsigned int i = grid.cellEntries[k];
+                accelerationX[i] = 0.0f;
+                accelerationY[i] = 0.0f;
+                if (fixed[i]) continue;
+
+                float cx = 0.0f, cy = 0.0f;
+                int minX, maxX, minY, maxY;
+                grid.getStencil(cellX, cellY, minX, maxX, minY, maxY);
+                for (int ny = minY; ny <= maxY; ny++) {
+                    for (int nx = minX; nx <= maxX; nx++) {
+                        unsigned int other;
+                        if (!grid.getNeighbourCell(nx, ny, other)) continue;
+                        for (unsigned int l = grid.cellStart[other]; l < grid.cellStart[other + 1]; l++) {
+                            unsigned int j = grid.cellEntries[l];
+                            if (j == i) continue;
+                            float dx = x[i] - x[j];
+                            float dy = y[i] - y[j];
+                            grid.MinimumImage(dx, dy);
+                            float distSqr = dx * dx + dy * dy;
+                            float contact = radius[i] + radius[j];
+                            if (distSqr >= contact * contact || distSqr <= 0.0f) continue;
+
+                            float distance = sqrtf(distSqr);
+                            float push = (fixed[j] ? 1.0f : 0.5f) * (contact - distance) / distance;
+                            cx += push * dx;
+                            cy += push * dy;
+                        }
+                    }
+                }
+
+                accelerationX[i] = cx;
+                accelerationY[i] = cy;
+            }
+        }
+    });
+}
+
+/// <summary>
+/// Sets whether the fluid is continuous across the edges of the world.
+/// </summary>
+/// <param name="boundary">The boundary mode.</param>
+/// <param name="world">The periodic unit cell.</param>
+void FluidSolver::setBoundary(BoundaryMode boundary, const Bounds& world) {
+    grid.setPeriodic(boundary == PERIODIC, world);
+}
+
+/// <summary>
+/// Returns the smoothing length.
+/// </summary>
+/// <returns>The kernel radius.</returns>
+float FluidSolver::getKernelRadius() {
+    return this->kernelRadius;
+}
+
+/// <summary>
+/// Sets the smoothing length, which is also the cell size of the neighbour grid.
+/// </summary>
+/// <param name="kernelRadius">The kernel radius.</param>
+void FluidSolver::setKernelRadius(float kernelRadius) {
+    this->kernelRadius = kernelRadius;
+}
+
+/// <summary>
+/// Returns the rest density.
+/// </summary>
+/// <returns>The rest density.</returns>
+float FluidSolver::getRestDensity() {
+    return this->restDensity;
+}
+
+/// <summary>
+/// Sets the rest density.
+/// </summary>
+/// <param name="restDensity">The rest density.</param>
+void FluidSolver::setRestDensity(float restDensity) {
+    this->restDensity = restDensity;
+}
+
+/// <summary>
+/// Returns the pressure stiffness.
+/// </summary>
+/// <returns>The stiffness.</returns>
+float FluidSolver::getStiffness() {
+    return this->stiffness;
+}
+
+/// <summary>
+/// Sets the pressure stiffness.
+/// </summary>
+/// <param name="stiffness">The stiffness.</param>
+void FluidSolver::setStiffness(float stiffness) {
+    this->stiffness = stiffness;
+}
+
+/// <summary>
+/// Returns the viscosity coefficient.
+/// </summary>
+/// <returns>The viscosity.</returns>
+float FluidSolver::getViscosity() {
+    return this->viscosity;
+}
+
+/// <summary>
+/// Sets the viscosity coefficient.
+/// </summary>
+/// <param name="viscosity">The viscosity.</param>
+void FluidSolver::setViscosity(float viscosity) {
+    this->viscosity = viscosity;
+}
+
+/// <summary>
+/// Returns the mean density of the last pass.
+/// </summary>
+/// <returns>The average density.</returns>
+float FluidSolver::getAverageDensity() {
+    return this->averageDensity;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#ifndef FLUIDSOLVER_H
+#define FLUIDSOLVER_H
+
+#include "../Entities/Entity.h"
+#include "../ParticleStorage.h"
+#include "../Parallel.h"
+#include "SpatialGrid.h"
+
+// Smoothed-particle hydrodynamics over the circles. The neighbour grid uses the
+// kernel radius as its cell size, so every neighbour lies in the surrounding 3x3 cells.
+// Runs over the circles, or over bulk particle storage for runs without a window.
+class FluidSolver
+{
+public:
+	FluidSolver(float kernelRadius, float restDensity, float stiffness, float viscosity);
+	void ApplyForces(const std::vector<Entity*>& entities);
+	template<typename T> void ApplyForces(const ParticleView<T>& particles);
+	template<typename T> void Separate(const ParticleView<T>& particles, T timestep);
+	void setBoundary(BoundaryMode boundary, const Bounds& world);
+	float getKernelRadius();
+	void setKernelRadius(float kernelRadius);
+	float getRestDensity();
+	void setRestDensity(float restDensity);
+	float getStiffness();
+	void setStiffness(float stiffness);
+	float getViscosity();
+	void setViscosity(float viscosity);
+	float getAverageDensity();
+private:
+	void Gather(const std::vector<Entity*>& entities);
+	void Resize(size_t count);
+	void ComputeDensity();
+	void ComputeAccelerations();
+	void ComputeSeparation();
+	float kernelRadius;
+	float restDensity;
+	float stiffness;
+	float viscosity;
+	float averageDensity = 0.0f;
+
+	std::vector<Entity*> bodies;
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> velocityX;
+	std::vector<float> velocityY;
+	std::vector<float> mass;
+	std::vector<float> density;
+	std::vector<float> pressure;
+	std::vector<float> radius;
+	std::vector<float> accelerationX;
+	std::vector<float> accelerationY;
+	std::vector<unsigned char> fixed;
+	SpatialGrid grid;
+};
+
+/// <summary>
+/// Adds the pressure and viscosity forces to every particle of bulk storage. Mass is taken from the
+/// inverse mass, so particles should be given their area as mass for the rest density to hold.
+/// </summary>
+/// <param name="particles">The particle columns. Forces are added to, not replaced.</param>
+template<typename T>
+void FluidSolver::ApplyForces(const ParticleView<T>& particles) {
+	size_t count = particles.getCount();
+	bodies.clear();
+	Resize(count);
+	if (count == 0) return;
+
+	ParallelFor(count, 4096, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			x[i] = (float)particles.positionX[i];
+			y[i] = (float)particles.positionY[i];
+			velocityX[i] = (float)particles.velocityX[i];
+			velocityY[i] = (float)particles.velocityY[i];
+			fixed[i] = particles.inverseMass[i] == (T)0;
+			mass[i] = fixed[i] ? 0.0f : (float)((T)1 / particles.inverseMass[i]);
+		}
+	});
+
+	grid.setCellSize(kernelRadius);
+	grid.Build(x, y);
+
+	ComputeDensity();
+	ComputeAccelerations();
+
+	// Storage forces are true forces, unlike an Entity's per tick impulse.
+	ParallelFor(count, 4096, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			particles.forceX[i] += (T)(accelerationX[i] * mass[i]);
+			particles.forceY[i] += (T)(accelerationY[i] * mass[i]);
+		}
+	});
+}
+
+/// <summary>
+/// Pushes overlapping particles of bulk storage apart, as circle contacts do in the window, and changes
+/// their velocity by the distance moved. Without it the fluid's own pressure is far too soft to hold up
+/// a tall column against gravity at a stable timestep.
+/// </summary>
+/// <param name="particles">The particle columns.</param>
+/// <param name="timestep">The timestep the particles were just moved over.</param>
+template<typename T>
+void FluidSolver::Separate(const ParticleView<T>& particles, T timestep) {
+	size_t count = particles.getCount();
+	bodies.clear();
+	Resize(count);
+	if (count == 0) return;
+
+	ParallelFor(count, 4096, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			x[i] = (float)particles.positionX[i];
+			y[i] = (float)particles.positionY[i];
+			radius[i] = (float)particles.radius[i];
+			fixed[i] = particles.inverseMass[i] == (T)0;
+		}
+	});
+
+	grid.setCellSize(kernelRadius);
+	grid.Build(x, y);
+	ComputeSeparation();
+
+	T inverseTimestep = (T)1 / timestep;
+	ParallelFor(count, 4096, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			particles.positionX[i] += (T)accelerationX[i];
+			particles.positionY[i] += (T)accelerationY[i];
+			particles.velocityX[i] += (T)accelerationX[i] * inverseTimestep;
+			particles.velocityY[i] += (T)accelerationY[i] * inverseTimestep;
+		}
+	});
+}
+
+#endif
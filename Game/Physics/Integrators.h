@@ -0,0 +1,167 @@
+#pragma once
+
+#ifndef INTEGRATORS_H
+#define INTEGRATORS_H
+
+#include "Kernels.h"
+
+/*
+Time integration policies over particle storage. The tick loop is a template on the policy,
+so the choice is made once at compile time and every step inlines straight into the kernels.
+
+Each policy's Step takes a Forces functor that fills the storage's force arrays for the
+current positions and velocities. Policies that start a step from the force at the current
+state keep it in the force arrays between steps, so the last evaluation isn't paid for twice.
+Call Prepare once before the first step.
+*/
+
+/// <summary>
+/// Clears the forces and evaluates them at the current state.
+/// </summary>
+template<typename T, typename Forces>
+void EvaluateForces(ParticleStorage<T>& particles, Forces& forces) {
+	Kernels<T>::ClearForces(particles);
+	forces(particles);
+}
+
+// Semi-implicit (symplectic) Euler: kick by the current force, then drift. First order.
+template<typename T>
+class SymplecticEuler
+{
+public:
+	static const char* getName() { return "symplectic-euler"; }
+
+	template<typename Forces>
+	void Prepare(ParticleStorage<T>& particles, Forces& forces) {
+		EvaluateForces(particles, forces);
+	}
+
+	template<typename Forces>
+	void Step(ParticleStorage<T>& particles, Forces& forces, T timestep) {
+		Kernels<T>::Kick(particles, timestep, T(0), T(0));
+		Kernels<T>::Drift(particles, timestep);
+		EvaluateForces(particles, forces);
+	}
+};
+
+// Velocity Verlet: half kick, drift, evaluate, half kick. Second order and symplectic,
+// with one force evaluation per step because the last one carries over.
+template<typename T>
+class VelocityVerlet
+{
+public:
+	static const char* getName() { return "velocity-verlet"; }
+
+	template<typename Forces>
+	void Prepare(ParticleStorage<T>& particles, Forces& forces) {
+		EvaluateForces(particles, forces);
+	}
+
+	template<typename Forces>
+	void Step(ParticleStorage<T>& particles, Forces& forces, T timestep) {
+		T half = timestep * T(0.5);
+		Kernels<T>::Kick(particles, half, T(0), T(0));
+		Kernels<T>::Drift(particles, timestep);
+		EvaluateForces(particles, forces);
+		Kernels<T>::Kick(particles, half, T(0), T(0));
+	}
+};
+
+// Leapfrog in its drift-kick-drift form: half drift, evaluate, kick, half drift. Second order
+// and symplectic, with the force taken at the midpoint of the step, so nothing carries over.
+template<typename T>
+class Leapfrog
+{
+public:
+	static const char* getName() { return "leapfrog"; }
+
+	template<typename Forces>
+	void Prepare(ParticleStorage<T>&, Forces&) {}
+
+	template<typename Forces>
+	void Step(ParticleStorage<T>& particles, Forces& forces, T timestep) {
+		T half = timestep * T(0.5);
+		Kernels<T>::Drift(particles, half);
+		EvaluateForces(particles, forces);
+		Kernels<T>::Kick(particles, timestep, T(0), T(0));
+		Kernels<T>::Drift(particles, half);
+	}
+};
+
+// Classic fourth order Runge-Kutta. Very accurate per step but not symplectic, so energy
+// still drifts over long runs, and it costs four force evaluations per step.
+template<typename T>
+class RungeKutta4
+{
+public:
+	static const char* getName() { return "rk4"; }
+
+	template<typename Forces>
+	void Prepare(ParticleStorage<T>& particles, Forces& forces) {
+		EvaluateForces(particles, forces);
+	}
+
+	template<typename Forces>
+	void Step(ParticleStorage<T>& particles, Forces& forces, T timestep) {
+		size_t count = particles.getCount();
+		startX.assign(particles.positionX.begin(), particles.positionX.end());
+		startY.assign(particles.positionY.begin(), particles.positionY.end());
+		startVX.assign(particles.velocityX.begin(), particles.velocityX.end());
+		startVY.assign(particles.velocityY.begin(), particles.velocityY.end());
+		sumX.assign(count, T(0));
+		sumY.assign(count, T(0));
+		sumVX.assign(count, T(0));
+		sumVY.assign(count, T(0));
+
+		// Stage k is taken at the current state. Add it to the sums with its weight,
+		// then move the state to the start plus the stage's derivative over the next offset.
+		const T weights[4] = { T(1), T(2), T(2), T(1) };
+		const T offsets[3] = { timestep * T(0.5), timestep * T(0.5), timestep };
+		for (int stage = 0; stage < 4; stage++) {
+			T weight = weights[stage];
+			T offset = stage < 3 ? offsets[stage] : T(0);
+			bool last = stage == 3;
+
+			ParallelFor(count, KERNEL_GRAIN, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++) {
+					T inverseMass = particles.inverseMass[i];
+					T vx = particles.velocityX[i];
+					T vy = particles.velocityY[i];
+					T ax = particles.forceX[i] * inverseMass;
+					T ay = particles.forceY[i] * inverseMass;
+					sumX[i] += weight * vx;
+					sumY[i] += weight * vy;
+					sumVX[i] += weight * ax;
+					sumVY[i] += weight * ay;
+					if (inverseMass == T(0)) continue;
+
+					if (last) {
+						particles.positionX[i] = startX[i] + sumX[i] * (timestep / T(6));
+						particles.positionY[i] = startY[i] + sumY[i] * (timestep / T(6));
+						particles.velocityX[i] = startVX[i] + sumVX[i] * (timestep / T(6));
+						particles.velocityY[i] = startVY[i] + sumVY[i] * (timestep / T(6));
+					}
+					else {
+						particles.positionX[i] = startX[i] + vx * offset;
+						particles.positionY[i] = startY[i] + vy * offset;
+						particles.velocityX[i] = startVX[i] + ax * offset;
+						particles.velocityY[i] = startVY[i] + ay * offset;
+					}
+				}
+			});
+
+			EvaluateForces(particles, forces);
+		}
+	}
+private:
+	typename ParticleStorage<T>::Array startX;
+	typename ParticleStorage<T>::Array startY;
+	typename ParticleStorage<T>::Array startVX;
+	typename ParticleStorage<T>::Array startVY;
+	typename ParticleStorage<T>::Array sumX;
+	typename ParticleStorage<T>::Array sumY;
+	typename ParticleStorage<T>::Array sumVX;
+	typename ParticleStorage<T>::Array sumVY;
+};
+
+#endif
@@ -0,0 +1,107 @@
+/*
+SIMD specialisations of the streaming kernels. Float runs four particles per
+SSE register and double two. Targets without SSE2 fall back to the scalar loops.
+*/
+
+#include "Kernels.h"
+#include "../Simd.h"
+
+/// <summary>
+/// Float kick, four particles at a time. Gravity is masked off for immovable particles.
+/// </summary>
+template<>
+void Kernels<float>::KickRange(ParticleStorage<float>& particles, size_t begin, size_t end, float timestep, float gravityX, float gravityY) {
+	size_t i = begin;
+#ifdef SIMD_SSE2
+	float* vx = particles.velocityX.data();
+	float* vy = particles.velocityY.data();
+	const float* fx = particles.forceX.data();
+	const float* fy = particles.forceY.data();
+	const float* inverseMass = particles.inverseMass.data();
+	__m128 dt = _mm_set1_ps(timestep);
+	__m128 gx = _mm_set1_ps(gravityX);
+	__m128 gy = _mm_set1_ps(gravityY);
+	__m128 zero = _mm_setzero_ps();
+
+	for (; i + 4 <= end; i += 4) {
+		__m128 im = _mm_loadu_ps(inverseMass + i);
+		__m128 movable = _mm_cmpneq_ps(im, zero);
+		__m128 ax = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(fx + i), im), _mm_and_ps(gx, movable));
+		__m128 ay = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(fy + i), im), _mm_and_ps(gy, movable));
+		_mm_storeu_ps(vx + i, _mm_add_ps(_mm_loadu_ps(vx + i), _mm_mul_ps(ax, dt)));
+		_mm_storeu_ps(vy + i, _mm_add_ps(_mm_loadu_ps(vy + i), _mm_mul_ps(ay, dt)));
+	}
+#endif
+	KickScalar(particles, i, end, timestep, gravityX, gravityY);
+}
+
+/// <summary>
+/// Float drift, four particles at a time.
+/// </summary>
+template<>
+void Kernels<float>::DriftRange(ParticleStorage<float>& particles, size_t begin, size_t end, float timestep) {
+	size_t i = begin;
+#ifdef SIMD_SSE2
+	float* x = particles.positionX.data();
+	float* y = particles.positionY.data();
+	const float* vx = particles.velocityX.data();
+	const float* vy = particles.velocityY.data();
+	__m128 dt = _mm_set1_ps(timestep);
+
+	for (; i + 4 <= end; i += 4) {
+		_mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(_mm_loadu_ps(vx + i), dt)));
+		_mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(_mm_loadu_ps(vy + i), dt)));
+	}
+#endif
+	DriftScalar(particles, i, end, timestep);
+}
+
+/// <summary>
+/// Double kick, two particles at a time. Gravity is masked off for immovable particles.
+/// </summary>
+template<>
+void Kernels<double>::KickRange(ParticleStorage<double>& particles, size_t begin, size_t end, double timestep, double gravityX, double gravityY) {
+	size_t i = begin;
+#ifdef SIMD_SSE2
+	double* vx = particles.velocityX.data();
+	double* vy = particles.velocityY.data();
+	const double* fx = particles.forceX.data();
+	const double* fy = particles.forceY.data();
+	const double* inverseMass = particles.inverseMass.data();
+	__m128d dt = _mm_set1_pd(timestep);
+	__m128d gx = _mm_set1_pd(gravityX);
+	__m128d gy = _mm_set1_pd(gravityY);
+	__m128d zero = _mm_setzero_pd();
+
+	for (; i + 2 <= end; i += 2) {
+		__m128d im = _mm_loadu_pd(inverseMass + i);
+		__m128d movable = _mm_cmpneq_pd(im, zero);
+		__m128d ax = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(fx + i), im), _mm_and_pd(gx, movable));
+		__m128d ay = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(fy + i), im), _mm_and_pd(gy, movable));
+		_mm_storeu_pd(vx + i, _mm_add_pd(_mm_loadu_pd(vx + i), _mm_mul_pd(ax, dt)));
+		_mm_storeu_pd(vy + i, _mm_add_pd(_mm_loadu_pd(vy + i), _mm_mul_pd(ay, dt)));
+	}
+#endif
+	KickScalar(particles, i, end, timestep, gravityX, gravityY);
+}
+
+/// <summary>
+/// Double drift, two particles at a time.
+/// </summary>
+template<>
+void Kernels<double>::DriftRange(ParticleStorage<double>& particles, size_t begin, size_t end, double timestep) {
+	size_t i = begin;
+#ifdef SIMD_SSE2
+	double* x = particles.positionX.data();
+	double* y = particles.positionY.data();
+	const double* vx = particles.velocityX.data();
+	const double* vy = particles.velocityY.data();
+	__m128d dt = _mm_set1_pd(timestep);
+
+	for (; i + 2 <= end; i += 2) {
+		_mm_storeu_pd(x + i, _mm_add_pd(_mm_loadu_pd(x + i), _mm_mul_pd(_mm_loadu_pd(vx + i), dt)));
+		_mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(_mm_loadu_pd(vy + i), dt)));
+	}
+#endif
+	DriftScalar(particles, i, end, timestep);
+}
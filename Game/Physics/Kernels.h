@@ -0,0 +1,147 @@
+#pragma once
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "../ParticleStorage.h"
+#include "../Parallel.h"
+#include "../Bounds.h"
+#include "../Common.h"
+#include <algorithm>
+#include <cmath>
+
+// Particles per parallel chunk of a streaming kernel.
+const size_t KERNEL_GRAIN = 16384;
+
+// Streaming kernels over particle storage. The generic versions are plain loops; float and
+// double are specialised with SIMD in Kernels.cpp, so the precision is picked at compile time
+// and the hot loops never branch on it.
+template<typename T>
+class Kernels
+{
+public:
+	static void Kick(ParticleStorage<T>& particles, T timestep, T gravityX, T gravityY);
+	static void Drift(ParticleStorage<T>& particles, T timestep);
+	static void ClearForces(ParticleStorage<T>& particles);
+	static void Confine(ParticleStorage<T>& particles, const Bounds& world, BoundaryMode boundary, T bounciness);
+	static void KickRange(ParticleStorage<T>& particles, size_t begin, size_t end, T timestep, T gravityX, T gravityY);
+	static void DriftRange(ParticleStorage<T>& particles, size_t begin, size_t end, T timestep);
+	static void KickScalar(ParticleStorage<T>& particles, size_t begin, size_t end, T timestep, T gravityX, T gravityY);
+	static void DriftScalar(ParticleStorage<T>& particles, size_t begin, size_t end, T timestep);
+};
+
+/// <summary>
+/// Accelerates every movable particle by its force and a uniform gravity over a timestep.
+/// </summary>
+/// <param name="particles">The particles.</param>
+/// <param name="timestep">The timestep.</param>
+/// <param name="gravityX">The X acceleration of gravity.</param>
+/// <param name="gravityY">The Y acceleration of gravity.</param>
+template<typename T>
+void Kernels<T>::Kick(ParticleStorage<T>& particles, T timestep, T gravityX, T gravityY) {
+	ParallelFor(particles.getCount(), KERNEL_GRAIN, [&](size_t begin, size_t end) {
+		KickRange(particles, begin, end, timestep, gravityX, gravityY);
+	});
+}
+
+/// <summary>
+/// Moves every particle along its velocity over a timestep.
+/// </summary>
+/// <param name="particles">The particles.</param>
+/// <param name="timestep">The timestep.</param>
+template<typename T>
+void Kernels<T>::Drift(ParticleStorage<T>& particles, T timestep) {
+	ParallelFor(particles.getCount(), KERNEL_GRAIN, [&](size_t begin, size_t end) {
+		DriftRange(particles, begin, end, timestep);
+	});
+}
+
+/// <summary>
+/// Zeroes every particle's force before the force passes accumulate into it.
+/// </summary>
+/// <param name="particles">The particles.</param>
+template<typename T>
+void Kernels<T>::ClearForces(ParticleStorage<T>& particles) {
+	std::fill(particles.forceX.begin(), particles.forceX.end(), T(0));
+	std::fill(particles.forceY.begin(), particles.forceY.end(), T(0));
+}
+
+/// <summary>
+/// Keeps every movable particle inside the world, reflecting off the walls or wrapping around them.
+/// Integrators that don't fuse the walls into their own pass run this after each step.
+/// </summary>
+/// <param name="particles">The particles.</param>
+/// <param name="world">The walls of the world, or its unit cell if it is periodic.</param>
+/// <param name="boundary">Whether the walls reflect or wrap.</param>
+/// <param name="bounciness">The fraction of speed kept when bouncing off a wall.</param>
+template<typename T>
+void Kernels<T>::Confine(ParticleStorage<T>& particles, const Bounds& world, BoundaryMode boundary, T bounciness) {
+	T minX = (T)world.min.x, minY = (T)world.min.y;
+	T maxX = (T)world.max.x, maxY = (T)world.max.y;
+	T width = maxX - minX, height = maxY - minY;
+
+	ParallelFor(particles.getCount(), KERNEL_GRAIN, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			if (particles.inverseMass[i] == T(0)) continue;
+			T& x = particles.positionX[i];
+			T& y = particles.positionY[i];
+			if (boundary == PERIODIC) {
+				x -= width * std::floor((x - minX) / width);
+				y -= height * std::floor((y - minY) / height);
+				continue;
+			}
+			T r = particles.radius[i];
+			if (x < minX + r) { x = minX + r; particles.velocityX[i] *= -bounciness; }
+			else if (x > maxX - r) { x = maxX - r; particles.velocityX[i] *= -bounciness; }
+			if (y < minY + r) { y = minY + r; particles.velocityY[i] *= -bounciness; }
+			else if (y > maxY - r) { y = maxY - r; particles.velocityY[i] *= -bounciness; }
+		}
+	});
+}
+
+/// <summary>
+/// Kick over [begin, end). Specialised with SIMD for float and double.
+/// </summary>
+template<typename T>
+void Kernels<T>::KickRange(ParticleStorage<T>& particles, size_t begin, size_t end, T timestep, T gravityX, T gravityY) {
+	KickScalar(particles, begin, end, timestep, gravityX, gravityY);
+}
+
+/// <summary>
+/// Drift over [begin, end). Specialised with SIMD for float and double.
+/// </summary>
+template<typename T>
+void Kernels<T>::DriftRange(ParticleStorage<T>& particles, size_t begin, size_t end, T timestep) {
+	DriftScalar(particles, begin, end, timestep);
+}
+
+/// <summary>
+/// Scalar kick over [begin, end), also used for the tails of the SIMD kernels. Particles with no inverse mass are immovable and skipped.
+/// </summary>
+template<typename T>
+void Kernels<T>::KickScalar(ParticleStorage<T>& particles, size_t begin, size_t end, T timestep, T gravityX, T gravityY) {
+	for (size_t i = begin; i < end; i++) {
+		T inverseMass = particles.inverseMass[i];
+		if (inverseMass == T(0)) continue;
+		particles.velocityX[i] += (particles.forceX[i] * inverseMass + gravityX) * timestep;
+		particles.velocityY[i] += (particles.forceY[i] * inverseMass + gravityY) * timestep;
+	}
+}
+
+/// <summary>
+/// Scalar drift over [begin, end), also used for the tails of the SIMD kernels.
+/// </summary>
+template<typename T>
+void Kernels<T>::DriftScalar(ParticleStorage<T>& particles, size_t begin, size_t end, T timestep) {
+	for (size_t i = begin; i < end; i++) {
+		particles.positionX[i] += particles.velocityX[i] * timestep;
+		particles.positionY[i] += particles.velocityY[i] * timestep;
+	}
+}
+
+template<> void Kernels<float>::KickRange(ParticleStorage<float>& particles, size_t begin, size_t end, float timestep, float gravityX, float gravityY);
+template<> void Kernels<float>::DriftRange(ParticleStorage<float>& particles, size_t begin, size_t end, float timestep);
+template<> void Kernels<double>::KickRange(ParticleStorage<double>& particles, size_t begin, size_t end, double timestep, double gravityX, double gravityY);
+template<> void Kernels<double>::DriftRange(ParticleStorage<double>& particles, size_t begin, size_t end, double timestep);
+
+#endif
@@ -0,0 +1,265 @@
+/*
+Verlet neighbour lists for short-range soft-sphere and Lennard-Jones forces.
+The pair search runs on a uniform grid only when the list goes stale, and the
+force pass walks the cached lists in parallel.
+*/
+
+#include "NeighbourList.h"
+#include "../Parallel.h"
+
+// The Lennard-Jones potential is cut off at 2.5 sigma, where sigma puts the minimum at contact.
+const float LJ_SIGMA_PER_CONTACT = 0.890899f;
+const float LJ_CUTOFF_PER_CONTACT = 2.5f * LJ_SIGMA_PER_CONTACT;
+
+/// <summary>
+/// Neighbour List Constructor.
+/// </summary>
+/// <param name="skin">The extra distance beyond the cutoff kept in each list.</param>
+/// <param name="forceType">The short-range force between neighbours.</param>
+/// <param name="stiffness">The strength of the force.</param>
+/// <param name="damping">The damping along the contact normal.</param>
+NeighbourList::NeighbourList(float skin, ShortRangeForce forceType, float stiffness, float damping) : grid(1.0f) {
+    this->skin = skin;
+    this->forceType = forceType;
+    this->stiffness = stiffness;
+    this->damping = damping;
+}
+
+/// <summary>
+/// Returns the interaction cutoff of a pair of circles.
+/// </summary>
+/// <param name="sumRadius">The sum of both radii.</param>
+/// <returns>The distance beyond which the pair doesn't interact.</returns>
+float NeighbourList::getCutoff(float sumRadius) {
+    return forceType == LENNARD_JONES ? sumRadius * LJ_CUTOFF_PER_CONTACT : sumRadius;
+}
+
+/// <summary>
+/// Checks whether the cached lists are still valid for the current positions.
+/// </summary>
+/// <param name="entities">The list of live entities.</param>
+/// <returns>Why a rebuild is needed, or REBUILD_NONE.</returns>
+RebuildReason NeighbourList::NeedsRebuild(const std::vector<Entity*>& entities) {
+    // Any spawn or removal changes the set of circles.
+    size_t index = 0;
+    for (size_t i = 0; i < entities.size(); i++) {
+        if (entities[i]->type != CIRCLE || !entities[i]->isAlive()) continue;
+        if (index >= bodies.size() || bodies[index] != entities[i]) return REBUILD_TOPOLOGY;
+        index++;
+    }
+    if (index != bodies.size()) return REBUILD_TOPOLOGY;
+
+    // The list holds every pair within cutoff + skin, so it stays exact until some circle moves half the skin.
+    float maxSqr = 0.0f;
+    for (size_t i = 0; i < bodies.size(); i++) {
+        float dx = bodies[i]->position.x - buildX[i];
+        float dy = bodies[i]->position.y - buildY[i];
+        grid.MinimumImage(dx, dy);
+        float distSqr = dx * dx + dy * dy;
+        if (distSqr > maxSqr) maxSqr = distSqr;
+    }
+    maxDisplacement = sqrtf(maxSqr);
+
+    if (maxDisplacement > skin * 0.5f) return REBUILD_DISPLACEMENT;
+    return REBUILD_NONE;
+}
+
+/// <summary>
+/// Rebuilds every circle's neighbour list using a grid whose cells span the largest cutoff plus the skin.
+/// </summary>
+/// <param name="entities">The list of live entities.</param>
+void NeighbourList::Rebuild(const std::vector<Entity*>& entities) {
+    bodies.clear();
+    for (size_t i = 0; i < entities.size(); i++) {
+        if (entities[i]->type == CIRCLE && entities[i]->isAlive())
+            bodies.push_back(entities[i]);
+    }
+
+    size_t count = bodies.size();
+    radius.resize(count);
+    buildX.resize(count);
+    buildY.resize(count);
+
+    float maxRadius = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        radius[i] = ((EntityCircle*)bodies[i])->getRadius();
+        buildX[i] = bodies[i]->position.x;
+        buildY[i] = bodies[i]->position.y;
+        if (radius[i] > maxRadius) maxRadius = radius[i];
+    }
+
+    grid.setCellSize(getCutoff(maxRadius * 2.0f) + skin);
+    grid.Build(buildX, buildY);
+
+    // Two passes over the grid: count every circle's neighbours, then fill them in.
+    neighbourStart.assign(count + 1, 0);
+    for (int pass = 0; pass < 2; pass++) {
+        ParallelFor(count, 1024, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                int cellX = grid.getCellX(buildX[i]);
+                int cellY = grid.getCellY(buildY[i]);
+                unsigned int found = 0;
+                unsigned int* out = pass == 1 ? &neighbours[neighbourStart[i]] : nullptr;
+
+                int minX, maxX, minY, maxY;
+                grid.getStencil(cellX, cellY, minX, maxX, minY, maxY);
+                for (int y = minY; y <= maxY; y++) {
+                    for (int x = minX; x <= maxX; x++) {
+                        unsigned int cell;
+                        if (!grid.getNeighbourCell(x, y, cell)) continue;
+                        for (unsigned int k = grid.cellStart[cell]; k < grid.cellStart[cell + 1]; k++) {
+                            unsigned int j = grid.cellEntries[k];
+                            if (j == i) continue;
+                            float dx = buildX[j] - buildX[i];
+                            float dy = buildY[j] - buildY[i];
+                            grid.MinimumImage(dx, dy);
+                            float reach = getCutoff(radius[i] + radius[j]) + skin;
+                            if (dx * dx + dy * dy > reach * reach) continue;
+                            if (out) out[found] = j;
+                            found++;
+                        }
+                    }
+                }
+                if (pass == 0) neighbourStart[i + 1] = found;
+            }
+        });
+
+        if (pass == 0) {
+            for (size_t i = 0; i < count; i++) {
+                neighbourStart[i + 1] += neighbourStart[i];
+            }
+            neighbours.resize(neighbourStart[count]);
+        }
+    }
+
+    rebuildCount++;
+    ticksSinceRebuild = 0;
+    maxDisplacement = 0.0f;
+}
+
+/// <summary>
+/// Adds the short-range force between every pair of neighbouring circles, rebuilding the lists if they are stale.
+/// </summary>
+/// <param name="entities">The list of live entities.</param>
+void NeighbourList::ApplyForces(const std::vector<Entity*>& entities) {
+    RebuildReason reason = NeedsRebuild(entities);
+    if (reason != REBUILD_NONE) {
+        lastRebuildReason = reason;
+        Rebuild(entities);
+    }
+    else {
+        ticksSinceRebuild++;
+    }
+
+    ParallelFor(bodies.size(), 1024, [this](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            Entity* self = bodies[i];
+            if (self->isKinematic()) continue;
+            Vector2 total(0.0f, 0.0f);
+
+            for (unsigned int k = neighbourStart[i]; k < neighbourStart[i + 1]; k++) {
+                unsigned int j = neighbours[k];
+                Entity* other = bodies[j];
+                Vector2 difference = self->position - other->position;
+                grid.MinimumImage(difference.x, difference.y);
+                float distSqr = difference.MagnitudeSqr();
+                float contact = radius[i] + radius[j];
+                float cutoff = getCutoff(contact);
+                if (distSqr >= cutoff * cutoff || distSqr <= 0.0f) continue;
+
+                float distance = sqrtf(distSqr);
+                Vector2 normal = difference / distance;
+                float reducedMass = (self->mass * other->mass) / (self->mass + other->mass);
+                float magnitude = 0.0f;
+
+                if (forceType == SOFT_SPHERE) {
+                    // Linear spring on the overlap.
+                    magnitude = stiffness * (contact - distance);
+                }
+                else {
+                    // Lennard-Jones, with the separation clamped so overlapping circles don't explode.
+                    float sigma = contact * LJ_SIGMA_PER_CONTACT;
+                    float r = fmaxf(distance, sigma * 0.8f);
+                    float s2 = (sigma * sigma) / (r * r);
+                    float s6 = s2 * s2 * s2;
+                    magnitude = stiffness * sigma * (2.0f * s6 * s6 - s6) / r;
+                }
+
+                // Damps the approach speed along the normal.
+                float approach = (self->velocity - other->velocity).DotProduct(normal);
+                magnitude -= damping * approach;
+
+                total += normal * (magnitude * reducedMass);
+            }
+
+            self->force = self->force + total;
+        }
+    });
+}
+
+/// <summary>
+/// Sets whether pairs interact across the edges of the world. Forces a rebuild.
+/// </summary>
+/// <param name="boundary">The boundary mode.</param>
+/// <param name="world">The periodic unit cell.</param>
+void NeighbourList::setBoundary(BoundaryMode boundary, const Bounds& world) {
+    grid.setPeriodic(boundary == PERIODIC, world);
+    this->bodies.clear();
+}
+
+/// <summary>
+/// Returns the skin distance.
+/// </summary>
+/// <returns>The skin distance.</returns>
+float NeighbourList::getSkin() {
+    return this->skin;
+}
+
+/// <summary>
+/// Sets the skin distance. A larger skin rebuilds less often but walks more pairs per tick.
+/// </summary>
+/// <param name="skin">The skin distance.</param>
+void NeighbourList::setSkin(float skin) {
+    this->skin = skin;
+    this->bodies.clear();
+}
+
+/// <summary>
+/// Returns the number of times the lists have been rebuilt.
+/// </summary>
+/// <returns>The rebuild count.</returns>
+unsigned int NeighbourList::getRebuildCount() {
+    return this->rebuildCount;
+}
+
+/// <summary>
+/// Returns the number of ticks the current lists have been reused.
+/// </summary>
+/// <returns>The ticks since the last rebuild.</returns>
+unsigned int NeighbourList::getTicksSinceRebuild() {
+    return this->ticksSinceRebuild;
+}
+
+/// <summary>
+/// Returns the largest distance any circle has moved since the last rebuild. A rebuild triggers past half the skin.
+/// </summary>
+/// <returns>The maximum displacement.</returns>
+float NeighbourList::getMaxDisplacement() {
+    return this->maxDisplacement;
+}
+
+/// <summary>
+/// Returns what triggered the last rebuild.
+/// </summary>
+/// <returns>The rebuild reason.</returns>
+RebuildReason NeighbourList::getLastRebuildReason() {
+    return this->lastRebuildReason;
+}
+
+/// <summary>
+/// Returns the number of entries in the lists. Every pair is stored once per circle.
+/// </summary>
+/// <returns>The number of list entries.</returns>
+size_t NeighbourList::getPairCount() {
+    return this->neighbours.size();
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#ifndef NEIGHBOURLIST_H
+#define NEIGHBOURLIST_H
+
+#include "../Entities/Entity.h"
+#include "SpatialGrid.h"
+
+// The short-range force applied between neighbouring circles.
+enum ShortRangeForce {
+	SOFT_SPHERE,
+	LENNARD_JONES
+};
+
+// Why the neighbour list was last rebuilt.
+enum RebuildReason {
+	REBUILD_NONE,
+	REBUILD_DISPLACEMENT,
+	REBUILD_TOPOLOGY
+};
+
+// A Verlet neighbour list. Every circle keeps the circles within its cutoff plus a skin,
+// and the list is only rebuilt once some circle has moved more than half the skin.
+class NeighbourList
+{
+public:
+	NeighbourList(float skin, ShortRangeForce forceType, float stiffness, float damping);
+	void ApplyForces(const std::vector<Entity*>& entities);
+	void setBoundary(BoundaryMode boundary, const Bounds& world);
+	float getSkin();
+	void setSkin(float skin);
+	unsigned int getRebuildCount();
+	unsigned int getTicksSinceRebuild();
+	float getMaxDisplacement();
+	RebuildReason getLastRebuildReason();
+	size_t getPairCount();
+private:
+	RebuildReason NeedsRebuild(const std::vector<Entity*>& entities);
+	void Rebuild(const std::vector<Entity*>& entities);
+	float getCutoff(float sumRadius);
+	float skin;
+	ShortRangeForce forceType;
+	float stiffness;
+	float damping;
+
+	// Circles and their positions at the last rebuild.
+	std::vector<Entity*> bodies;
+	std::vector<float> radius;
+	std::vector<float> buildX;
+	std::vector<float> buildY;
+
+	// Full neighbour list in compressed rows, so each circle only ever writes its own force.
+	std::vector<unsigned int> neighbourStart;
+	std::vector<unsigned int> neighbours;
+	SpatialGrid grid;
+
+	// Metrics
+	unsigned int rebuildCount = 0;
+	unsigned int ticksSinceRebuild = 0;
+	float maxDisplacement = 0.0f;
+	RebuildReason lastRebuildReason = REBUILD_NONE;
+};
+
+#endif
@@ -0,0 +1,239 @@
+#include "SpatialGrid.h"
+#include "../Parallel.h"
+#include <math.h>
+
+// Caps the number of cells per point so far-flung points can't blow up the grid.
+const unsigned int MAX_CELLS_PER_POINT = 4;
+
+/// <summary>
+/// Spatial Grid Constructor.
+/// </summary>
+/// <param name="cellSize">The minimum width of a cell, normally the interaction cutoff.</param>
+SpatialGrid::SpatialGrid(float cellSize) {
+	this->cellSize = cellSize;
+	this->cellWidth = cellSize;
+	this->cellHeight = cellSize;
+}
+
+/// <summary>
+/// Sorts the points into cells. Cells grow beyond the requested size when the points are too sparse.
+/// </summary>
+/// <param name="x">The X coordinate of every point.</param>
+/// <param name="y">The Y coordinate of every point.</param>
+void SpatialGrid::Build(const std::vector<float>& x, const std::vector<float>& y) {
+	size_t count = x.size();
+	pointCell.resize(count);
+	cellEntries.resize(count);
+
+	if (count == 0) {
+		width = height = 0;
+		cellStart.assign(1, 0);
+		return;
+	}
+
+	float minX = x[0], maxX = x[0], minY = y[0], maxY = y[0];
+	for (size_t i = 1; i < count; i++) {
+		if (x[i] < minX) minX = x[i];
+		if (x[i] > maxX) maxX = x[i];
+		if (y[i] < minY) minY = y[i];
+		if (y[i] > maxY) maxY = y[i];
+	}
+
+	// A periodic grid always covers its whole domain.
+	if (periodic) {
+		minX = domain.min.x;
+		minY = domain.min.y;
+		maxX = domain.max.x;
+		maxY = domain.max.y;
+	}
+
+	// Grow the cells until the grid fits the cell budget.
+	float spanX = maxX - minX;
+	float spanY = maxY - minY;
+	double maxCells = (double)count * MAX_CELLS_PER_POINT + 64.0;
+	float size = cellSize;
+	if ((spanX / size + 1.0) * (spanY / size + 1.0) > maxCells) {
+		size = (float)sqrt((double)(spanX + cellSize) * (spanY + cellSize) / maxCells);
+		if (size < cellSize) size = cellSize;
+	}
+
+	originX = minX;
+	originY = minY;
+	if (periodic) {
+		// Stretch the cells slightly so a whole number of them tiles the domain.
+		width = (int)(spanX / size);
+		height = (int)(spanY / size);
+		if (width < 1) width = 1;
+		if (height < 1) height = 1;
+		cellWidth = spanX / width;
+		cellHeight = spanY / height;
+	}
+	else {
+		width = (int)(spanX / size) + 1;
+		height = (int)(spanY / size) + 1;
+		cellWidth = cellHeight = size;
+	}
+
+	auto assign = [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			pointCell[i] = getCellIndex(getCellX(x[i]), getCellY(y[i]));
+		}
+	};
+	if (serial) assign(0, count);
+	else ParallelFor(count, 4096, assign);
+
+	// Counting sort of the points by cell.
+	cellStart.assign((size_t)width * height + 1, 0);
+	for (size_t i = 0; i < count; i++) {
+		cellStart[pointCell[i] + 1]++;
+	}
+	for (size_t c = 1; c < cellStart.size(); c++) {
+		cellStart[c] += cellStart[c - 1];
+	}
+	std::vector<unsigned int> cursor(cellStart.begin(), cellStart.end() - 1);
+	for (size_t i = 0; i < count; i++) {
+		cellEntries[cursor[pointCell[i]]++] = (unsigned int)i;
+	}
+}
+
+/// <summary>
+/// Returns the column of the cell containing an X coordinate, clamped to the grid, or wrapped if it is periodic.
+/// </summary>
+int SpatialGrid::getCellX(float x) const {
+	int cell = (int)floorf((x - originX) / cellWidth);
+	if (periodic) return ((cell % width) + width) % width;
+	if (cell < 0) return 0;
+	if (cell >= width) return width - 1;
+	return cell;
+}
+
+/// <summary>
+/// Returns the row of the cell containing a Y coordinate, clamped to the grid, or wrapped if it is periodic.
+/// </summary>
+int SpatialGrid::getCellY(float y) const {
+	int cell = (int)floorf((y - originY) / cellHeight);
+	if (periodic) return ((cell % height) + height) % height;
+	if (cell < 0) return 0;
+	if (cell >= height) return height - 1;
+	return cell;
+}
+
+/// <summary>
+/// Returns the flat index of a cell.
+/// </summary>
+unsigned int SpatialGrid::getCellIndex(int cellX, int cellY) const {
+	return (unsigned int)(cellY * width + cellX);
+}
+
+/// <summary>
+/// Returns the number of cells in the grid.
+/// </summary>
+unsigned int SpatialGrid::getCellCount() const {
+	return (unsigned int)(width * height);
+}
+
+/// <summary>
+/// Returns the number of columns in the grid.
+/// </summary>
+int SpatialGrid::getWidth() const {
+	return width;
+}
+
+/// <summary>
+/// Returns the number of rows in the grid.
+/// </summary>
+int SpatialGrid::getHeight() const {
+	return height;
+}
+
+/// <summary>
+/// Returns the width of the narrowest cells in the last build. Never smaller than the requested size,
+/// except in a periodic grid whose domain is narrower than a single cell.
+/// </summary>
+float SpatialGrid::getCellSize() const {
+	return fminf(cellWidth, cellHeight);
+}
+
+/// <summary>
+/// Sets the minimum width of a cell used by the next build.
+/// </summary>
+void SpatialGrid::setCellSize(float cellSize) {
+	this->cellSize = cellSize;
+}
+
+/// <summary>
+/// Makes the grid wrap around a domain, or go back to fitting its points. Positions must lie inside the domain.
+/// </summary>
+/// <param name="periodic">Whether the grid wraps.</param>
+/// <param name="domain">The unit cell of the periodic world.</param>
+void SpatialGrid::setPeriodic(bool periodic, const Bounds& domain) {
+	this->periodic = periodic;
+	this->domain = domain;
+}
+
+/// <summary>
+/// Makes the grid build on the calling thread alone, or spread its build over the thread pool.
+/// </summary>
+/// <param name="serial">Whether the build stays on the calling thread.</param>
+void SpatialGrid::setSerial(bool serial) {
+	this->serial = serial;
+}
+
+/// <summary>
+/// Returns whether the grid wraps around its domain.
+/// </summary>
+bool SpatialGrid::isPeriodic() const {
+	return this->periodic;
+}
+
+/// <summary>
+/// Returns the block of cells around a cell that may hold its neighbours. The block can run past the edges;
+/// pass each cell through getNeighbourCell. A periodic grid under three cells across is narrowed so no
+/// cell is visited twice.
+/// </summary>
+/// <param name="cellX">The column of the centre cell.</param>
+/// <param name="cellY">The row of the centre cell.</param>
+void SpatialGrid::getStencil(int cellX, int cellY, int& minX, int& maxX, int& minY, int& maxY) const {
+	minX = cellX - 1;
+	maxX = cellX + 1;
+	minY = cellY - 1;
+	maxY = cellY + 1;
+	if (periodic && width < 3) {
+		minX = cellX;
+		maxX = cellX + width - 1;
+	}
+	if (periodic && height < 3) {
+		minY = cellY;
+		maxY = cellY + height - 1;
+	}
+}
+
+/// <summary>
+/// Resolves a cell of a stencil. Past the edge of a periodic grid this is the ghost of the cell on the opposite edge.
+/// </summary>
+/// <param name="cellX">The column, which may be outside the grid.</param>
+/// <param name="cellY">The row, which may be outside the grid.</param>
+/// <param name="cell">The flat index of the real cell.</param>
+/// <returns>False if the cell is outside a grid that doesn't wrap.</returns>
+bool SpatialGrid::getNeighbourCell(int cellX, int cellY, unsigned int& cell) const {
+	if (periodic) {
+		cellX = ((cellX % width) + width) % width;
+		cellY = ((cellY % height) + height) % height;
+	}
+	else if (cellX < 0 || cellX >= width || cellY < 0 || cellY >= height) {
+		return false;
+	}
+	cell = getCellIndex(cellX, cellY);
+	return true;
+}
+
+/// <summary>
+/// Replaces a separation with the one to the nearest periodic image. Does nothing if the grid doesn't wrap.
+/// </summary>
+void SpatialGrid::MinimumImage(float& dx, float& dy) const {
+	if (!periodic) return;
+	float spanX = domain.getWidth();
+	float spanY = domain.getHeight();
+	dx -= spanX * roundf(dx / spanX);
+	dy -= spanY * roundf(dy / spanY);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include "../Bounds.h"
+#include <vector>
+
+// A uniform grid of square cells over a set of points, stored as a counting sort.
+// The points of cell c are cellEntries[cellStart[c] .. cellStart[c + 1]).
+// A periodic grid tiles its domain exactly, and the cells past each edge are ghosts
+// of the cells on the opposite edge rather than copies of their points.
+class SpatialGrid
+{
+public:
+	SpatialGrid(float cellSize);
+	void Build(const std::vector<float>& x, const std::vector<float>& y);
+	int getCellX(float x) const;
+	int getCellY(float y) const;
+	unsigned int getCellIndex(int cellX, int cellY) const;
+	unsigned int getCellCount() const;
+	int getWidth() const;
+	int getHeight() const;
+	float getCellSize() const;
+	void setCellSize(float cellSize);
+	void setPeriodic(bool periodic, const Bounds& domain);
+	bool isPeriodic() const;
+	void setSerial(bool serial);
+	void getStencil(int cellX, int cellY, int& minX, int& maxX, int& minY, int& maxY) const;
+	bool getNeighbourCell(int cellX, int cellY, unsigned int& cell) const;
+	void MinimumImage(float& dx, float& dy) const;
+	std::vector<unsigned int> cellStart;
+	std::vector<unsigned int> cellEntries;
+	std::vector<unsigned int> pointCell;
+private:
+	float cellSize;
+	float cellWidth;
+	float cellHeight;
+	bool periodic = false;
+	bool serial = false;
+	Bounds domain;
+	float originX = 0.0f;
+	float originY = 0.0f;
+	int width = 0;
+	int height = 0;
+};
+
+#endif
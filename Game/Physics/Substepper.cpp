@@ -0,0 +1,119 @@
+/*
+Adaptive substepping. Before each tick the fastest entity and the smallest one
+set how many substeps the tick needs, so calm scenes take a single step and
+only fast impacts pay for more.
+*/
+
+#include "Substepper.h"
+#include <cmath>
+
+/// <summary>
+/// Substepper Constructor.
+/// </summary>
+/// <param name="courant">The furthest an entity may move in one substep, as a fraction of the smallest radius.</param>
+/// <param name="maxSubsteps">The most substeps a tick is split into.</param>
+Substepper::Substepper(float courant, unsigned int maxSubsteps) {
+    this->courant = courant;
+    this->maxSubsteps = maxSubsteps > 0 ? maxSubsteps : 1;
+}
+
+/// <summary>
+/// Works out how many substeps the next tick needs. The speed of each entity includes the
+/// change its pending force will make, so a body about to be flung is already accounted for.
+/// </summary>
+/// <param name="entities">The entities about to be stepped.</param>
+/// <returns>The number of substeps, from 1 up to the maximum.</returns>
+unsigned int Substepper::Plan(const std::vector<Entity*>& entities) {
+    float maxSpeedSqr = 0.0f;
+    float smallest = INFINITY;
+
+    for (size_t i = 0; i < entities.size(); i++) {
+        Entity* entity = entities[i];
+        if (!entity->isAlive()) continue;
+
+        float radius = entity->type == CIRCLE
+            ? ((EntityCircle*)entity)->getRadius()
+            : std::fmin(((EntityBox*)entity)->getWidth(), ((EntityBox*)entity)->getLength()) * 0.5f;
+        smallest = std::fmin(smallest, radius);
+
+        if (entity->isKinematic()) continue;
+        // An entity on a slower rate moves 2^level ticks' worth in one of its steps.
+        Vector2 velocity = (entity->velocity + entity->force / entity->mass) * (float)(1u << entity->getRateLevel());
+        maxSpeedSqr = std::fmax(maxSpeedSqr, velocity.MagnitudeSqr());
+    }
+
+    maxSpeed = std::sqrt(maxSpeedSqr);
+    minRadius = smallest == INFINITY ? 0.0f : smallest;
+    substeps = 1;
+
+    if (minRadius > 0.0f) {
+        float steps = std::ceil(maxSpeed * TIMESTEP / (courant * minRadius));
+        if (steps > 1.0f) substeps = steps >= (float)maxSubsteps ? maxSubsteps : (unsigned int)steps;
+    }
+
+    if (substeps > peakSubsteps) peakSubsteps = substeps;
+    return substeps;
+}
+
+/// <summary>
+/// Returns the furthest an entity may move in one substep, as a fraction of the smallest radius.
+/// </summary>
+/// <returns>The Courant number.</returns>
+float Substepper::getCourant() {
+    return this->courant;
+}
+
+/// <summary>
+/// Sets the furthest an entity may move in one substep, as a fraction of the smallest radius.
+/// </summary>
+/// <param name="courant">The Courant number.</param>
+void Substepper::setCourant(float courant) {
+    this->courant = courant;
+}
+
+/// <summary>
+/// Returns the most substeps a tick is split into.
+/// </summary>
+/// <returns>The maximum number of substeps.</returns>
+unsigned int Substepper::getMaxSubsteps() {
+    return this->maxSubsteps;
+}
+
+/// <summary>
+/// Returns the number of substeps the last tick was split into.
+/// </summary>
+/// <returns>The number of substeps.</returns>
+unsigned int Substepper::getSubsteps() {
+    return this->substeps;
+}
+
+/// <summary>
+/// Returns the most substeps any tick took since the peak was last reset.
+/// </summary>
+/// <returns>The peak number of substeps.</returns>
+unsigned int Substepper::getPeakSubsteps() {
+    return this->peakSubsteps;
+}
+
+/// <summary>
+/// Starts a new window for the peak number of substeps.
+/// </summary>
+void Substepper::ResetPeak() {
+    this->peakSubsteps = this->substeps;
+}
+
+/// <summary>
+/// Returns the fastest speed seen when the last tick was planned.
+/// </summary>
+/// <returns>The maximum speed.</returns>
+float Substepper::getMaxSpeed() {
+    return this->maxSpeed;
+}
+
+/// <summary>
+/// Returns the smallest radius seen when the last tick was planned.
+/// </summary>
+/// <returns>The minimum radius.</returns>
+float Substepper::getMinRadius() {
+    return this->minRadius;
+}
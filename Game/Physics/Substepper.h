@@ -0,0 +1,34 @@
+#pragma once
+
+#ifndef SUBSTEPPER_H
+#define SUBSTEPPER_H
+
+#include "../Entities/Entity.h"
+
+// Picks how many substeps each tick is split into, from a CFL-like bound: no entity may move
+// further than a fraction of the smallest entity's radius in one substep.
+class Substepper
+{
+public:
+	Substepper(float courant, unsigned int maxSubsteps);
+	unsigned int Plan(const std::vector<Entity*>& entities);
+	float getCourant();
+	void setCourant(float courant);
+	unsigned int getMaxSubsteps();
+	unsigned int getSubsteps();
+	unsigned int getPeakSubsteps();
+	void ResetPeak();
+	float getMaxSpeed();
+	float getMinRadius();
+private:
+	float courant;
+	unsigned int maxSubsteps;
+
+	// Metrics
+	unsigned int substeps = 1;
+	unsigned int peakSubsteps = 1;
+	float maxSpeed = 0.0f;
+	float minRadius = 0.0f;
+};
+
+#endif
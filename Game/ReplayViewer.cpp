@@ -0,0 +1,179 @@
+/*
+Replay of a trajectory recording. Seeking goes through the reader's index,
+so the playhead can jump anywhere. Moving forward decodes one frame at a time,
+and anything else decodes forward from the keyframe before the target.
+*/
+
+#include "ReplayViewer.h"
+#include <math.h>
+
+/// <summary>
+/// Replay Viewer Constructor.
+/// </summary>
+/// <param name="maxSpeed">The fastest playback, in recorded ticks per tick, either way.</param>
+/// <param name="colorSpeed">The speed drawn fully red. Slower particles shade towards blue.</param>
+ReplayViewer::ReplayViewer(float maxSpeed, float colorSpeed) {
+    this->maxSpeed = maxSpeed;
+    this->colorSpeed = colorSpeed;
+}
+
+/// <summary>
+/// Maps a recording and puts the playhead on its first frame.
+/// </summary>
+/// <param name="path">The path of the recording.</param>
+/// <returns>Whether the recording could be played.</returns>
+bool ReplayViewer::Open(const std::string& path) {
+    if (!reader.Open(path)) {
+        error = reader.getError();
+        return false;
+    }
+    if (reader.getFrameCount() == 0) {
+        error = path + " has no frames";
+        reader.Close();
+        return false;
+    }
+    if (!reader.Seek(0)) {
+        error = reader.getError();
+        reader.Close();
+        return false;
+    }
+    this->tick = getFirstTick();
+    return true;
+}
+
+/// <summary>
+/// Moves the playhead on by the time since the last update at the playback speed. Playback pauses at either end.
+/// </summary>
+/// <param name="seconds">The real time since the last update.</param>
+void ReplayViewer::Update(double seconds) {
+    if (paused) return;
+    double next = this->tick + speed * seconds / TIMESTEP;
+    if (next <= getFirstTick() || next >= getLastTick()) paused = true;
+    Seek(next);
+}
+
+/// <summary>
+/// Draws the particles on screen at the playhead, coloured by speed.
+/// </summary>
+/// <param name="batch">The instance batch of the circle mesh.</param>
+/// <param name="view">The part of the world on screen.</param>
+void ReplayViewer::Render(InstanceBatch* batch, const Bounds& view) {
+    size_t frame = reader.FindFrame((uint64_t)floor(this->tick));
+    if (!reader.Seek(frame)) return;
+
+    // Particles are moved on from the frame by their velocity, so playback between frames stays smooth.
+    float offset = (float)(this->tick - (double)reader.getTick(frame)) * TIMESTEP;
+    const float* positionX = reader.getColumn(TRAJECTORY_POSITION_X);
+    const float* positionY = reader.getColumn(TRAJECTORY_POSITION_Y);
+    const float* velocityX = reader.getColumn(TRAJECTORY_VELOCITY_X);
+    const float* velocityY = reader.getColumn(TRAJECTORY_VELOCITY_Y);
+    const float* radius = reader.getColumn(TRAJECTORY_RADIUS);
+
+    float inverseColorSpeed = 1.0f / colorSpeed;
+    for (size_t i = 0; i < reader.getCount(); i++) {
+        Vector2 position(positionX[i] + velocityX[i] * offset, positionY[i] + velocityY[i] * offset);
+        if (!view.Overlaps(position, radius[i])) continue;
+
+        float heat = fminf(sqrtf(velocityX[i] * velocityX[i] + velocityY[i] * velocityY[i]) * inverseColorSpeed, 1.0f);
+        float color[3] = { heat, 0.2f, 1.0f - heat };
+        batch->Add(position, 1.0f, 0.0f, Vector2(radius[i], radius[i]), color);
+    }
+}
+
+/// <summary>
+/// Moves the playhead to a tick, clamped to the recording.
+/// </summary>
+/// <param name="tick">The tick.</param>
+void ReplayViewer::Seek(double tick) {
+    this->tick = fmin(fmax(tick, getFirstTick()), getLastTick());
+}
+
+/// <summary>
+/// Pauses and moves the playhead a number of recorded frames on or back.
+/// </summary>
+/// <param name="frames">The frames to move by. Negative steps back.</param>
+void ReplayViewer::Step(int frames) {
+    paused = true;
+    long long frame = (long long)reader.FindFrame((uint64_t)floor(this->tick)) + frames;
+    if (frame < 0) frame = 0;
+    if (frame >= (long long)reader.getFrameCount()) frame = (long long)reader.getFrameCount() - 1;
+    this->tick = (double)reader.getTick((size_t)frame);
+}
+
+/// <summary>
+/// Pauses or resumes playback.
+/// </summary>
+void ReplayViewer::setPaused(bool paused) {
+    this->paused = paused;
+}
+
+/// <summary>
+/// Returns whether playback is paused.
+/// </summary>
+bool ReplayViewer::isPaused() {
+    return this->paused;
+}
+
+/// <summary>
+/// Sets the playback speed in recorded ticks per tick. Negative plays backwards.
+/// </summary>
+/// <param name="speed">The speed, clamped to the fastest playback.</param>
+void ReplayViewer::setSpeed(double speed) {
+    this->speed = fmin(fmax(speed, -maxSpeed), maxSpeed);
+}
+
+/// <summary>
+/// Returns the playback speed.
+/// </summary>
+double ReplayViewer::getSpeed() {
+    return this->speed;
+}
+
+/// <summary>
+/// Returns the playhead.
+/// </summary>
+double ReplayViewer::getTick() {
+    return this->tick;
+}
+
+/// <summary>
+/// Returns the tick of the first recorded frame.
+/// </summary>
+double ReplayViewer::getFirstTick() {
+    return (double)reader.getTick(0);
+}
+
+/// <summary>
+/// Returns the tick of the last recorded frame.
+/// </summary>
+double ReplayViewer::getLastTick() {
+    return (double)reader.getTick(reader.getFrameCount() - 1);
+}
+
+/// <summary>
+/// Returns the number of particles in the frame on screen.
+/// </summary>
+size_t ReplayViewer::getCount() {
+    return reader.getCount();
+}
+
+/// <summary>
+/// Returns the number of recorded frames.
+/// </summary>
+size_t ReplayViewer::getFrameCount() {
+    return reader.getFrameCount();
+}
+
+/// <summary>
+/// Returns the world the recording was made in.
+/// </summary>
+Bounds ReplayViewer::getWorld() {
+    return reader.getWorld();
+}
+
+/// <summary>
+/// Returns why the recording could not be played.
+/// </summary>
+const std::string& ReplayViewer::getError() {
+    return this->error;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#ifndef REPLAYVIEWER_H
+#define REPLAYVIEWER_H
+
+#include "IO/Trajectory.h"
+#include "InstanceBatch.h"
+#include "Bounds.h"
+
+// Plays a trajectory recording back through the instanced renderer, with no physics.
+// The playhead is a tick that moves at any speed in either direction, and each frame
+// draws the recorded frame at or before it, moved on by its velocities to the playhead.
+class ReplayViewer
+{
+public:
+	ReplayViewer(float maxSpeed, float colorSpeed);
+	bool Open(const std::string& path);
+	void Update(double seconds);
+	void Render(InstanceBatch* batch, const Bounds& view);
+	void Seek(double tick);
+	void Step(int frames);
+	void setPaused(bool paused);
+	bool isPaused();
+	void setSpeed(double speed);
+	double getSpeed();
+	double getTick();
+	double getFirstTick();
+	double getLastTick();
+	size_t getCount();
+	size_t getFrameCount();
+	Bounds getWorld();
+	const std::string& getError();
+private:
+	TrajectoryReader reader;
+	std::string error;
+	float maxSpeed;
+	float colorSpeed;
+	double tick = 0.0;
+	double speed = 1.0;
+	bool paused = false;
+};
+
+#endif
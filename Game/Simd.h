@@ -0,0 +1,20 @@
+#pragma once
+
+#ifndef SIMD_H
+#define SIMD_H
+
+// The instruction sets the SIMD kernels may use, detected from the compiler's target.
+// Every kernel keeps a scalar path for targets without them.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#endif
+
+// The project builds with /arch:AVX2, which defines __AVX2__.
+#if defined(__AVX2__)
+#define SIMD_AVX2
+#include <immintrin.h>
+#endif
+
+#endif
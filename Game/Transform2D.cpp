@@ -0,0 +1,58 @@
+/*
+Batch transform writer for instanced rendering. Four transforms are built at
+once in SSE registers, transposed into per-instance order and streamed out.
+*/
+
+#include "Transform2D.h"
+#include "Simd.h"
+
+/// <summary>
+/// Writes the TRS transforms of a batch of instances. The linear parts go to basis as (a, b, c, d)
+/// per instance, and the translations to offset as (tx, ty) per instance.
+/// </summary>
+/// <param name="count">The number of instances.</param>
+/// <param name="x">The X position of every instance.</param>
+/// <param name="y">The Y position of every instance.</param>
+/// <param name="cos">The cosine of every instance's rotation.</param>
+/// <param name="sin">The sine of every instance's rotation.</param>
+/// <param name="scaleX">The X scale of every instance.</param>
+/// <param name="scaleY">The Y scale of every instance.</param>
+/// <param name="basis">Receives 4 floats per instance.</param>
+/// <param name="offset">Receives 2 floats per instance.</param>
+void Transform2D::WriteBatch(size_t count, const float* x, const float* y, const float* cos, const float* sin,
+	const float* scaleX, const float* scaleY, float* basis, float* offset) {
+	size_t i = 0;
+#ifdef SIMD_SSE2
+	for (; i + 4 <= count; i += 4) {
+		__m128 c = _mm_loadu_ps(cos + i);
+		__m128 s = _mm_loadu_ps(sin + i);
+		__m128 sx = _mm_loadu_ps(scaleX + i);
+		__m128 sy = _mm_loadu_ps(scaleY + i);
+
+		__m128 ma = _mm_mul_ps(sx, c);
+		__m128 mb = _mm_mul_ps(sx, s);
+		__m128 mc = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(sy, s));
+		__m128 md = _mm_mul_ps(sy, c);
+
+		// Rows of a, b, c and d become one (a, b, c, d) row per instance.
+		_MM_TRANSPOSE4_PS(ma, mb, mc, md);
+		_mm_storeu_ps(basis + i * 4, ma);
+		_mm_storeu_ps(basis + i * 4 + 4, mb);
+		_mm_storeu_ps(basis + i * 4 + 8, mc);
+		_mm_storeu_ps(basis + i * 4 + 12, md);
+
+		__m128 px = _mm_loadu_ps(x + i);
+		__m128 py = _mm_loadu_ps(y + i);
+		_mm_storeu_ps(offset + i * 2, _mm_unpacklo_ps(px, py));
+		_mm_storeu_ps(offset + i * 2 + 4, _mm_unpackhi_ps(px, py));
+	}
+#endif
+	for (; i < count; i++) {
+		basis[i * 4] = scaleX[i] * cos[i];
+		basis[i * 4 + 1] = scaleX[i] * sin[i];
+		basis[i * 4 + 2] = -scaleY[i] * sin[i];
+		basis[i * 4 + 3] = scaleY[i] * cos[i];
+		offset[i * 2] = x[i];
+		offset[i * 2 + 1] = y[i];
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#ifndef TRANSFORM2D_H
+#define TRANSFORM2D_H
+
+#include "Vector2.h"
+#include <stddef.h>
+
+/*
+A 2D affine transform: a 2x2 linear part stored by columns (a, b) and (c, d), and a
+translation. Maps a point p to (a * p.x + c * p.y + tx, b * p.x + d * p.y + ty).
+Six floats instead of sixteen, and composing two is 12 multiplies instead of 64.
+*/
+class Transform2D
+{
+public:
+	constexpr Transform2D() noexcept : a(1), b(0), c(0), d(1), tx(0), ty(0) {}
+	constexpr Transform2D(float a, float b, float c, float d, float tx, float ty) noexcept : a(a), b(b), c(c), d(d), tx(tx), ty(ty) {}
+	float a;
+	float b;
+	float c;
+	float d;
+	float tx;
+	float ty;
+
+	static constexpr Transform2D Translation(const Vector2& translation) noexcept { return Transform2D(1, 0, 0, 1, translation.x, translation.y); }
+	static constexpr Transform2D Scale(const Vector2& scale) noexcept { return Transform2D(scale.x, 0, 0, scale.y, 0, 0); }
+	static constexpr Transform2D Rotation(float cos, float sin) noexcept { return Transform2D(cos, sin, -sin, cos, 0, 0); }
+
+	/// <summary>
+	/// Scales along the local axes, then rotates, then translates, in a single step,
+	/// so a scaled box stays a rectangle at any rotation.
+	/// </summary>
+	/// <param name="translation">The position.</param>
+	/// <param name="cos">The cosine of the rotation.</param>
+	/// <param name="sin">The sine of the rotation.</param>
+	/// <param name="scale">The scale.</param>
+	static constexpr Transform2D TRS(const Vector2& translation, float cos, float sin, const Vector2& scale) noexcept {
+		return Transform2D(scale.x * cos, scale.x * sin, -scale.y * sin, scale.y * cos, translation.x, translation.y);
+	}
+
+	/// <summary>
+	/// Composes two transforms. The result applies obj first, then this.
+	/// </summary>
+	constexpr Transform2D operator* (Transform2D const& obj) const noexcept {
+		return Transform2D(
+			a * obj.a + c * obj.b,
+			b * obj.a + d * obj.b,
+			a * obj.c + c * obj.d,
+			b * obj.c + d * obj.d,
+			a * obj.tx + c * obj.ty + tx,
+			b * obj.tx + d * obj.ty + ty);
+	}
+
+	constexpr Vector2 TransformPoint(const Vector2& point) const noexcept { return Vector2(a * point.x + c * point.y + tx, b * point.x + d * point.y + ty); }
+	constexpr Vector2 TransformVector(const Vector2& vector) const noexcept { return Vector2(a * vector.x + c * vector.y, b * vector.x + d * vector.y); }
+
+	static void WriteBatch(size_t count, const float* x, const float* y, const float* cos, const float* sin,
+		const float* scaleX, const float* scaleY, float* basis, float* offset);
+};
+
+#endif
@@ -3,40 +3,99 @@
 #ifndef VECTOR2_H
 #define VECTOR2_H
 
+/*
+A 2 Dimensional Vector over a scalar type. Float is used for rendering and the interactive
+simulation, double for long validation runs. Everything is inline so the hot loops compile
+down to straight-line arithmetic with no calls.
+*/
+
 #include <math.h>
+#include <cmath>
+#include <type_traits>
 #include <vector>
-class Vector2
+
+template<typename T>
+class Vector2T
 {
 public:
-	Vector2();
-	Vector2(float x, float y);
-	float x;
-	float y;
+	constexpr Vector2T() noexcept : x(0), y(0) {}
+	constexpr Vector2T(T x, T y) noexcept : x(x), y(y) {}
+	T x;
+	T y;
+
+	constexpr Vector2T operator+ (Vector2T const& obj) const noexcept { return Vector2T(x + obj.x, y + obj.y); }
+	constexpr Vector2T operator- (Vector2T const& obj) const noexcept { return Vector2T(x - obj.x, y - obj.y); }
+	constexpr Vector2T operator* (Vector2T const& obj) const noexcept { return Vector2T(x * obj.x, y * obj.y); }
+	constexpr Vector2T operator/ (Vector2T const& obj) const noexcept { return Vector2T(x / obj.x, y / obj.y); }
+
+	constexpr Vector2T operator+ (T const& val) const noexcept { return Vector2T(x + val, y + val); }
+	constexpr Vector2T operator- (T const& val) const noexcept { return Vector2T(x - val, y - val); }
+	constexpr Vector2T operator* (T const& val) const noexcept { return Vector2T(x * val, y * val); }
+	constexpr Vector2T operator/ (T const& val) const noexcept { return Vector2T(x / val, y / val); }
+	constexpr Vector2T operator- () const noexcept { return Vector2T(-x, -y); }
 
-	Vector2 operator+ (Vector2 const& obj) const;
-	Vector2 operator- (Vector2 const& obj) const;
-	Vector2 operator* (Vector2 const& obj) const;
-	Vector2 operator/ (Vector2 const& obj) const;
+	Vector2T& operator+= (Vector2T const& obj) noexcept { x += obj.x; y += obj.y; return *this; }
+	Vector2T& operator-= (Vector2T const& obj) noexcept { x -= obj.x; y -= obj.y; return *this; }
+	Vector2T& operator*= (T const& val) noexcept { x *= val; y *= val; return *this; }
+	Vector2T& operator/= (T const& val) noexcept { x /= val; y /= val; return *this; }
 
-	Vector2 operator+ (float const& val) const;
-	Vector2 operator- (float const& val) const;
-	Vector2 operator* (float const& val) const;
-	Vector2 operator*= (float const& val) const;
-	Vector2 operator/ (float const& val) const;
+	constexpr bool operator== (Vector2T const& obj) const noexcept { return x == obj.x && y == obj.y; }
+	constexpr bool operator!= (Vector2T const& obj) const noexcept { return x != obj.x || y != obj.y; }
 
+	/// <summary>
+	/// Sets the coordinates of the Vector.
+	/// </summary>
+	void Set(T x, T y) noexcept {
+		this->x = x;
+		this->y = y;
+	}
 
-	void Set(float x, float y);
-	float* AsArray();
+	/// <summary>
+	/// Returns the Vector as an array of its two coordinates.
+	/// </summary>
+	T* AsArray() noexcept { return &x; }
+	const T* AsArray() const noexcept { return &x; }
 
 	// Math
-    float CrossProduct(const Vector2& rhs) const;
-	float DotProduct(const Vector2& rhs) const;
-    float Magnitude();
-	float MagnitudeSqr();
-	void Rotate(float angle);
-	Vector2 Normalized();
-	void Normalize();
+	constexpr T CrossProduct(const Vector2T& obj) const noexcept { return (x * obj.y) - (y * obj.x); }
+	constexpr T DotProduct(const Vector2T& obj) const noexcept { return (x * obj.x) + (y * obj.y); }
+	constexpr T MagnitudeSqr() const noexcept { return x * x + y * y; }
+	T Magnitude() const noexcept { return std::sqrt(x * x + y * y); }
 
+	/// <summary>
+	/// Rotates the Vector by an angle in radians.
+	/// </summary>
+	void Rotate(T angle) noexcept {
+		T c = std::cos(angle);
+		T s = std::sin(angle);
+		T xt = (x * c) - (y * s);
+		T yt = (y * c) + (x * s);
+		x = xt;
+		y = yt;
+	}
+
+	/// <summary>
+	/// Returns the Vector scaled to unit length.
+	/// </summary>
+	Vector2T Normalized() const noexcept {
+		T mag = T(1) / std::sqrt(x * x + y * y);
+		return Vector2T(x * mag, y * mag);
+	}
+
+	/// <summary>
+	/// Scales the Vector to unit length.
+	/// </summary>
+	void Normalize() noexcept {
+		T mag = T(1) / std::sqrt(x * x + y * y);
+		x *= mag;
+		y *= mag;
+	}
 };
 
-#endif
\ No newline at end of file
+typedef Vector2T<float> Vector2;
+typedef Vector2T<double> Vector2d;
+
+static_assert(std::is_trivially_copyable<Vector2>::value, "Vector2 must stay trivially copyable");
+static_assert(sizeof(Vector2) == 2 * sizeof(float), "Vector2 must stay two packed floats");
+
+#endif
@@ -0,0 +1,209 @@
+/*
+A self-contained simulation of circles. It holds its own circles and settings
+and steps them the way the interactive tick loop steps its entities, but
+without meshes, the particle pool or any other global, so many worlds can
+run side by side. Collisions are found through a uniform grid instead of
+testing every pair, and each circle still meets its neighbours in the order
+they were spawned, so the result is the same as the pairwise pass. Circles
+that blow up to infinity or NaN are killed rather than break the grid.
+*/
+
+#include "World.h"
+#include <algorithm>
+#include <cmath>
+
+/// <summary>
+/// World Constructor. Allocates every circle up front, so the Entity pointers stay valid as circles are spawned.
+/// </summary>
+/// <param name="parameters">The settings of the world.</param>
+/// <param name="capacity">The most circles the world will hold.</param>
+World::World(const WorldParameters& parameters, size_t capacity) : random(parameters.seed), grid(1.0f) {
+    this->parameters = parameters;
+
+    // A world steps on the thread that calls it and never touches the shared thread pool,
+    // so worlds can be stepped from the pool's own workers or from a library with no pool of its own.
+    grid.setSerial(true);
+    circles.reserve(capacity);
+    entities.reserve(capacity);
+    gridX.reserve(capacity);
+    gridY.reserve(capacity);
+}
+
+/// <summary>
+/// Adds a circle to the world with the world's bounciness and friction.
+/// </summary>
+/// <param name="position">The position of the circle.</param>
+/// <param name="velocity">The velocity of the circle.</param>
+/// <param name="radius">The radius of the circle.</param>
+/// <param name="density">The mass of the circle per unit of area.</param>
+/// <returns>The circle, or nullptr if the world is full.</returns>
+EntityCircle* World::Spawn(Vector2 position, Vector2 velocity, float radius, float density) {
+    if (circles.size() == circles.capacity()) return nullptr;
+
+    std::uniform_real_distribution<float> shade(0.0f, 1.0f);
+    float color[3] = { shade(random), shade(random), shade(random) };
+    circles.emplace_back(position, radius, color, nullptr);
+    EntityCircle* circle = &circles.back();
+    circle->velocity = velocity;
+    circle->mass *= density;
+    circle->setBounciness(parameters.bounciness);
+    circle->setFriction(parameters.friction);
+    circle->ResetForce(parameters.gravity);
+    entities.push_back(circle);
+    return circle;
+}
+
+/// <summary>
+/// Steps the world a number of ticks: integration, then collisions, then the forces are reset to gravity.
+/// </summary>
+/// <param name="ticks">The number of ticks.</param>
+void World::Step(unsigned int ticks) {
+    for (unsigned int t = 0; t < ticks; t++) {
+        for (size_t i = 0; i < circles.size(); i++) {
+            circles[i].Update(parameters.bounds, parameters.boundary, parameters.timestep, parameters.timestep);
+        }
+        Collide();
+        for (size_t i = 0; i < circles.size(); i++) {
+            circles[i].ResetForce(parameters.gravity);
+        }
+        tick++;
+    }
+}
+
+/// <summary>
+/// Runs every circle's collision pass against the circles near it. Cells are wide enough that no circle
+/// can reach past the next cell this tick, even after a collision doubles its speed.
+/// </summary>
+void World::Collide() {
+    size_t count = circles.size();
+    if (count == 0) return;
+
+    gridX.resize(count);
+    gridY.resize(count);
+    float maxRadius = 0.0f;
+    float maxSpeedSqr = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        EntityCircle& circle = circles[i];
+
+        // A circle whose position or velocity has gone to infinity or NaN can't be placed in the grid, so it is
+        // killed. Dead circles sit at the corner of the world, where nothing collides with them.
+        if (circle.isAlive() && !(std::isfinite(circle.position.x) && std::isfinite(circle.position.y)
+            && std::isfinite(circle.velocity.x) && std::isfinite(circle.velocity.y))) {
+            circle.Kill();
+            lost++;
+        }
+        if (!circle.isAlive()) {
+            gridX[i] = parameters.bounds.min.x;
+            gridY[i] = parameters.bounds.min.y;
+            continue;
+        }
+
+        gridX[i] = circle.position.x;
+        gridY[i] = circle.position.y;
+        maxRadius = std::max(maxRadius, circle.getRadius());
+        maxSpeedSqr = std::max(maxSpeedSqr, circle.velocity.MagnitudeSqr());
+    }
+
+    // A circle thrown out to an infinite speed puts everything in one cell, which is the pairwise pass again.
+    float cellSize = 2.0f * maxRadius + 4.0f * std::sqrt(maxSpeedSqr) * parameters.timestep + 1.0f;
+    if (!std::isfinite(cellSize)) {
+        Vector2 span = parameters.bounds.max - parameters.bounds.min;
+        cellSize = std::max(span.x, span.y);
+    }
+    grid.setCellSize(cellSize);
+    grid.Build(gridX, gridY);
+
+    for (size_t i = 0; i < count; i++) {
+        if (!circles[i].isAlive()) continue;
+        int cellX = grid.getCellX(gridX[i]);
+        int cellY = grid.getCellY(gridY[i]);
+        int minX, maxX, minY, maxY;
+        grid.getStencil(cellX, cellY, minX, maxX, minY, maxY);
+
+        candidateIndices.clear();
+        for (int y = minY; y <= maxY; y++) {
+            for (int x = minX; x <= maxX; x++) {
+                unsigned int cell;
+                if (!grid.getNeighbourCell(x, y, cell)) continue;
+                candidateIndices.insert(candidateIndices.end(), grid.cellEntries.begin() + grid.cellStart[cell], grid.cellEntries.begin() + grid.cellStart[cell + 1]);
+            }
+        }
+
+        // Visit the neighbours in spawn order, as the pairwise pass over every entity would.
+        std::sort(candidateIndices.begin(), candidateIndices.end());
+        candidates.clear();
+        for (size_t k = 0; k < candidateIndices.size(); k++) {
+            candidates.push_back(&circles[candidateIndices[k]]);
+        }
+        pairTests += candidates.size();
+        circles[i].CheckCollisions(candidates, parameters.timestep, parameters.timestep);
+    }
+}
+
+/// <summary>
+/// Returns every circle in the world, in the order they were spawned.
+/// </summary>
+const std::vector<Entity*>& World::getEntities() {
+    return entities;
+}
+
+/// <summary>
+/// Returns the world's block of circles. It is allocated once, so the pointer stays valid for the life of the world.
+/// </summary>
+EntityCircle* World::getCircles() {
+    return circles.data();
+}
+
+/// <summary>
+/// Returns the settings of the world.
+/// </summary>
+const WorldParameters& World::getParameters() {
+    return parameters;
+}
+
+/// <summary>
+/// Returns the number of circles in the world.
+/// </summary>
+size_t World::getCount() {
+    return circles.size();
+}
+
+/// <summary>
+/// Returns the most circles the world can hold.
+/// </summary>
+size_t World::getCapacity() {
+    return circles.capacity();
+}
+
+/// <summary>
+/// Returns the number of ticks the world has been stepped.
+/// </summary>
+uint64_t World::getTick() {
+    return tick;
+}
+
+/// <summary>
+/// Returns the number of candidate pairs the broadphase has handed to the collision pass so far.
+/// </summary>
+uint64_t World::getPairTestCount() {
+    return pairTests;
+}
+
+/// <summary>
+/// Returns the number of circles killed because their position or velocity stopped being finite.
+/// </summary>
+uint64_t World::getLostCount() {
+    return lost;
+}
+
+/// <summary>
+/// Returns the kinetic energy of every live circle in the world.
+/// </summary>
+double World::KineticEnergy() {
+    double energy = 0.0;
+    for (size_t i = 0; i < entities.size(); i++) {
+        if (!entities[i]->isAlive()) continue;
+        energy += 0.5 * entities[i]->mass * entities[i]->velocity.MagnitudeSqr();
+    }
+    return energy;
+}
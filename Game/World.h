@@ -0,0 +1,66 @@
+#pragma once
+
+#ifndef WORLD_H
+#define WORLD_H
+
+#include "Bounds.h"
+#include "Common.h"
+#include "Entities/Entity.h"
+#include "Physics/SpatialGrid.h"
+#include <random>
+#include <stdint.h>
+#include <vector>
+
+// The settings a world is simulated with. The defaults are the interactive simulation's and an Entity's own.
+struct WorldParameters {
+	Bounds bounds = Bounds(Vector2(0.0f, 0.0f), Vector2(WORLD_WIDTH, WORLD_HEIGHT));
+	BoundaryMode boundary = REFLECTING;
+
+	// Gravity is a change in velocity per tick, as in the interactive simulation.
+	Vector2 gravity = Vector2(0.0f, GRAVITY);
+	float timestep = TIMESTEP;
+	float bounciness = 0.85f;
+	float friction = 0.05f;
+
+	// Seeds the world's own random generator, which colours its circles.
+	uint32_t seed = 1;
+};
+
+// A simulation of circles that owns everything it steps: its circles, their storage, the broadphase
+// grid and its scratch buffers, its settings and its random generator. Worlds share no mutable state
+// and start no threads, so any number can be stepped at once on separate threads.
+class World
+{
+public:
+	World(const WorldParameters& parameters, size_t capacity);
+	~World() = default;
+	World(const World&) = delete;
+	World& operator=(const World&) = delete;
+	EntityCircle* Spawn(Vector2 position, Vector2 velocity, float radius, float density);
+	void Step(unsigned int ticks);
+	const std::vector<Entity*>& getEntities();
+	EntityCircle* getCircles();
+	const WorldParameters& getParameters();
+	size_t getCount();
+	size_t getCapacity();
+	uint64_t getTick();
+	uint64_t getPairTestCount();
+	uint64_t getLostCount();
+	double KineticEnergy();
+private:
+	void Collide();
+	WorldParameters parameters;
+	std::mt19937 random;
+	std::vector<EntityCircle> circles;
+	std::vector<Entity*> entities;
+	SpatialGrid grid;
+	std::vector<float> gridX;
+	std::vector<float> gridY;
+	std::vector<Entity*> candidates;
+	std::vector<unsigned int> candidateIndices;
+	uint64_t tick = 0;
+	uint64_t pairTests = 0;
+	uint64_t lost = 0;
+};
+
+#endif
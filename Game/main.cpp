@@ -7,6 +7,25 @@
 #include <chrono>
 #include "Input.h"
 #include "Mesh.h"
+#include "ParticlePool.h"
+#include "Emitter.h"
+#include "Physics/BarnesHut.h"
+#include "Physics/NeighbourList.h"
+#include "Physics/FluidSolver.h"
+#include "Physics/ConstraintSolver.h"
+#include "Physics/Substepper.h"
+#include "Camera.h"
+#include "ChunkManager.h"
+#include "MultiRateScheduler.h"
+#include "InstanceBatch.h"
+#include "Headless.h"
+#include "IO/Snapshot.h"
+#include "IO/TrajectoryRecorder.h"
+#include "ReplayViewer.h"
+#include "IO/SceneLoader.h"
+#include "IO/SharedState.h"
+#include "Ensemble.h"
+#include <unordered_map>
 
 #define BACKEND "alut"
 
@@ -15,10 +34,43 @@ const char* title = "Particle Simulator";
 GLuint shaderProgram;
 Input* input;
 std::vector<Entity*> entities;
+std::vector<Emitter> emitters;
+std::vector<Absorber> absorbers;
+ParticlePool* particles;
+BarnesHut* barnesHut;
+GravityMode gravityMode = UNIFORM;
+NeighbourList* neighbourList;
+InteractionMode interactionMode = PAIRWISE;
+FluidSolver* fluidSolver;
+ConstraintSolver* constraintSolver;
+Substepper* substepper;
+Bounds world(Vector2(0.0f, 0.0f), Vector2(WORLD_WIDTH, WORLD_HEIGHT));
+BoundaryMode boundaryMode = REFLECTING;
+bool headless = false;
+unsigned int benchmarkParticles = 0;
+double eventDrivenDuration = 0.0;
+bool damBreak = false;
+HeadlessOptions headlessOptions;
+Camera* camera;
+ChunkManager* chunkManager;
+MultiRateScheduler* rateScheduler;
+TrajectoryRecorder* recorder;
+ParticleStorage<float> recordBuffer;
+ReplayViewer* replay = nullptr;
+std::string replayPath;
+SharedStateReader* liveState = nullptr;
+std::string attachName;
+std::string ensemblePath;
+std::string ensembleOutput;
+unsigned int tick = 0;
 
-// Meshes
+// Each entity's force from gravity and input this tick, before the force models add theirs.
+std::vector<Vector2> tickForces;
+
+// Meshes, and the instance batch each is drawn with.
 Mesh* circleMesh;
 Mesh* boxMesh;
+std::unordered_map<Mesh*, InstanceBatch*> batches;
 
 /// <summary>
 /// Creates a Window with a given title, width, and height.
@@ -147,26 +199,540 @@ void setOrthographicProjection(int shaderProgram, float left, float right, float
     glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, mat.AsArray());
 }
 
+/// <summary>
+/// Fills the left of the world with a block of small fluid particles.
+/// </summary>
+void spawnDamBreak() {
+    float spacing = FLUID_PARTICLE_RADIUS * 2.0f;
+    for (float y = world.min.y + FLUID_PARTICLE_RADIUS; y < world.min.y + world.getHeight() * 0.8f; y += spacing) {
+        for (float x = world.min.x + FLUID_PARTICLE_RADIUS; x < world.min.x + world.getWidth() * 0.4f; x += spacing) {
+            EntityCircle* particle = particles->Spawn(Vector2(x, y), Vector2(0.0f, 0.0f), 0.0f);
+            if (!particle) return;
+            particle->setRadius(FLUID_PARTICLE_RADIUS);
+            entities.push_back(particle);
+        }
+    }
+}
+
+/// <summary>
+/// Spawns a node for a rope or cloth from the particle pool.
+/// </summary>
+/// <param name="position">The position of the node.</param>
+/// <returns>The node, or nullptr if the pool is exhausted.</returns>
+Entity* spawnNode(Vector2 position) {
+    EntityCircle* node = particles->Spawn(position, Vector2(0.0f, 0.0f), 0.0f);
+    if (!node) return nullptr;
+    node->setRadius(NODE_RADIUS);
+    entities.push_back(node);
+    return node;
+}
+
+/// <summary>
+/// Returns whether the pool has room for a number of nodes, so a rope or cloth is never left half built.
+/// </summary>
+/// <param name="count">The number of nodes.</param>
+bool hasRoomForNodes(unsigned int count) {
+    return particles->getCapacity() - particles->getActiveCount() >= count;
+}
+
+/// <summary>
+/// Hangs a rope from a pinned node. Spawns nothing if the pool can't hold the whole rope.
+/// </summary>
+/// <param name="anchor">The position of the pinned end.</param>
+/// <param name="length">The number of nodes in the rope.</param>
+void spawnRope(Vector2 anchor, unsigned int length) {
+    if (length == 0 || !hasRoomForNodes(length)) return;
+    Entity* previous = spawnNode(anchor);
+    previous->setKinematic(true);
+
+    for (unsigned int i = 1; i < length; i++) {
+        Entity* node = spawnNode(Vector2(anchor.x + i * NODE_SPACING, anchor.y));
+        constraintSolver->AddDistance(previous, node, NODE_SPACING);
+        previous = node;
+    }
+}
+
+/// <summary>
+/// Switches the edges of the world between reflecting walls and periodic wrapping.
+/// </summary>
+/// <param name="boundary">The boundary mode.</param>
+void setBoundaryMode(BoundaryMode boundary) {
+    boundaryMode = boundary;
+    neighbourList->setBoundary(boundary, world);
+    fluidSolver->setBoundary(boundary, world);
+    constraintSolver->setBoundary(boundary, world);
+}
+
+/// <summary>
+/// Hangs a sheet of cloth from its top row. Edges are rigid and the diagonals are springs.
+/// Spawns nothing if the pool can't hold the whole sheet.
+/// </summary>
+/// <param name="topLeft">The position of the top left node.</param>
+/// <param name="columns">The number of nodes across.</param>
+/// <param name="rows">The number of nodes down.</param>
+void spawnCloth(Vector2 topLeft, unsigned int columns, unsigned int rows) {
+    if (!hasRoomForNodes(columns * rows)) return;
+    std::vector<Entity*> nodes(columns * rows, nullptr);
+    for (unsigned int y = 0; y < rows; y++) {
+        for (unsigned int x = 0; x < columns; x++) {
+            Entity* node = spawnNode(Vector2(topLeft.x + x * NODE_SPACING, topLeft.y - y * NODE_SPACING));
+            if (y == 0) node->setKinematic(true);
+            nodes[y * columns + x] = node;
+        }
+    }
+
+    float diagonal = NODE_SPACING * sqrtf(2.0f);
+    for (unsigned int y = 0; y < rows; y++) {
+        for (unsigned int x = 0; x < columns; x++) {
+            Entity* node = nodes[y * columns + x];
+            if (x + 1 < columns) constraintSolver->AddDistance(node, nodes[y * columns + x + 1], NODE_SPACING);
+            if (y + 1 < rows) constraintSolver->AddDistance(node, nodes[(y + 1) * columns + x], NODE_SPACING);
+            if (x + 1 < columns && y + 1 < rows) {
+                constraintSolver->AddSpring(node, nodes[(y + 1) * columns + x + 1], diagonal, SPRING_COMPLIANCE);
+                constraintSolver->AddSpring(nodes[y * columns + x + 1], nodes[(y + 1) * columns + x], diagonal, SPRING_COMPLIANCE);
+            }
+        }
+    }
+}
+
+/// <summary>
+/// Sets every entity's force back to this tick's gravity and input, then adds the forces of the active
+/// models. Runs before every substep, so contacts and self-gravity follow the entities through the tick.
+/// </summary>
+void applyForces() {
+    for (size_t i = 0; i < entities.size(); i++) {
+        Entity* ent = entities[i];
+        ent->force = tickForces[i];
+
+        // Self-gravity replaces the uniform gravity.
+        if (gravityMode == BARNES_HUT && !ent->isKinematic()) ent->force.y -= GRAVITY * ent->mass;
+    }
+
+    if (gravityMode == BARNES_HUT) {
+        barnesHut->ApplyForces(entities);
+    }
+
+    if (interactionMode == NEIGHBOUR_LIST) {
+        neighbourList->ApplyForces(entities);
+    }
+    else if (interactionMode == FLUID) {
+        fluidSolver->ApplyForces(entities);
+    }
+}
+
+/// <summary>
+/// Hands the alive entities of this tick to the trajectory recorder.
+/// </summary>
+void recordTick() {
+    recordBuffer.Clear();
+    for (size_t i = 0; i < entities.size(); i++) {
+        Entity* ent = entities[i];
+        if (!ent->isAlive()) continue;
+        // Other shapes are recorded by their bounding radius.
+        float radius = ent->type == CIRCLE ? ((EntityCircle*)ent)->getRadius() : fmaxf(ent->scale.x, ent->scale.y) * 0.5f;
+        recordBuffer.Add(ent->position, ent->velocity, radius, ent->mass);
+    }
+    recorder->Record(recordBuffer.getView(), tick);
+}
+
+/// <summary>
+/// Clears the scene. Pooled particles go back to the pool, everything else is deleted,
+/// and chunks paged out of the old scene are dropped with a fresh page file.
+/// </summary>
+void clearScene() {
+    constraintSolver->Clear();
+    emitters.clear();
+    absorbers.clear();
+    for (size_t i = 0; i < entities.size(); i++) {
+        entities[i]->Kill();
+    }
+    particles->Reap(entities, absorbers);
+    for (size_t i = 0; i < entities.size(); i++) {
+        delete entities[i];
+    }
+    entities.clear();
+    delete chunkManager;
+    chunkManager = new ChunkManager(CHUNK_SIZE, CHUNK_PAGE_FILE);
+}
+
+/// <summary>
+/// Saves every live entity to a scene snapshot, one column per field.
+/// Constraints, emitters, absorbers and paged out chunks are not saved.
+/// </summary>
+/// <param name="path">The path of the snapshot.</param>
+void saveScene(const std::string& path) {
+    std::vector<Entity*> alive;
+    for (size_t i = 0; i < entities.size(); i++) {
+        if (entities[i]->isAlive()) alive.push_back(entities[i]);
+    }
+
+    uint32_t elementSizes[SNAPSHOT_MAX_COLUMNS] = {};
+    for (int column = COLUMN_POSITION_X; column <= COLUMN_AGE; column++) {
+        elementSizes[column] = sizeof(float);
+    }
+
+    Snapshot snapshot;
+    if (!snapshot.Create(path, alive.size(), elementSizes)) {
+        std::cout << snapshot.getError() << std::endl;
+        return;
+    }
+    SnapshotHeader* header = snapshot.getHeader();
+    header->boundary = boundaryMode;
+    header->tick = tick;
+    header->worldMinX = world.min.x;
+    header->worldMinY = world.min.y;
+    header->worldMaxX = world.max.x;
+    header->worldMaxY = world.max.y;
+
+    float* columns[SNAPSHOT_MAX_COLUMNS] = {};
+    for (int column = COLUMN_POSITION_X; column <= COLUMN_AGE; column++) {
+        if (column != COLUMN_TYPE && column != COLUMN_FLAGS) columns[column] = snapshot.getColumn<float>((SnapshotColumn)column);
+    }
+    uint32_t* types = snapshot.getColumn<uint32_t>(COLUMN_TYPE);
+    uint32_t* flags = snapshot.getColumn<uint32_t>(COLUMN_FLAGS);
+
+    for (size_t i = 0; i < alive.size(); i++) {
+        Entity* ent = alive[i];
+        columns[COLUMN_POSITION_X][i] = ent->position.x;
+        columns[COLUMN_POSITION_Y][i] = ent->position.y;
+        columns[COLUMN_VELOCITY_X][i] = ent->velocity.x;
+        columns[COLUMN_VELOCITY_Y][i] = ent->velocity.y;
+        columns[COLUMN_FORCE_X][i] = ent->force.x;
+        columns[COLUMN_FORCE_Y][i] = ent->force.y;
+        columns[COLUMN_INVERSE_MASS][i] = ent->isKinematic() ? 0.0f : 1.0f / ent->mass;
+        columns[COLUMN_RADIUS][i] = ent->type == CIRCLE ? ((EntityCircle*)ent)->getRadius() : 0.0f;
+        columns[COLUMN_ROTATION][i] = ent->rotation;
+        columns[COLUMN_SCALE_X][i] = ent->scale.x;
+        columns[COLUMN_SCALE_Y][i] = ent->scale.y;
+        columns[COLUMN_COLOR_R][i] = ent->color[0];
+        columns[COLUMN_COLOR_G][i] = ent->color[1];
+        columns[COLUMN_COLOR_B][i] = ent->color[2];
+        columns[COLUMN_LIFETIME][i] = ent->getLifetime();
+        columns[COLUMN_AGE][i] = ent->getAge();
+        types[i] = ent->type;
+        flags[i] = (ent->isKinematic() ? SNAPSHOT_KINEMATIC : 0) | (particles->Owns(ent) ? SNAPSHOT_POOLED : 0);
+    }
+    std::cout << "Saved " << alive.size() << " entities to " << path << std::endl;
+}
+
+/// <summary>
+/// Reads one value of a snapshot column stored as float or double, or a default if the column is absent.
+/// </summary>
+float readColumn(Snapshot& snapshot, SnapshotColumn column, size_t index, float fallback) {
+    if (float* values = snapshot.getColumn<float>(column)) return values[index];
+    if (double* values = snapshot.getColumn<double>(column)) return (float)values[index];
+    return fallback;
+}
+
+/// <summary>
+/// Replaces the scene with the entities in a snapshot. Snapshots saved by a headless run only hold
+/// particle columns, and load as pooled circles until the pool is full.
+/// </summary>
+/// <param name="path">The path of the snapshot.</param>
+void loadScene(const std::string& path) {
+    Snapshot snapshot;
+    if (!snapshot.Open(path, false)) {
+        std::cout << snapshot.getError() << std::endl;
+        return;
+    }
+
+    clearScene();
+    world = snapshot.getWorld();
+    tick = (unsigned int)snapshot.getHeader()->tick;
+    setBoundaryMode((BoundaryMode)snapshot.getHeader()->boundary);
+
+    uint32_t* types = snapshot.getColumn<uint32_t>(COLUMN_TYPE);
+    uint32_t* flags = snapshot.getColumn<uint32_t>(COLUMN_FLAGS);
+    size_t count = (size_t)snapshot.getCount();
+    size_t skipped = 0;
+    for (size_t i = 0; i < count; i++) {
+        Vector2 position(readColumn(snapshot, COLUMN_POSITION_X, i, 0.0f), readColumn(snapshot, COLUMN_POSITION_Y, i, 0.0f));
+        Vector2 velocity(readColumn(snapshot, COLUMN_VELOCITY_X, i, 0.0f), readColumn(snapshot, COLUMN_VELOCITY_Y, i, 0.0f));
+        EntityType type = types ? (EntityType)types[i] : CIRCLE;
+        uint32_t flag = flags ? flags[i] : SNAPSHOT_POOLED;
+
+        Entity* ent;
+        if (type == BOX) {
+            EntityBox* box = new EntityBox(position, boxMesh);
+            box->setSize(readColumn(snapshot, COLUMN_SCALE_X, i, 1.0f), readColumn(snapshot, COLUMN_SCALE_Y, i, 1.0f));
+            box->velocity = velocity;
+            ent = box;
+        }
+        else {
+            EntityCircle* circle;
+            if (flag & SNAPSHOT_POOLED) circle = particles->Spawn(position, velocity, 0.0f);
+            else {
+                circle = new EntityCircle(position, circleMesh);
+                circle->velocity = velocity;
+            }
+            if (!circle) {
+                skipped++;
+                continue;
+            }
+            circle->setRadius(readColumn(snapshot, COLUMN_RADIUS, i, 1.0f));
+            ent = circle;
+        }
+
+        // Without an inverse mass column the entity keeps the mass of its shape.
+        float inverseMass = readColumn(snapshot, COLUMN_INVERSE_MASS, i, -1.0f);
+        if (inverseMass > 0.0f) ent->mass = 1.0f / inverseMass;
+        ent->force.Set(readColumn(snapshot, COLUMN_FORCE_X, i, 0.0f), readColumn(snapshot, COLUMN_FORCE_Y, i, GRAVITY * ent->mass));
+        ent->rotation = readColumn(snapshot, COLUMN_ROTATION, i, 0.0f);
+        ent->color[0] = readColumn(snapshot, COLUMN_COLOR_R, i, ent->color[0]);
+        ent->color[1] = readColumn(snapshot, COLUMN_COLOR_G, i, ent->color[1]);
+        ent->color[2] = readColumn(snapshot, COLUMN_COLOR_B, i, ent->color[2]);
+        ent->setLifetime(readColumn(snapshot, COLUMN_LIFETIME, i, 0.0f));
+        ent->setAge(readColumn(snapshot, COLUMN_AGE, i, 0.0f));
+        ent->setKinematic((flag & SNAPSHOT_KINEMATIC) != 0 || inverseMass == 0.0f);
+        entities.push_back(ent);
+    }
+
+    std::cout << "Loaded " << entities.size() << " entities from " << path;
+    if (skipped > 0) std::cout << ", " << skipped << " did not fit in the pool";
+    std::cout << std::endl;
+}
+
+/// <summary>
+/// Replaces the scene with one read from a scene file. Regions are scattered in bulk first,
+/// then spawned into the particle pool, and the scene's settings replace the current ones.
+/// </summary>
+/// <param name="path">The path of the scene file.</param>
+void loadSceneFile(const std::string& path) {
+    auto start = timer::now();
+    SceneDescription scene;
+    std::string error;
+    if (!LoadSceneFile(path, scene, error)) {
+        std::cout << error << std::endl;
+        return;
+    }
+    ParticleStorage<float> bulk;
+    BuildSceneParticles(scene, bulk);
+
+    clearScene();
+    tick = 0;
+    world = scene.world;
+    setBoundaryMode(scene.boundary);
+    gravityMode = scene.gravity;
+    interactionMode = scene.interaction;
+
+    size_t skipped = 0;
+    for (size_t i = 0; i < bulk.getCount(); i++) {
+        EntityCircle* circle = particles->Spawn(bulk.getPosition(i), bulk.getVelocity(i), 0.0f);
+        if (!circle) {
+            skipped = bulk.getCount() - i;
+            break;
+        }
+        circle->setRadius(bulk.radius[i]);
+        entities.push_back(circle);
+    }
+    for (size_t i = 0; i < scene.boxes.size(); i++) {
+        const SceneBox& box = scene.boxes[i];
+        EntityBox* ent = new EntityBox(box.position, box.rotation, boxMesh);
+        ent->setSize(box.length, box.width);
+        entities.push_back(ent);
+    }
+    for (size_t i = 0; i < scene.emitters.size(); i++) {
+        const SceneEmitter& emitter = scene.emitters[i];
+        emitters.push_back(Emitter(emitter.position, emitter.velocity, emitter.spread, emitter.rate, emitter.lifetime));
+    }
+    for (size_t i = 0; i < scene.absorbers.size(); i++) {
+        absorbers.push_back(Absorber(scene.absorbers[i].min, scene.absorbers[i].max));
+    }
+
+    std::cout << "Loaded " << entities.size() << " entities from " << path << " in "
+        << std::chrono::duration<double>(timer::now() - start).count() << " s";
+    if (skipped > 0) std::cout << ", " << skipped << " did not fit in the pool";
+    std::cout << std::endl;
+}
+
+/// <summary>
+/// Pans and zooms the camera, and closes the window on escape.
+/// </summary>
+/// <param name="window">The window.</param>
+/// <param name="cursor">The cursor in world space.</param>
+void processCameraInput(GLFWwindow* window, const Vector2& cursor) {
+    // I, J, K and L pan the camera, the mouse wheel zooms about the cursor and Home resets the view.
+    Vector2 pan(0.0f, 0.0f);
+    if (glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS) pan.y += CAMERA_PAN_SPEED;
+    if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS) pan.y -= CAMERA_PAN_SPEED;
+    if (glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS) pan.x -= CAMERA_PAN_SPEED;
+    if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS) pan.x += CAMERA_PAN_SPEED;
+    camera->Pan(pan);
+
+    double scroll = input->getScroll();
+    if (scroll != 0.0) {
+        camera->Zoom(powf(CAMERA_ZOOM_STEP, (float)scroll), cursor);
+    }
+    if (input->getKeyPressed(GLFW_KEY_HOME)) {
+        camera->setCenter(world.getCenter());
+        camera->setZoom(1.0f);
+    }
+
+    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+        glfwSetWindowShouldClose(window, true);
+    }
+}
+
+/// <summary>
+/// Controls replay playback. Space pauses, the right and left arrows play forwards or backwards
+/// and speed up with each press, the comma and period step one frame, and dragging with the left
+/// mouse button scrubs across the whole recording.
+/// </summary>
+/// <param name="window">The window.</param>
+void processReplayInput(GLFWwindow* window) {
+    double cursorX, cursorY;
+    glfwGetCursorPos(window, &cursorX, &cursorY);
+    processCameraInput(window, camera->ScreenToWorld(cursorX, cursorY));
+
+    if (input->getKeyPressed(GLFW_KEY_SPACE)) {
+        replay->setPaused(!replay->isPaused());
+    }
+    if (input->getKeyPressed(GLFW_KEY_RIGHT)) {
+        replay->setSpeed(replay->getSpeed() > 0.0 && !replay->isPaused() ? replay->getSpeed() * 2.0 : 1.0);
+        replay->setPaused(false);
+    }
+    if (input->getKeyPressed(GLFW_KEY_LEFT)) {
+        replay->setSpeed(replay->getSpeed() < 0.0 && !replay->isPaused() ? replay->getSpeed() * 2.0 : -1.0);
+        replay->setPaused(false);
+    }
+    if (input->getKeyPressed(GLFW_KEY_PERIOD)) {
+        replay->Step(1);
+    }
+    if (input->getKeyPressed(GLFW_KEY_COMMA)) {
+        replay->Step(-1);
+    }
+    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_1) == GLFW_PRESS) {
+        double fraction = fmin(fmax(cursorX / SCREEN_WIDTH, 0.0), 1.0);
+        replay->setPaused(true);
+        replay->Seek(replay->getFirstTick() + fraction * (replay->getLastTick() - replay->getFirstTick()));
+    }
+}
+
+/// <summary>
+/// Draws the latest frame published by another process, coloured by speed. A frame written over
+/// while it is being drawn is thrown away and the newer one drawn instead.
+/// </summary>
+/// <param name="batch">The instance batch of the circle mesh.</param>
+/// <param name="view">The part of the world on screen.</param>
+void renderLiveState(InstanceBatch* batch, const Bounds& view) {
+    SharedStateFrame frame;
+    for (int attempt = 0; attempt < 3; attempt++) {
+        batch->Clear();
+        if (!liveState->Latest(frame)) return;
+
+        const float* positionX = frame.columns[SHARED_POSITION_X];
+        const float* positionY = frame.columns[SHARED_POSITION_Y];
+        const float* velocityX = frame.columns[SHARED_VELOCITY_X];
+        const float* velocityY = frame.columns[SHARED_VELOCITY_Y];
+        const float* radius = frame.columns[SHARED_RADIUS];
+
+        float inverseColorSpeed = 1.0f / REPLAY_COLOR_SPEED;
+        for (size_t i = 0; i < frame.count; i++) {
+            Vector2 position(positionX[i], positionY[i]);
+            if (!view.Overlaps(position, radius[i])) continue;
+
+            float heat = fminf(sqrtf(velocityX[i] * velocityX[i] + velocityY[i] * velocityY[i]) * inverseColorSpeed, 1.0f);
+            float color[3] = { heat, 0.2f, 1.0f - heat };
+            batch->Add(position, 1.0f, 0.0f, Vector2(radius[i], radius[i]), color);
+        }
+        if (liveState->isValid(frame)) return;
+    }
+
+    // The publisher kept lapping the draw, so skip this frame rather than show a torn one.
+    batch->Clear();
+}
+
 // process input
 void processInput(GLFWwindow* window) {
-    double xpos, ypos;
+    double cursorX, cursorY;
 
-    glfwGetCursorPos(window, &xpos, &ypos);
-    ypos = SCREEN_HEIGHT - ypos;
+    glfwGetCursorPos(window, &cursorX, &cursorY);
+    Vector2 cursor = camera->ScreenToWorld(cursorX, cursorY);
+    float xpos = cursor.x;
+    float ypos = cursor.y;
 
     if (input->getMouseButtonPressed(GLFW_MOUSE_BUTTON_1)) {
-        entities.push_back(new EntityCircle(Vector2(xpos, ypos), circleMesh));
+        Entity* ent = particles->Spawn(Vector2(xpos, ypos), Vector2(0.0f, 0.0f), 0.0f);
+        if (ent) entities.push_back(ent);
     }
     else if (input->getMouseButtonPressed(GLFW_MOUSE_BUTTON_2)) {
-        Entity* ent = new EntityCircle(Vector2(xpos, ypos), circleMesh);
-        ent->setKinematic(true);
-        entities.push_back(ent);
+        Entity* ent = particles->Spawn(Vector2(xpos, ypos), Vector2(0.0f, 0.0f), 0.0f);
+        if (ent) {
+            ent->setKinematic(true);
+            entities.push_back(ent);
+        }
+    }
+    else if (input->getMouseButtonPressed(GLFW_MOUSE_BUTTON_3)) {
+        // Shift places an absorber, otherwise a fountain emitter.
+        if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS) {
+            absorbers.push_back(Absorber(Vector2(xpos - 50.0f, ypos - 50.0f), Vector2(xpos + 50.0f, ypos + 50.0f)));
+        }
+        else {
+            emitters.push_back(Emitter(Vector2(xpos, ypos), Vector2(0.0f, 400.0f), 15.0f, 30.0f, 4.0f));
+        }
     }
 
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-        glfwSetWindowShouldClose(window, true);
+    // G toggles self-gravity, [ and ] tune the opening angle.
+    if (input->getKeyPressed(GLFW_KEY_G)) {
+        gravityMode = gravityMode == UNIFORM ? BARNES_HUT : UNIFORM;
+    }
+    if (input->getKeyPressed(GLFW_KEY_LEFT_BRACKET)) {
+        barnesHut->setTheta(fmaxf(barnesHut->getTheta() - 0.1f, 0.0f));
+    }
+    else if (input->getKeyPressed(GLFW_KEY_RIGHT_BRACKET)) {
+        barnesHut->setTheta(barnesHut->getTheta() + 0.1f);
+    }
+
+    // V switches between the pairwise collision loop and soft contacts through the neighbour list.
+    if (input->getKeyPressed(GLFW_KEY_V)) {
+        interactionMode = interactionMode == PAIRWISE ? NEIGHBOUR_LIST : PAIRWISE;
+    }
+    // F switches the circles to a fluid, B fills the left of the world with a column of fluid.
+    if (input->getKeyPressed(GLFW_KEY_F)) {
+        interactionMode = interactionMode == FLUID ? PAIRWISE : FLUID;
+    }
+    if (input->getKeyPressed(GLFW_KEY_B)) {
+        spawnDamBreak();
+    }
+    // R hangs a rope and C a sheet of cloth from the cursor.
+    if (input->getKeyPressed(GLFW_KEY_R)) {
+        spawnRope(Vector2(xpos, ypos), 20);
+    }
+    if (input->getKeyPressed(GLFW_KEY_C)) {
+        spawnCloth(Vector2(xpos, ypos), 24, 16);
+    }
+
+    // P wraps the edges of the world around, for bulk studies without walls.
+    if (input->getKeyPressed(GLFW_KEY_P)) {
+        setBoundaryMode(boundaryMode == PERIODIC ? REFLECTING : PERIODIC);
+    }
+
+    // M steps calm regions away from the camera at a slower rate.
+    if (input->getKeyPressed(GLFW_KEY_M)) {
+        rateScheduler->setEnabled(!rateScheduler->isEnabled());
+    }
+
+    // F5 saves the scene and F9 loads it back.
+    if (input->getKeyPressed(GLFW_KEY_F5)) {
+        saveScene(SCENE_SNAPSHOT_FILE);
+    }
+    if (input->getKeyPressed(GLFW_KEY_F9)) {
+        loadScene(SCENE_SNAPSHOT_FILE);
+    }
+
+    // F6 starts and stops recording every tick to a trajectory file.
+    if (input->getKeyPressed(GLFW_KEY_F6)) {
+        if (recorder->isOpen()) {
+            recorder->Close();
+            std::cout << "Recorded " << recorder->getRecordedFrames() << " frames to " << recorder->getPath() << std::endl;
+        }
+        else if (!recorder->Open(RECORD_FILE, world, RECORD_BUFFERS, RECORD_KEYFRAME_INTERVAL, RECORD_POSITION_QUANTUM, RECORD_VELOCITY_QUANTUM)) {
+            std::cout << "Could not record to " << RECORD_FILE << std::endl;
+        }
     }
 
+    processCameraInput(window, cursor);
+
     // Moves all balls.
     Vector2 movement (0.0f, 0.0f);
     float rotation = 0.0f;
@@ -191,7 +757,7 @@ void processInput(GLFWwindow* window) {
         rotation = -1.0f;
     }
  
-    for (int i = 0; i < entities.size(); i++) {
+    for (size_t i = 0; i < entities.size(); i++) {
         if (!entities[i]->isKinematic()) {
             entities[i]->force.y += movement.y * -GRAVITY * entities[i]->mass;
             entities[i]->force.x += movement.x * entities[i]->mass;
@@ -242,7 +808,144 @@ void prepareBoxModel() {
     boxMesh = new Mesh(vertices, indices);
 }
 
-int main() {
+// The command line options, printed when one can't be read.
+const char* const USAGE =
+    "  --world [width] [height] sets the size of the world, independent of the window.\n"
+    "  --periodic wraps the edges of the world instead of reflecting off them.\n"
+    "  --headless [particles] [ticks] runs the bulk simulation core without a window and reports its throughput.\n"
+    "  --integrator [batch|euler|verlet|leapfrog|rk4] picks the headless integrator.\n"
+    "  --edmd [particles] [seconds] runs a hard-sphere gas event by event without a window, growing the world to keep it dilute.\n"
+    "  --dam-break [particles] [ticks] breaks a dam of SPH fluid without a window and reports its throughput.\n"
+    "  --load [path] starts from a snapshot. Headless runs step its columns in place.\n"
+    "  --save [path] saves a snapshot at the end of a headless run.\n"
+    "  --record [path] records every tick of a headless run to a trajectory file.\n"
+    "  --checkpoint [path] [ticks] checkpoints a headless run every number of ticks.\n"
+    "  --resume restarts a headless run from its latest checkpoint, and runs on to the same last tick.\n"
+    "  --scene [path] starts from a scene file, in the window or headless.\n"
+    "  --replay [path] plays a trajectory recording back instead of simulating.\n"
+    "  --publish [name] [ticks] publishes a headless run to shared memory every number of ticks.\n"
+    "  --attach [name] shows the particles another process publishes instead of simulating.\n"
+    "  --ensemble [sweep] [output] runs every variant of a parameter sweep without a window and writes a CSV of the results.\n"
+    "  --benchmark-integrators [particles] compares the energy drift of the integrators against their CPU time.\n";
+
+/// <summary>
+/// Reads the command line options listed in USAGE. Prints the usage if a value can't be read or names an unknown integrator.
+/// </summary>
+/// <param name="argc">The number of arguments.</param>
+/// <param name="argv">The arguments.</param>
+/// <returns>False if a value couldn't be read or the integrator is unknown.</returns>
+bool parseArguments(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        try {
+            if (arg == "--world" && i + 2 < argc) {
+                world.max.Set(std::stof(argv[i + 1]), std::stof(argv[i + 2]));
+                i += 2;
+            }
+            else if (arg == "--periodic") {
+                boundaryMode = PERIODIC;
+            }
+            else if (arg == "--headless" && i + 2 < argc) {
+                headless = true;
+                headlessOptions.particles = std::stoul(argv[i + 1]);
+                headlessOptions.ticks = std::stoul(argv[i + 2]);
+                i += 2;
+            }
+            else if (arg == "--integrator" && i + 1 < argc) {
+                if (!ParseIntegrator(argv[i + 1], headlessOptions.integrator)) {
+                    std::cout << "Unknown integrator " << argv[i + 1] << std::endl << "Options:" << std::endl << USAGE;
+                    return false;
+                }
+                i++;
+            }
+            else if (arg == "--edmd" && i + 2 < argc) {
+                headless = true;
+                headlessOptions.particles = std::stoul(argv[i + 1]);
+                eventDrivenDuration = std::stod(argv[i + 2]);
+                i += 2;
+            }
+            else if (arg == "--dam-break" && i + 2 < argc) {
+                headless = true;
+                damBreak = true;
+                headlessOptions.particles = std::stoul(argv[i + 1]);
+                headlessOptions.ticks = std::stoul(argv[i + 2]);
+                i += 2;
+            }
+            else if (arg == "--load" && i + 1 < argc) {
+                headlessOptions.loadPath = argv[i + 1];
+                i++;
+            }
+            else if (arg == "--save" && i + 1 < argc) {
+                headlessOptions.savePath = argv[i + 1];
+                i++;
+            }
+            else if (arg == "--record" && i + 1 < argc) {
+                headlessOptions.recordPath = argv[i + 1];
+                i++;
+            }
+            else if (arg == "--checkpoint" && i + 2 < argc) {
+                headlessOptions.checkpointPath = argv[i + 1];
+                headlessOptions.checkpointInterval = std::stoul(argv[i + 2]);
+                i += 2;
+            }
+            else if (arg == "--resume") {
+                headlessOptions.resume = true;
+            }
+            else if (arg == "--scene" && i + 1 < argc) {
+                headlessOptions.scenePath = argv[i + 1];
+                i++;
+            }
+            else if (arg == "--replay" && i + 1 < argc) {
+                replayPath = argv[i + 1];
+                i++;
+            }
+            else if (arg == "--publish" && i + 2 < argc) {
+                headlessOptions.publishName = argv[i + 1];
+                headlessOptions.publishInterval = std::stoul(argv[i + 2]);
+                i += 2;
+            }
+            else if (arg == "--attach" && i + 1 < argc) {
+                attachName = argv[i + 1];
+                i++;
+            }
+            else if (arg == "--ensemble" && i + 2 < argc) {
+                ensemblePath = argv[i + 1];
+                ensembleOutput = argv[i + 2];
+                i += 2;
+            }
+            else if (arg == "--benchmark-integrators" && i + 1 < argc) {
+                benchmarkParticles = std::stoul(argv[i + 1]);
+                i++;
+            }
+            else {
+                std::cout << "Unknown option " << arg << std::endl;
+            }
+        }
+        catch (const std::exception&) {
+            std::cout << "Could not read the values of " << arg << std::endl << "Options:" << std::endl << USAGE;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (!parseArguments(argc, argv)) return 1;
+
+    if (benchmarkParticles > 0) {
+        return RunIntegratorBenchmark(benchmarkParticles);
+    }
+    if (!ensemblePath.empty()) {
+        return RunEnsemble(ensemblePath, ensembleOutput);
+    }
+    if (headless) {
+        headlessOptions.world = world;
+        headlessOptions.boundary = boundaryMode;
+        if (eventDrivenDuration > 0.0) return RunEventDriven(headlessOptions, eventDrivenDuration);
+        if (damBreak) return RunDamBreak(headlessOptions);
+        return RunHeadless(headlessOptions);
+    }
+
     // Initialize GLFW.
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -279,9 +982,11 @@ int main() {
 
     // Load shaders
     shaderProgram = compileShaderProgram("main.vs", "main.fs");
-    setOrthographicProjection(shaderProgram, 0, SCREEN_WIDTH, 0, SCREEN_HEIGHT, 0.0f, 1.0f);
     glUseProgram(shaderProgram);
 
+    // The camera starts on the bottom left of the world, one world unit per pixel.
+    camera = new Camera(Vector2(world.min.x + SCREEN_WIDTH * 0.5f, world.min.y + SCREEN_HEIGHT * 0.5f), 1.0f, SCREEN_WIDTH, SCREEN_HEIGHT);
+
 
     // AntiAliasing
     glEnable(GL_DEPTH_TEST);
@@ -291,47 +996,214 @@ int main() {
     // Prepare Meshes
     prepareCircleModel();
     prepareBoxModel();
+    batches[circleMesh] = new InstanceBatch(circleMesh);
+    batches[boxMesh] = new InstanceBatch(boxMesh);
 
-    // Spawn Entities.
-    entities.push_back(new EntityBox(Vector2(rand() % SCREEN_WIDTH * 0.8f, rand() % SCREEN_HEIGHT - 200), boxMesh));
-    
-    for (int i = 0; i < 2; i++) {
-        entities.push_back(new EntityCircle(Vector2(rand() % SCREEN_WIDTH - 20, rand() % SCREEN_HEIGHT - 20), circleMesh));
+    // The particle pool grows by blocks of PARTICLE_BLOCK_SIZE slots up to its capacity and frees blocks left empty,
+    // so steady emitting and absorbing reuses slots without allocating. The entity list is reserved once for the capacity.
+    particles = new ParticlePool(PARTICLE_CAPACITY, circleMesh);
+    entities.reserve(PARTICLE_CAPACITY + 1);
+    barnesHut = new BarnesHut(BARNES_HUT_THETA, GRAVITATIONAL_CONSTANT, GRAVITY_SOFTENING);
+    neighbourList = new NeighbourList(NEIGHBOUR_SKIN, SOFT_SPHERE, CONTACT_STIFFNESS, CONTACT_DAMPING);
+    fluidSolver = new FluidSolver(FLUID_KERNEL_RADIUS, FLUID_REST_DENSITY, FLUID_STIFFNESS, FLUID_VISCOSITY);
+    constraintSolver = new ConstraintSolver(CONSTRAINT_ITERATIONS);
+    substepper = new Substepper(SUBSTEP_CFL, MAX_SUBSTEPS);
+    rateScheduler = new MultiRateScheduler(RATE_REGION_SIZE, MAX_RATE_LEVEL, RATE_CALM_SPEED);
+    chunkManager = new ChunkManager(CHUNK_SIZE, CHUNK_PAGE_FILE);
+    recorder = new TrajectoryRecorder();
+    setBoundaryMode(boundaryMode);
+
+    // Play a recording back, or show another process's particles, or load the scene from a snapshot or a scene file, or spawn the default one.
+    if (!replayPath.empty()) {
+        replay = new ReplayViewer(REPLAY_MAX_SPEED, REPLAY_COLOR_SPEED);
+        if (!replay->Open(replayPath)) {
+            std::cout << replay->getError() << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        world = replay->getWorld();
+    }
+    else if (!attachName.empty()) {
+        liveState = new SharedStateReader();
+        if (!liveState->Open(attachName)) {
+            std::cout << liveState->getError() << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        world = liveState->getWorld();
+    }
+    else if (!headlessOptions.loadPath.empty()) {
+        loadScene(headlessOptions.loadPath);
+    }
+    else if (!headlessOptions.scenePath.empty()) {
+        loadSceneFile(headlessOptions.scenePath);
+    }
+    else {
+        entities.push_back(new EntityBox(Vector2(world.min.x + rand() % SCREEN_WIDTH * 0.8f, world.min.y + rand() % SCREEN_HEIGHT - 200), boxMesh));
+
+        for (int i = 0; i < 2; i++) {
+            entities.push_back(particles->Spawn(Vector2(world.min.x + rand() % SCREEN_WIDTH - 20, world.min.y + rand() % SCREEN_HEIGHT - 20), Vector2(0.0f, 0.0f), 0.0f));
+        }
     }
 
     double lastTime = glfwGetTime();
     double deltaTime = 0, nowTime = 0;
+    double lastReport = lastTime;
 
     // Render and Logic loop.
     while (!glfwWindowShouldClose(window)) {
         // - Measure time
         nowTime = glfwGetTime();
-        deltaTime += (nowTime - lastTime) * TICKS_PER_SECOND;
+        double frameTime = nowTime - lastTime;
+        deltaTime += frameTime * TICKS_PER_SECOND;
         lastTime = nowTime;
 
+        // A replay only moves its playhead, nothing is simulated.
+        if (replay) {
+            input->Update();
+            processReplayInput(window);
+            replay->Update(frameTime);
+            deltaTime = 0.0;
+        }
+
+        // Neither is anything simulated while showing another process's particles.
+        if (liveState) {
+            input->Update();
+            double cursorX, cursorY;
+            glfwGetCursorPos(window, &cursorX, &cursorY);
+            processCameraInput(window, camera->ScreenToWorld(cursorX, cursorY));
+            deltaTime = 0.0;
+        }
+
         // Updates entity in scene.
         while (deltaTime >= 1.0) {
             // Process input of the Scene
             input->Update();
             processInput(window);
 
-            for (int i = 0; i < entities.size(); i++) {
-                entities[i]->Update();
+            for (size_t i = 0; i < emitters.size(); i++) {
+                emitters[i].Update(particles, entities);
+            }
+
+            // Calm regions away from the camera only step every few ticks, covering every tick since their last step.
+            rateScheduler->BeginTick(tick, entities, particles, camera->getView());
+
+            // Gravity and input make up this tick's base force, and the force models add theirs on top.
+            tickForces.resize(entities.size());
+            for (size_t i = 0; i < entities.size(); i++) {
+                tickForces[i] = entities[i]->force;
+            }
+            applyForces();
+
+            // Split the tick into as many substeps as the fastest entity needs to not skip past the smallest.
+            // Every force model is evaluated again before each substep after the first.
+            unsigned int substeps = substepper->Plan(entities);
+            float substep = TIMESTEP / substeps;
+            for (unsigned int s = 0; s < substeps; s++) {
+                if (s > 0) applyForces();
+
+                for (size_t i = 0; i < entities.size(); i++) {
+                    if (rateScheduler->isDue(entities[i]))
+                        entities[i]->Update(world, boundaryMode, rateScheduler->getTimestep(entities[i], substep));
+                }
+
+                constraintSolver->Solve(substep);
+
+                if (interactionMode == PAIRWISE) {
+                    for (size_t i = 0; i < entities.size(); i++) {
+                        if (rateScheduler->isDue(entities[i]))
+                            entities[i]->CheckCollisions(entities, rateScheduler->getTimestep(entities[i], substep), TIMESTEP);
+                    }
+                }
+            }
+
+            for (size_t i = 0; i < entities.size(); i++) {
+                entities[i]->ResetForce();
             }
 
-            for (int i = 0; i < entities.size(); i++) {
-                entities[i]->CheckCollisions(entities);
+            // Page idle chunks out, and chunks near activity back in. Paged out particles are reaped below.
+            if (++tick % CHUNK_UPDATE_INTERVAL == 0) {
+                chunkManager->Update(entities, particles, camera->getView());
+            }
+
+            // Recycle expired, absorbed and paged out particles.
+            particles->Reap(entities, absorbers);
+            constraintSolver->Prune();
+
+            if (recorder->isOpen()) {
+                recordTick();
             }
 
             deltaTime--;
         }
         
+        // Report the substeps and neighbour list metrics in the title once a second.
+        if (nowTime - lastReport >= 1.0) {
+            lastReport = nowTime;
+            std::stringstream status;
+            status << title;
+            if (replay) {
+                status << " | replay tick " << (uint64_t)replay->getTick() << " / " << (uint64_t)replay->getLastTick()
+                    << " | speed " << replay->getSpeed() << "x" << (replay->isPaused() ? " (paused)" : "")
+                    << " | particles: " << replay->getCount();
+            }
+            else if (liveState) {
+                SharedStateFrame frame;
+                status << " | attached to " << attachName;
+                if (liveState->Latest(frame)) status << " | tick " << frame.tick << " | particles: " << frame.count;
+                else status << " | waiting for a frame";
+                if (liveState->isClosed()) status << " (closed)";
+            }
+            else {
+                status << " | substeps: " << substepper->getSubsteps() << " (peak " << substepper->getPeakSubsteps() << ")";
+                substepper->ResetPeak();
+                if (rateScheduler->isEnabled()) {
+                    status << " | stepped: " << rateScheduler->getDueCount() << " / " << rateScheduler->getEntityCount();
+                }
+                if (interactionMode == NEIGHBOUR_LIST) {
+                    status << " | neighbour rebuilds: " << neighbourList->getRebuildCount()
+                        << " | max displacement: " << neighbourList->getMaxDisplacement()
+                        << " / " << neighbourList->getSkin() * 0.5f;
+                }
+                if (chunkManager->getEvictedChunkCount() > 0) {
+                    status << " | resident chunks: " << chunkManager->getResidentChunkCount()
+                        << " | paged out: " << chunkManager->getEvictedParticleCount()
+                        << " | pool slots: " << particles->getAllocatedCount() << " / " << particles->getCapacity();
+                }
+                if (recorder->isOpen()) {
+                    status << " | recording: " << recorder->getRecordedFrames() << " frames";
+                    if (recorder->getDroppedFrames() > 0) status << " (" << recorder->getDroppedFrames() << " dropped)";
+                }
+            }
+            glfwSetWindowTitle(window, status.str().c_str());
+        }
+
         // Clear the screen for a new frame.
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // Render objects.
-        for (int i = 0; i < entities.size(); i++) {
-            entities[i]->Render(shaderProgram, deltaTime);
+        // Project the camera's view, and only draw what overlaps it.
+        Bounds view = camera->getView();
+        setOrthographicProjection(shaderProgram, view.min.x, view.max.x, view.min.y, view.max.y, 0.0f, 1.0f);
+
+        // Batch the visible objects by mesh, then draw each mesh in one instanced call.
+        for (auto it = batches.begin(); it != batches.end(); ++it) {
+            it->second->Clear();
+        }
+        if (replay) {
+            replay->Render(batches[circleMesh], view);
+        }
+        if (liveState) {
+            renderLiveState(batches[circleMesh], view);
+        }
+        for (size_t i = 0; i < entities.size(); i++) {
+            Entity* ent = entities[i];
+            if (!view.Overlaps(ent->position, fmaxf(ent->scale.x, ent->scale.y))) continue;
+            auto batch = batches.find(ent->getMesh());
+            if (batch == batches.end()) continue;
+            ent->Render(batch->second, deltaTime);
+        }
+        for (auto it = batches.begin(); it != batches.end(); ++it) {
+            it->second->Draw();
         }
 
        /*GLenum err;
@@ -346,9 +1218,27 @@ int main() {
     }
 
     // Cleanup memory
-    for (int i = 0; i < entities.size(); i++) {
-        delete entities[i];
+    for (size_t i = 0; i < entities.size(); i++) {
+        if (!particles->Owns(entities[i]))
+            delete entities[i];
+    }
+    delete particles;
+    delete barnesHut;
+    delete neighbourList;
+    delete fluidSolver;
+    delete constraintSolver;
+    delete substepper;
+    delete rateScheduler;
+    delete chunkManager;
+    delete recorder;
+    delete replay;
+    delete liveState;
+    delete camera;
+    for (auto it = batches.begin(); it != batches.end(); ++it) {
+        delete it->second;
     }
+    delete circleMesh;
+    delete boxMesh;
     delete input;
     glDeleteProgram(shaderProgram);
     glfwTerminate();
@@ -2,13 +2,17 @@
 
 layout (location = 0) in vec2 vertices;
 
+// Per instance: the linear part of the transform by columns, the translation and the color.
+layout (location = 1) in vec4 basis;
+layout (location = 2) in vec2 offset;
+layout (location = 3) in vec3 color;
+
 uniform mat4 projection;
-uniform mat4 model;
-uniform vec3 color;
 
 smooth out vec4 out_color;
 
 void main() {
-	gl_Position = projection * model * vec4(vertices.xy, 0.0f, 1.0f);
+	vec2 world = mat2(basis.xy, basis.zw) * vertices + offset;
+	gl_Position = projection * vec4(world, 0.0f, 1.0f);
 	out_color = vec4(color, 1.0f);
-}
\ No newline at end of file
+}
@@ -0,0 +1,204 @@
+/*
+The C interface of the particle simulator. Each PsimWorld is a World, and the
+arrays handed out point straight into the World's block of circles. Exceptions
+must not cross the C boundary, so every function that allocates, spawns or
+steps catches everything and reports it as a failure. The rest only read
+fields and can't throw.
+*/
+
+#include "ParticleSim.h"
+#include "../Game/World.h"
+#include <cmath>
+
+struct PsimWorld {
+    World world;
+
+    PsimWorld(const WorldParameters& parameters, size_t capacity) : world(parameters, capacity) {}
+};
+
+/// <summary>
+/// Returns the version of the interface the library was built with, to compare against PSIM_VERSION.
+/// </summary>
+int psimGetVersion(void) {
+    return PSIM_VERSION;
+}
+
+/// <summary>
+/// Fills in the settings of the interactive simulation: its default world, walls, gravity, tick and an Entity's bounciness and friction.
+/// </summary>
+/// <param name="parameters">Receives the settings.</param>
+void psimDefaultParameters(PsimParameters* parameters) {
+    if (!parameters) return;
+    WorldParameters defaults;
+    parameters->minX = defaults.bounds.min.x;
+    parameters->minY = defaults.bounds.min.y;
+    parameters->maxX = defaults.bounds.max.x;
+    parameters->maxY = defaults.bounds.max.y;
+    parameters->periodic = defaults.boundary == PERIODIC;
+    parameters->gravityX = defaults.gravity.x;
+    parameters->gravityY = defaults.gravity.y;
+    parameters->timestep = defaults.timestep;
+    parameters->bounciness = defaults.bounciness;
+    parameters->friction = defaults.friction;
+    parameters->seed = defaults.seed;
+}
+
+/// <summary>
+/// Creates an empty world with room for a number of circles.
+/// </summary>
+/// <param name="parameters">The settings of the world, or NULL for the defaults.</param>
+/// <param name="capacity">The most circles the world will hold.</param>
+/// <returns>The world, or NULL if a setting isn't finite, its bounds are empty or it could not be allocated.</returns>
+PsimWorld* psimCreateWorld(const PsimParameters* parameters, size_t capacity) {
+    PsimParameters settings;
+    psimDefaultParameters(&settings);
+    if (parameters) settings = *parameters;
+    const float values[] = { settings.minX, settings.minY, settings.maxX, settings.maxY, settings.gravityX, settings.gravityY,
+        settings.timestep, settings.bounciness, settings.friction };
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        if (!std::isfinite(values[i])) return nullptr;
+    }
+    if (!(settings.maxX > settings.minX) || !(settings.maxY > settings.minY) || !(settings.timestep > 0.0f)) return nullptr;
+
+    WorldParameters world;
+    world.bounds = Bounds(Vector2(settings.minX, settings.minY), Vector2(settings.maxX, settings.maxY));
+    world.boundary = settings.periodic ? PERIODIC : REFLECTING;
+    world.gravity = Vector2(settings.gravityX, settings.gravityY);
+    world.timestep = settings.timestep;
+    world.bounciness = settings.bounciness;
+    world.friction = settings.friction;
+    world.seed = settings.seed;
+
+    try {
+        return new PsimWorld(world, capacity);
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+/// <summary>
+/// Destroys a world. Every array taken from it is invalid afterwards.
+/// </summary>
+void psimDestroyWorld(PsimWorld* world) {
+    try {
+        delete world;
+    }
+    catch (...) {
+    }
+}
+
+/// <summary>
+/// Adds circles to a world, until it is full or a circle is invalid.
+/// </summary>
+/// <param name="world">The world.</param>
+/// <param name="count">The number of circles.</param>
+/// <param name="positions">X and Y of each circle, one after the other.</param>
+/// <param name="velocities">X and Y of each circle's velocity, or NULL for circles at rest.</param>
+/// <param name="radii">The radius of each circle, which must be positive.</param>
+/// <param name="densities">The mass per unit area of each circle, which must be positive, or NULL for one.</param>
+/// <returns>The number of circles added, less than count if the world filled up or the next circle has a value
+/// that isn't finite, or a radius or density that isn't positive.</returns>
+size_t psimSpawn(PsimWorld* world, size_t count, const float* positions, const float* velocities, const float* radii, const float* densities) {
+    if (!world || !positions || !radii) return 0;
+
+    try {
+        for (size_t i = 0; i < count; i++) {
+            Vector2 position(positions[i * 2], positions[i * 2 + 1]);
+            Vector2 velocity = velocities ? Vector2(velocities[i * 2], velocities[i * 2 + 1]) : Vector2(0.0f, 0.0f);
+            float density = densities ? densities[i] : 1.0f;
+            if (!std::isfinite(position.x) || !std::isfinite(position.y) || !std::isfinite(velocity.x) || !std::isfinite(velocity.y)) return i;
+            if (!(radii[i] > 0.0f) || !std::isfinite(radii[i]) || !(density > 0.0f) || !std::isfinite(density)) return i;
+            if (!world->world.Spawn(position, velocity, radii[i], density)) return i;
+        }
+    }
+    catch (...) {
+        return world->world.getCount();
+    }
+    return count;
+}
+
+/// <summary>
+/// Steps a world a number of ticks.
+/// </summary>
+/// <param name="world">The world.</param>
+/// <param name="ticks">The number of ticks.</param>
+/// <returns>Nonzero on success, zero if the world is NULL or the step failed. psimGetTick tells how far it got.</returns>
+int psimStep(PsimWorld* world, uint32_t ticks) {
+    if (!world) return 0;
+
+    try {
+        world->world.Step(ticks);
+    }
+    catch (...) {
+        return 0;
+    }
+    return 1;
+}
+
+/// <summary>
+/// Returns the number of circles in a world.
+/// </summary>
+size_t psimGetCount(const PsimWorld* world) {
+    return world ? const_cast<PsimWorld*>(world)->world.getCount() : 0;
+}
+
+/// <summary>
+/// Returns the most circles a world can hold.
+/// </summary>
+size_t psimGetCapacity(const PsimWorld* world) {
+    return world ? const_cast<PsimWorld*>(world)->world.getCapacity() : 0;
+}
+
+/// <summary>
+/// Returns the number of ticks a world has been stepped.
+/// </summary>
+uint64_t psimGetTick(const PsimWorld* world) {
+    return world ? const_cast<PsimWorld*>(world)->world.getTick() : 0;
+}
+
+/// <summary>
+/// Points an array at one Vector2 field of every circle in a world.
+/// </summary>
+/// <param name="world">The world.</param>
+/// <param name="field">The field.</param>
+/// <param name="array">Receives the pointers, the stride and the count.</param>
+/// <returns>Nonzero on success, zero if an argument is NULL.</returns>
+static int PointAt(PsimWorld* world, Vector2 Entity::* field, PsimArray* array) {
+    if (!world || !array) return 0;
+
+    // A world made with no room has no block of circles to point into.
+    EntityCircle* first = world->world.getCircles();
+    array->x = first ? &(first->*field).x : nullptr;
+    array->y = first ? &(first->*field).y : nullptr;
+    array->stride = sizeof(EntityCircle);
+    array->count = world->world.getCount();
+    return 1;
+}
+
+/// <summary>
+/// Gives the positions of a world's circles in place.
+/// </summary>
+/// <param name="world">The world.</param>
+/// <param name="array">Receives the pointers, the stride and the count.</param>
+/// <returns>Nonzero on success, zero if an argument is NULL.</returns>
+int psimGetPositions(PsimWorld* world, PsimArray* array) {
+    return PointAt(world, &Entity::position, array);
+}
+
+/// <summary>
+/// Gives the velocities of a world's circles in place.
+/// </summary>
+/// <param name="world">The world.</param>
+/// <param name="array">Receives the pointers, the stride and the count.</param>
+/// <returns>Nonzero on success, zero if an argument is NULL.</returns>
+int psimGetVelocities(PsimWorld* world, PsimArray* array) {
+    return PointAt(world, &Entity::velocity, array);
+}
+
+/// <summary>
+/// Returns the kinetic energy of every live circle in a world.
+/// </summary>
+double psimGetKineticEnergy(const PsimWorld* world) {
+    return world ? const_cast<PsimWorld*>(world)->world.KineticEnergy() : 0.0;
+}
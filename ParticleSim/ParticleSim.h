@@ -0,0 +1,94 @@
+#pragma once
+
+#ifndef PARTICLESIM_H
+#define PARTICLESIM_H
+
+/*
+The C interface of the particle simulator, built as its own shared library so
+other programs can create worlds, fill them, step them and read their state
+without the window or the interactive loop.
+
+Every world is independent, and the library starts no threads of its own: a
+world steps on the thread that calls psimStep. Calls on one world must not
+overlap, but different worlds can be used from different threads at the same
+time. No function lets an exception out; failures come back as NULL or zero.
+
+State is handed out in place rather than copied. psimGetPositions and
+psimGetVelocities return pointers to the X and Y of the first circle and the
+number of bytes from one circle to the next, so circle i's X is at
+(const char*)array.x + i * array.stride. The circles of a world are allocated
+once when it is created, so the pointers stay valid until the world is
+destroyed, and always show its latest tick. Writing through them between
+steps moves or pushes circles.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+	#if defined(PARTICLESIM_BUILD)
+		#define PARTICLESIM_API __declspec(dllexport)
+	#else
+		#define PARTICLESIM_API __declspec(dllimport)
+	#endif
+#else
+	#define PARTICLESIM_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bumped whenever a function or structure of the interface changes.
+#define PSIM_VERSION 2
+
+// A simulation, opaque to the caller.
+typedef struct PsimWorld PsimWorld;
+
+// The settings a world is created with. Fill in the defaults with psimDefaultParameters, then change what differs.
+typedef struct PsimParameters {
+	float minX;
+	float minY;
+	float maxX;
+	float maxY;
+
+	// Nonzero wraps circles around the edges of the world instead of bouncing them off.
+	int periodic;
+
+	// Gravity is a change in velocity per tick.
+	float gravityX;
+	float gravityY;
+
+	// Seconds per tick.
+	float timestep;
+	float bounciness;
+	float friction;
+	uint32_t seed;
+} PsimParameters;
+
+// One field of every circle, read in place. Circle i's X is at (char*)x + i * stride, and likewise its Y.
+typedef struct PsimArray {
+	float* x;
+	float* y;
+	size_t stride;
+	size_t count;
+} PsimArray;
+
+PARTICLESIM_API int psimGetVersion(void);
+PARTICLESIM_API void psimDefaultParameters(PsimParameters* parameters);
+PARTICLESIM_API PsimWorld* psimCreateWorld(const PsimParameters* parameters, size_t capacity);
+PARTICLESIM_API void psimDestroyWorld(PsimWorld* world);
+PARTICLESIM_API size_t psimSpawn(PsimWorld* world, size_t count, const float* positions, const float* velocities, const float* radii, const float* densities);
+PARTICLESIM_API int psimStep(PsimWorld* world, uint32_t ticks);
+PARTICLESIM_API size_t psimGetCount(const PsimWorld* world);
+PARTICLESIM_API size_t psimGetCapacity(const PsimWorld* world);
+PARTICLESIM_API uint64_t psimGetTick(const PsimWorld* world);
+PARTICLESIM_API int psimGetPositions(PsimWorld* world, PsimArray* array);
+PARTICLESIM_API int psimGetVelocities(PsimWorld* world, PsimArray* array);
+PARTICLESIM_API double psimGetKineticEnergy(const PsimWorld* world);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif